@@ -0,0 +1,256 @@
+#include "async_link.h"
+
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <string>
+#include <unistd.h>
+#include "stm32_simulator.h"
+
+// ---------------- Operations ----------------
+
+AsyncLink::SendOperation::SendOperation(AsyncLink& link, const Frame& frame, TxPriority priority,
+                                        Clock::duration timeout)
+    : link(link) {
+    if (!link.comm.isRunning()) {
+        result = SendResult::LinkDown;
+        return;
+    }
+    ticket = link.comm.submit(frame, priority);
+    if (ticket == 0) {
+        result = SendResult::QueueFull;
+        return;
+    }
+    // The completion is read on this thread, it cannot be missed between submit() and here
+    pending = true;
+    link.sends[ticket] = this;
+    timer = link.loop.addTimer(Clock::now() + timeout, [this]() { this->link.finishSend(*this, SendResult::Timeout); });
+}
+
+AsyncLink::SendOperation::~SendOperation() {
+    if (pending) {
+        // Abandoned before completion: the frame is still sent, its completion is ignored
+        link.sends.erase(ticket);
+        link.loop.cancelTimer(timer);
+    }
+}
+
+AsyncLink::ReceiveOperation::ReceiveOperation(AsyncLink& link, Predicate predicate, Clock::time_point deadline)
+    : link(link), predicate(std::move(predicate)) {
+    if (!link.comm.isRunning()) return;
+    pending = true;
+    link.receives.push_back(this);
+    if (deadline != Clock::time_point::max()) {
+        hasTimer = true;
+        timer = link.loop.addTimer(deadline, [this]() {
+            hasTimer = false;
+            this->link.finishReceive(*this);
+        });
+    }
+}
+
+AsyncLink::ReceiveOperation::~ReceiveOperation() {
+    if (pending) {
+        link.receives.erase(std::find(link.receives.begin(), link.receives.end(), this));
+        if (hasTimer) link.loop.cancelTimer(timer);
+    }
+}
+
+// ---------------- AsyncLink ----------------
+
+AsyncLink::AsyncLink(EventLoop& loop, Communicator& communicator) : loop(loop), comm(communicator) {
+    comm.enableCompletions(true);
+    loop.watch(comm.completionEventFd(), [this]() { onCompletions(); });
+    loop.watch(comm.receiveEventFd(), [this]() { onFrames(); });
+}
+
+AsyncLink::~AsyncLink() {
+    loop.unwatch(comm.completionEventFd());
+    loop.unwatch(comm.receiveEventFd());
+    comm.enableCompletions(false);
+    // Operations still alive belong to tasks that will never be resumed: detach them from this object
+    for (auto& entry : sends) {
+        entry.second->pending = false;
+        loop.cancelTimer(entry.second->timer);
+    }
+    for (ReceiveOperation* operation : receives) {
+        operation->pending = false;
+        if (operation->hasTimer) loop.cancelTimer(operation->timer);
+    }
+}
+
+AsyncLink::SendOperation AsyncLink::sendCommand(const char* command, Clock::duration timeout) {
+    Frame frame;
+    if (!makeCommandFrame(frame, 0, command)) {
+        return SendOperation(*this, SendResult::Invalid);
+    }
+    return SendOperation(*this, frame, frame.type == MsgType::Motion ? TxPriority::Setpoint : TxPriority::Diagnostic,
+                         timeout);
+}
+
+void AsyncLink::finishSend(SendOperation& operation, SendResult result) {
+    sends.erase(operation.ticket);
+    loop.cancelTimer(operation.timer);
+    operation.pending = false;
+    operation.result = result;
+    // The resumed task may destroy the operation, it is not touched afterwards
+    if (std::coroutine_handle<> waiter = std::exchange(operation.waiter, {})) waiter.resume();
+}
+
+void AsyncLink::finishReceive(ReceiveOperation& operation) {
+    receives.erase(std::find(receives.begin(), receives.end(), &operation));
+    if (operation.hasTimer) {
+        operation.hasTimer = false;
+        loop.cancelTimer(operation.timer);
+    }
+    operation.pending = false;
+    if (std::coroutine_handle<> waiter = std::exchange(operation.waiter, {})) waiter.resume();
+}
+
+void AsyncLink::onCompletions() {
+    uint64_t counter;
+    (void)!read(comm.completionEventFd(), &counter, sizeof(counter));
+    uint64_t ticket;
+    while (comm.nextCompletion(ticket)) {
+        // Tickets of frames sent without an operation (plain enqueue, abandoned operations) are ignored
+        auto it = sends.find(ticket);
+        if (it != sends.end()) finishSend(*it->second, SendResult::Acked);
+    }
+}
+
+void AsyncLink::onFrames() {
+    uint64_t counter;
+    (void)!read(comm.receiveEventFd(), &counter, sizeof(counter));
+    ReceivedFrame received;
+    std::vector<ReceiveOperation*> matched;
+    while (comm.dequeue(received.frame, received.time_ns)) {
+        // Match first, resume afterwards: the resumed tasks may create or drop operations
+        matched.clear();
+        for (ReceiveOperation* operation : receives) {
+            if (operation->predicate(received.frame)) matched.push_back(operation);
+        }
+        for (ReceiveOperation* operation : matched) {
+            // A task resumed earlier in this loop may have dropped it (or replaced it at the same address)
+            if (std::find(receives.begin(), receives.end(), operation) == receives.end() ||
+                !operation->predicate(received.frame)) {
+                continue;
+            }
+            operation->received = received;
+            finishReceive(*operation);
+        }
+        if (matched.empty() && unclaimed) unclaimed(received);
+    }
+    // fail() and stop() also signal the receive eventfd
+    if (!comm.isRunning()) failAll();
+}
+
+void AsyncLink::failAll() {
+    while (!sends.empty()) finishSend(*sends.begin()->second, SendResult::LinkDown);
+    while (!receives.empty()) finishReceive(*receives.front());
+}
+
+// ---------------- Demo ----------------
+
+namespace {
+
+const char* resultName(SendResult result) {
+    switch (result) {
+        case SendResult::Acked: return "acked";
+        case SendResult::QueueFull: return "queue full";
+        case SendResult::Invalid: return "invalid";
+        case SendResult::Timeout: return "timeout";
+        case SendResult::LinkDown: return "link down";
+    }
+    return "?";
+}
+
+// Upload a plan keeping `outstanding` commands in flight, awaited in order
+Task<> uploadPlan(AsyncLink& link, const std::vector<std::string>& plan, size_t outstanding) {
+    std::deque<AsyncLink::SendOperation> inFlight;
+    size_t acked = 0;
+    int64_t start = monotonicNanos();
+    for (const std::string& action : plan) {
+        Frame frame;
+        if (!makeCommandFrame(frame, 0, action.c_str())) continue;
+        if (inFlight.size() == outstanding) {
+            AsyncLink::SendOperation& oldest = inFlight.front();
+            acked += co_await oldest == SendResult::Acked;
+            inFlight.pop_front();
+        }
+        inFlight.emplace_back(link, frame, TxPriority::Bulk, AsyncLink::DEFAULT_SEND_TIMEOUT);
+    }
+    while (!inFlight.empty()) {
+        AsyncLink::SendOperation& oldest = inFlight.front();
+        acked += co_await oldest == SendResult::Acked;
+        inFlight.pop_front();
+    }
+    std::cout << "[Plan] " << acked << "/" << plan.size() << " commands acknowledged in "
+              << (monotonicNanos() - start) / 1000000 << " ms" << std::endl;
+}
+
+// Text round trips through the STM32 debug console echo, overlapping with the upload
+Task<> echoProbe(AsyncLink& link, int count) {
+    for (int i = 0; i < count; ++i) {
+        std::string text = "ping " + std::to_string(i);
+        // Wait for the echo before sending, it may arrive before the acknowledgement is processed
+        auto echo = link.recvUntil(
+            [text](const Frame& frame) {
+                return frame.type == MsgType::Text && frame.length == text.size() &&
+                       memcmp(frame.payload, text.data(), text.size()) == 0;
+            },
+            AsyncLink::Clock::now() + std::chrono::milliseconds(500));
+        int64_t start = monotonicNanos();
+        SendResult sent = co_await link.sendCommand(text.c_str());
+        std::optional<ReceivedFrame> reply = co_await echo;
+        std::cout << "[Echo] " << text << ": " << resultName(sent);
+        if (reply) {
+            std::cout << ", echoed after " << (reply->time_ns - start) / 1000 << " us";
+        } else {
+            std::cout << ", no echo";
+        }
+        std::cout << std::endl;
+        co_await link.eventLoop().sleepFor(std::chrono::milliseconds(100));
+    }
+}
+
+// A reply that never comes ends with the deadline, without blocking the other tasks
+Task<> missingReply(AsyncLink& link) {
+    auto reply = co_await link.recvUntil([](const Frame& frame) { return frame.type == MsgType::Ack && frame.length > 0; },
+                                         AsyncLink::Clock::now() + std::chrono::milliseconds(300));
+    std::cout << "[Timeout] " << (reply ? "unexpected reply" : "no reply after 300 ms, as expected") << std::endl;
+}
+
+} // namespace
+
+int async_link_test_main() {
+    SimulatorConfig config;
+    config.baudRate = 115200;
+    config.processingDelay = std::chrono::microseconds(200);
+    config.telemetryRate_hz = 50;
+    Stm32Simulator simulator(config);
+    if (!simulator.start()) {
+        std::cerr << "[Error] Cannot start the STM32 simulator." << std::endl;
+        return -1;
+    }
+    Communicator communicator;
+    if (communicator.start(simulator.devicePath().c_str(), config.baudRate) != 1) {
+        std::cerr << "[Error] Cannot open " << simulator.devicePath() << std::endl;
+        return -1;
+    }
+
+    std::vector<std::string> plan;
+    for (int i = 0; i < 40; ++i) plan.push_back(i % 4 == 3 ? "R90" : "F100");
+
+    // One thread runs the three tasks
+    EventLoop loop;
+    AsyncLink link(loop, communicator);
+    loop.spawn(uploadPlan(link, plan, 8));
+    loop.spawn(echoProbe(link, 5));
+    loop.spawn(missingReply(link));
+    loop.run();
+
+    communicator.stop();
+    std::cout << "[Info] Simulator executed " << simulator.commandsExecuted() << " commands, "
+              << communicator.telemetry().totalSamples() << " telemetry samples received." << std::endl;
+    return loop.failedTasks() == 0 ? 0 : -1;
+}
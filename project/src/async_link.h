@@ -0,0 +1,137 @@
+//
+// Awaitable interface of the Communicator for coroutine mission logic.
+//
+//   auto echo = link.recvUntil(isEcho, EventLoop::Clock::now() + 200ms);
+//   SendResult sent = co_await link.send(frame);   // resumes when the STM32 acknowledges it
+//   std::optional<ReceivedFrame> reply = co_await echo;
+//
+// Operations start when they are created, not when they are awaited: a task can create several
+// sends (and the receive that expects their answer) and await them later, so commands overlap on
+// the link without one thread per operation. Completions come from the Communicator transmit
+// thread through its ticket queue and eventfd; everything else runs on the EventLoop thread.
+// AsyncLink is the single consumer of the Communicator receive queue.
+//
+
+#ifndef ASYNC_LINK_H
+#define ASYNC_LINK_H
+
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+#include "communicator.h"
+#include "event_loop.h"
+
+enum class SendResult {
+    Acked,     // Acknowledged by the STM32 (Motion/Text), or left the transmit queue (other frames)
+    QueueFull, // The transmit queue of the priority was full, nothing was sent
+    Invalid,   // The command does not fit in a frame
+    Timeout,   // Not acknowledged in time. The frame may still be delivered later.
+    LinkDown,  // The communicator stopped or failed
+};
+
+class AsyncLink {
+public:
+    using Clock = EventLoop::Clock;
+    using Predicate = std::function<bool(const Frame&)>;
+    static constexpr std::chrono::milliseconds DEFAULT_SEND_TIMEOUT{1000};
+
+    // Started send of one frame, co_await gives its SendResult
+    class SendOperation {
+    public:
+        SendOperation(AsyncLink& link, const Frame& frame, TxPriority priority, Clock::duration timeout);
+        ~SendOperation();
+        SendOperation(const SendOperation&) = delete;
+        SendOperation& operator=(const SendOperation&) = delete;
+
+        bool done() const { return !pending; }
+        bool await_ready() const { return !pending; }
+        void await_suspend(std::coroutine_handle<> awaiter) { waiter = awaiter; }
+        SendResult await_resume() const { return result; }
+
+    private:
+        friend class AsyncLink;
+        explicit SendOperation(AsyncLink& link, SendResult immediate) : link(link), result(immediate) {}
+
+        AsyncLink& link;
+        uint64_t ticket = 0;
+        EventLoop::TimerId timer;
+        std::coroutine_handle<> waiter;
+        SendResult result = SendResult::LinkDown;
+        bool pending = false;
+    };
+
+    // Started wait for the first frame matching a predicate, co_await gives it (nullopt after the deadline)
+    class ReceiveOperation {
+    public:
+        ReceiveOperation(AsyncLink& link, Predicate predicate, Clock::time_point deadline);
+        ~ReceiveOperation();
+        ReceiveOperation(const ReceiveOperation&) = delete;
+        ReceiveOperation& operator=(const ReceiveOperation&) = delete;
+
+        bool done() const { return !pending; }
+        bool await_ready() const { return !pending; }
+        void await_suspend(std::coroutine_handle<> awaiter) { waiter = awaiter; }
+        std::optional<ReceivedFrame> await_resume() { return std::move(received); }
+
+    private:
+        friend class AsyncLink;
+
+        AsyncLink& link;
+        Predicate predicate;
+        EventLoop::TimerId timer;
+        bool hasTimer = false;
+        std::coroutine_handle<> waiter;
+        std::optional<ReceivedFrame> received;
+        bool pending = false;
+    };
+
+    // The communicator must be started; it must outlive the AsyncLink
+    AsyncLink(EventLoop& loop, Communicator& communicator);
+    ~AsyncLink();
+    AsyncLink(const AsyncLink&) = delete;
+    AsyncLink& operator=(const AsyncLink&) = delete;
+
+    // Send a frame and wait for its acknowledgement
+    SendOperation send(const Frame& frame, TxPriority priority = TxPriority::Bulk,
+                       Clock::duration timeout = DEFAULT_SEND_TIMEOUT) {
+        return SendOperation(*this, frame, priority, timeout);
+    }
+    // Motion commands ("F100") go out as Setpoint, anything else as Diagnostic text
+    SendOperation sendCommand(const char* command, Clock::duration timeout = DEFAULT_SEND_TIMEOUT);
+    // Wait for the next received frame for which predicate returns true.
+    // Only frames received after this call are considered; a frame can satisfy several operations.
+    ReceiveOperation recvUntil(Predicate predicate, Clock::time_point deadline = Clock::time_point::max()) {
+        return ReceiveOperation(*this, std::move(predicate), deadline);
+    }
+
+    // Frames nobody was waiting for (debug console output, unexpected replies ...)
+    void setFrameHandler(std::function<void(const ReceivedFrame&)> handler) { unclaimed = std::move(handler); }
+
+    EventLoop& eventLoop() { return loop; }
+    Communicator& communicator() { return comm; }
+    size_t pendingSends() const { return sends.size(); }
+    size_t pendingReceives() const { return receives.size(); }
+
+private:
+    void onCompletions();
+    void onFrames();
+    // End every operation with LinkDown/nullopt
+    void failAll();
+    void finishSend(SendOperation& operation, SendResult result);
+    void finishReceive(ReceiveOperation& operation);
+
+    EventLoop& loop;
+    Communicator& comm;
+    std::unordered_map<uint64_t, SendOperation*> sends; // By ticket
+    std::vector<ReceiveOperation*> receives;           // In creation order
+    std::function<void(const ReceivedFrame&)> unclaimed;
+};
+
+// Demo mission against the simulated STM32: overlapped plan upload, echo round trips and timeouts
+int async_link_test_main();
+
+#endif //ASYNC_LINK_H
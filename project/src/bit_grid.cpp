@@ -0,0 +1,24 @@
+#include "bit_grid.h"
+
+#include <algorithm>
+#include "grid_map.h"
+
+void BitGrid::assign(const GridMap& map) {
+    cols = map.width();
+    rows = map.height();
+    mapVersion = map.version();
+    wordStride = (cols + 2 + 63) / 64;
+    bits.assign(static_cast<size_t>(rows + 2) * wordStride, 0);
+    for (int y = 0; y < rows; ++y) {
+        // The row starts with its left border cell, which lands on the blocked bit 0
+        const uint8_t* cell = map.row(y) - 1;
+        uint64_t* word = &bits[static_cast<size_t>(y + 1) * wordStride];
+        for (int w = 0; w < wordStride; ++w) {
+            int count = std::min(64, cols + 2 - w * 64);
+            uint64_t value = 0;
+            for (int i = 0; i < count; ++i) value |= static_cast<uint64_t>(cell[i] == GridMap::FREE) << i;
+            word[w] = value;
+            cell += count;
+        }
+    }
+}
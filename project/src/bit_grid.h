@@ -0,0 +1,47 @@
+//
+// Bit-packed copy of a GridMap: one bit per cell, 1 = free.
+//
+// Laid out like the GridMap it comes from: bit x + 1 of row y + 1 holds cell (x, y), so the
+// border (x = -1 / width, y = -1 / height) and the padding up to the last word are blocked bits.
+// Planners scan whole rows 64 cells per word with it instead of testing cells one by one.
+//
+
+#ifndef BIT_GRID_H
+#define BIT_GRID_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class GridMap;
+
+class BitGrid {
+public:
+    BitGrid() = default;
+    explicit BitGrid(const GridMap& map) { assign(map); }
+
+    // Rebuild from map, reusing the storage
+    void assign(const GridMap& map);
+
+    int width() const { return cols; }
+    int height() const { return rows; }
+    // Words per row
+    int stride() const { return wordStride; }
+    uint64_t version() const { return mapVersion; } // Version of the map it was built from
+
+    // Row y, valid from -1 to height() included
+    const uint64_t* row(int y) const { return &bits[static_cast<size_t>(y + 1) * wordStride]; }
+    bool isFree(int x, int y) const {
+        unsigned bit = static_cast<unsigned>(x + 1);
+        return (row(y)[bit / 64] >> (bit % 64)) & 1;
+    }
+
+private:
+    int cols = 0;
+    int rows = 0;
+    int wordStride = 0;
+    uint64_t mapVersion = 0;
+    std::vector<uint64_t> bits;
+};
+
+#endif //BIT_GRID_H
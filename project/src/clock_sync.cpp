@@ -0,0 +1,136 @@
+#include "clock_sync.h"
+
+#include <algorithm>
+#include <cmath>
+
+void makeTimeSyncFrame(Frame& frame, uint8_t seq, const TimeSyncMessage& message) {
+    frame.type = MsgType::TimeSync;
+    frame.seq = seq;
+    frame.length = TIME_SYNC_PAYLOAD_SIZE;
+    uint8_t* p = frame.payload;
+    putU32(p, static_cast<uint32_t>(message.hostTime_ns));
+    putU32(p + 4, static_cast<uint32_t>(static_cast<uint64_t>(message.hostTime_ns) >> 32));
+    putU32(p + 8, message.deviceReceive_us);
+    putU32(p + 12, message.deviceTransmit_us);
+}
+
+bool decodeTimeSync(const Frame& frame, TimeSyncMessage& out) {
+    if (frame.type != MsgType::TimeSync || frame.length != TIME_SYNC_PAYLOAD_SIZE) {
+        return false;
+    }
+    const uint8_t* p = frame.payload;
+    out.hostTime_ns = static_cast<int64_t>(getU32(p) | (static_cast<uint64_t>(getU32(p + 4)) << 32));
+    out.deviceReceive_us = getU32(p + 8);
+    out.deviceTransmit_us = getU32(p + 12);
+    return true;
+}
+
+bool ClockSync::addSample(const TimeSyncMessage& reply, int64_t hostReceive_ns) {
+    // Extend the 32-bit device clock, replies arrive in order and far less than 35 minutes apart
+    int64_t device_us = haveDevice ? extendedDevice_us + static_cast<int32_t>(reply.deviceReceive_us - lastDevice_us)
+                                   : reply.deviceReceive_us;
+    int64_t t1 = reply.hostTime_ns;
+    int64_t t2 = device_us * 1000;
+    int64_t t3 = t2 + static_cast<int64_t>(static_cast<int32_t>(reply.deviceTransmit_us - reply.deviceReceive_us)) * 1000;
+    int64_t t4 = hostReceive_ns;
+    if (t4 < t1 || t3 < t2) {
+        rejectedCount.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    haveDevice = true;
+    extendedDevice_us = device_us;
+    lastDevice_us = reply.deviceReceive_us;
+
+    // The device clock has a 1 us resolution, a very fast round trip can come out slightly negative
+    Sample& sample = window[windowNext];
+    sample.host_ns = t1 + (t4 - t1) / 2;
+    sample.offset_ns = t2 + (t3 - t2) / 2 - sample.host_ns;
+    sample.delay_ns = std::max<int64_t>((t4 - t1) - (t3 - t2), 0);
+    windowNext = (windowNext + 1) % WINDOW;
+    windowCount = std::min(windowCount + 1, WINDOW);
+    sampleCount.fetch_add(1, std::memory_order_relaxed);
+
+    int64_t minDelay = sample.delay_ns;
+    for (size_t i = 0; i < windowCount; ++i) minDelay = std::min(minDelay, window[i].delay_ns);
+    int64_t maxDelay = minDelay + std::max(DELAY_TOLERANCE_NS, minDelay / 4);
+
+    // Least squares over the fast samples, relative to the newest one to keep the precision of doubles
+    const Sample& newest = sample;
+    double n = 0, sumX = 0, sumY = 0, sumXX = 0, sumXY = 0;
+    int64_t firstX = 0, lastX = 0;
+    for (size_t i = 0; i < windowCount; ++i) {
+        if (window[i].delay_ns > maxDelay) continue;
+        double x = static_cast<double>(window[i].host_ns - newest.host_ns);
+        double y = static_cast<double>(window[i].offset_ns - newest.offset_ns);
+        n += 1;
+        sumX += x;
+        sumY += y;
+        sumXX += x * x;
+        sumXY += x * y;
+        firstX = n == 1 ? window[i].host_ns : std::min(firstX, window[i].host_ns);
+        lastX = n == 1 ? window[i].host_ns : std::max(lastX, window[i].host_ns);
+    }
+    double meanX = sumX / n;
+    double meanY = sumY / n;
+    // A slope needs samples spread over some time, until then the previous one is kept
+    if (n >= 2 && lastX - firstX >= 1000000000LL) {
+        double fitted = (sumXY - n * meanX * meanY) / (sumXX - n * meanX * meanX);
+        if (std::fabs(fitted) * 1e6 <= MAX_DRIFT_PPM) slope = fitted;
+    }
+
+    // Device time at the newest sample, then the inverse mapping around it
+    double offsetAtNewest = static_cast<double>(newest.offset_ns) + meanY - slope * meanX;
+    int64_t refDevice_ns = newest.host_ns + static_cast<int64_t>(std::llround(offsetAtNewest));
+    int64_t refDevice_us = refDevice_ns / 1000;
+    int64_t remainder_ns = refDevice_ns - refDevice_us * 1000;
+    if (remainder_ns < 0) {
+        refDevice_us -= 1;
+        remainder_ns += 1000;
+    }
+    double rate = 1.0 / (1.0 + slope);
+    publish(static_cast<uint32_t>(refDevice_us), newest.host_ns - static_cast<int64_t>(std::llround(remainder_ns * rate)), rate);
+    uncertainty.store(minDelay / 2, std::memory_order_relaxed);
+    return true;
+}
+
+void ClockSync::reset() {
+    windowCount = windowNext = 0;
+    haveDevice = false;
+    slope = 0.0;
+    valid.store(false, std::memory_order_release);
+    uncertainty.store(0, std::memory_order_relaxed);
+}
+
+void ClockSync::publish(uint32_t refDevice_us, int64_t refHost_ns, double rate) {
+    uint32_t current = version.load(std::memory_order_relaxed);
+    version.store(current + 1, std::memory_order_relaxed); // Odd: update in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    refDevice.store(refDevice_us, std::memory_order_relaxed);
+    refHost.store(refHost_ns, std::memory_order_relaxed);
+    hostPerDevice.store(rate, std::memory_order_relaxed);
+    version.store(current + 2, std::memory_order_release);
+    valid.store(true, std::memory_order_release);
+}
+
+bool ClockSync::toHostTime(uint32_t deviceTime_us, int64_t& host_ns) const {
+    if (!synchronized()) return false;
+    uint32_t device_us;
+    int64_t host;
+    double rate;
+    uint32_t before;
+    do {
+        before = version.load(std::memory_order_acquire);
+        device_us = refDevice.load(std::memory_order_relaxed);
+        host = refHost.load(std::memory_order_relaxed);
+        rate = hostPerDevice.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((before & 1) != 0 || version.load(std::memory_order_relaxed) != before);
+
+    double elapsed_ns = static_cast<double>(static_cast<int32_t>(deviceTime_us - device_us)) * 1000.0;
+    host_ns = host + static_cast<int64_t>(std::llround(elapsed_ns * rate));
+    return true;
+}
+
+double ClockSync::drift_ppm() const {
+    return (1.0 / hostPerDevice.load(std::memory_order_relaxed) - 1.0) * 1e6;
+}
@@ -0,0 +1,97 @@
+//
+// Clock synchronisation between the Pi and the STM32 over the serial link.
+//
+// The host periodically sends a TimeSync frame stamped with its monotonic clock (t1). The STM32
+// stamps the end of its reception (t2) and the start of the transmission of its reply (t3) with
+// its free-running microsecond clock, and the host stamps the end of the reply (t4). As in NTP:
+//   offset = ((t2 + t3) - (t1 + t4)) / 2        delay = (t4 - t1) - (t3 - t2)
+// Ping and reply have the same size, so the time spent on the line cancels out of the offset.
+// A reply that waited in a queue has a larger delay and a biased offset: only the samples close
+// to the smallest recent delay are used. A least-squares line through their offsets gives the
+// drift of the STM32 oscillator, and the resulting model maps device timestamps (telemetry) to
+// Pi monotonic time.
+//
+// TimeSync payload (little endian, TIME_SYNC_PAYLOAD_SIZE bytes):
+//   [hostTime_ns:i64][deviceReceive_us:u32][deviceTransmit_us:u32]
+// The host sends the two device fields as 0, the STM32 echoes hostTime_ns and the seq.
+//
+
+#ifndef CLOCK_SYNC_H
+#define CLOCK_SYNC_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "protocol.h"
+
+constexpr size_t TIME_SYNC_PAYLOAD_SIZE = 16;
+
+struct TimeSyncMessage {
+    int64_t hostTime_ns = 0;        // t1, monotonicNanos() when the host sent the ping
+    uint32_t deviceReceive_us = 0;  // t2, STM32 clock when the ping was received
+    uint32_t deviceTransmit_us = 0; // t3, STM32 clock when the reply started on the line
+};
+
+void makeTimeSyncFrame(Frame& frame, uint8_t seq, const TimeSyncMessage& message);
+// Returns false if the frame is not a valid TimeSync message
+bool decodeTimeSync(const Frame& frame, TimeSyncMessage& out);
+
+/**
+ * @brief Offset and drift estimator. A single writer (the serial receive thread) adds the replies,
+ *        any thread can convert timestamps without locks.
+ */
+class ClockSync {
+public:
+    static constexpr size_t WINDOW = 32;                  // Most recent samples used by the estimate
+    static constexpr int64_t DELAY_TOLERANCE_NS = 100000; // Samples up to this much slower than the fastest are kept
+    static constexpr double MAX_DRIFT_PPM = 500.0;        // Beyond any crystal, such a slope is noise
+
+    // --- Writer side ---
+    // Add a reply received at hostReceive_ns (t4). Returns false if the sample is inconsistent.
+    bool addSample(const TimeSyncMessage& reply, int64_t hostReceive_ns);
+    // Forget everything (new connection, the STM32 may have rebooted)
+    void reset();
+
+    // --- Reader side ---
+    bool synchronized() const { return valid.load(std::memory_order_acquire); }
+    // Pi monotonic time of a device timestamp, false if not synchronized yet.
+    // Valid for device timestamps within +-35 minutes of the last sample (32-bit wrap-around).
+    bool toHostTime(uint32_t deviceTime_us, int64_t& host_ns) const;
+    // Device clock rate relative to the Pi, in parts per million (positive: the STM32 runs fast)
+    double drift_ppm() const;
+    // Half the smallest round-trip delay of the window: bound of the offset error
+    int64_t uncertainty_ns() const { return uncertainty.load(std::memory_order_relaxed); }
+    uint64_t samples() const { return sampleCount.load(std::memory_order_relaxed); }
+    uint64_t rejectedSamples() const { return rejectedCount.load(std::memory_order_relaxed); }
+
+private:
+    struct Sample {
+        int64_t host_ns;   // Midpoint of t1 and t4
+        int64_t offset_ns; // Device minus host time at that point
+        int64_t delay_ns;
+    };
+
+    void publish(uint32_t refDevice_us, int64_t refHost_ns, double rate);
+
+    // Writer state
+    Sample window[WINDOW] = {};
+    size_t windowCount = 0;
+    size_t windowNext = 0;
+    bool haveDevice = false;
+    uint32_t lastDevice_us = 0;
+    int64_t extendedDevice_us = 0; // Device clock without the 32-bit wrap-around
+    double slope = 0.0;            // d(offset)/d(host time), kept while the window is too short to fit one
+
+    // Model published to the readers (seqlock): host = refHost + (device - refDevice) * rate
+    std::atomic<uint32_t> version{0};
+    std::atomic<bool> valid{false};
+    std::atomic<uint32_t> refDevice{0};
+    std::atomic<int64_t> refHost{0};
+    std::atomic<double> hostPerDevice{1.0};
+
+    std::atomic<int64_t> uncertainty{0};
+    std::atomic<uint64_t> sampleCount{0};
+    std::atomic<uint64_t> rejectedCount{0};
+};
+
+#endif //CLOCK_SYNC_H
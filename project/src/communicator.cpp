@@ -1,29 +1,869 @@
 #include "communicator.h"
 
-// --- 平台相关的串口名称 ---
+#include <algorithm>
+#include <cstring>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+
+// --- 串口名称 ---
 // --- !!! 请根据你的实际情况修改此处的串口号 !!! ---
+// 通信子系统只支持 Linux：线程唤醒用 eventfd + poll，多串口用 epoll，重连用 inotify 监视设备
 
-#if defined (_WIN32) || defined(_WIN64)
-    #define SERIAL_PORT "COM1" // Windows 示例
-#else
-    #define SERIAL_PORT "/dev/ttyUSB0" // Linux/macOS 示例
-#endif
+#define SERIAL_PORT "/dev/ttyUSB0"
 
 const unsigned int BAUD_RATE = 115200; // 波特率，与 STM32 设置一致
+// 低延迟模式：允许 921600 等非标准波特率，并开启驱动的低延迟设置 (STM32 需使用相同波特率)
+const bool LOW_LATENCY = false;
+// 流控方式：长动作序列下发时，用 SERIAL_FLOW_RTSCTS 防止 STM32 接收缓冲区溢出 (需要连接 RTS/CTS 线)
+const SerialFlowControl FLOW_CONTROL = SERIAL_FLOW_NONE;
+// USB 转串口断开后等待它重新出现的时间，超过后程序退出
+const unsigned int RECONNECT_TIMEOUT_MS = 30000;
+
+// 接收线程每次等待数据的最长时间，决定 stop() 的响应时间
+const unsigned int RX_WAIT_MS = 50;
+// 收发帧日志文件，程序异常后可以用 journal_replay 查看和回放。启动时上一次运行的日志改名为 serial_journal.bin.1 保留
+const char* JOURNAL_PATH = "serial_journal.bin";
+// 串口驱动超过这个时间没有接收新数据，记一次流控暂停；也是发送线程等待驱动排出数据的最长时间
+const unsigned int TX_FLOW_WAIT_MS = 5;
+// 时钟同步：启动后先快速发送几次，尽快得到偏移，之后每秒一次，足够跟踪晶振漂移
+const unsigned int TIME_SYNC_FAST_COUNT = 8;
+const unsigned int TIME_SYNC_FAST_INTERVAL_MS = 100;
+const unsigned int TIME_SYNC_INTERVAL_MS = 1000;
+// 交给串口驱动但尚未发出的数据最多约 2 ms (至少一个最长帧)：驱动里的字节不能被急停抢占
+const unsigned int TX_DRIVER_QUEUE_MS = 2;
+// 重连时除了 inotify 通知，每隔这么久也尝试打开一次设备 (没有 inotify、设备所在目录本身被删除等情况)
+const unsigned int RECONNECT_RETRY_MS = 100;
+
+// 记录最大值，多个线程可能同时更新
+static void storeMax(std::atomic<int64_t>& target, int64_t value) {
+    int64_t current = target.load(std::memory_order_relaxed);
+    while (value > current && !target.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+    }
+}
+
+// 打印一个收到的帧
+static void printFrame(const Frame& frame) {
+    std::cout << "[Received] seq " << (int)frame.seq << ", ";
+    switch (frame.type) {
+        case MsgType::Ack:
+            std::cout << "Ack" << std::endl;
+            break;
+        case MsgType::Motion:
+            std::cout << "Motion " << (char)frame.payload[0] << getU16(frame.payload + 1) << std::endl;
+            break;
+        case MsgType::Text:
+            std::cout << "Text: " << std::string(reinterpret_cast<const char*>(frame.payload), frame.length) << std::endl;
+            break;
+        default:
+            std::cout << "type 0x" << std::hex << (int)frame.type << std::dec << ", " << (int)frame.length << " bytes" << std::endl;
+            break;
+    }
+}
+
+// ---------------- Communicator ----------------
+
+Communicator::Communicator(const TransportConfig& config)
+    : sender(config), resendInterval(config.minRetransmitTimeout), maxSyncAttempts(config.maxRetries + 1) {
+    // Setpoint 保留 1/4 的窗口 (至少一帧)，窗口只有一帧时无法保留
+    size_t window = sender.window();
+    lowPriorityWindow = window > 1 ? window - std::max<size_t>(window / 4, 1) : 1;
+    txEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    rxEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    completionFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+}
+
+Communicator::~Communicator() {
+    stop();
+    if (txEventFd >= 0) {
+        close(txEventFd);
+    }
+    if (rxEventFd >= 0) {
+        close(rxEventFd);
+    }
+    if (completionFd >= 0) {
+        close(completionFd);
+    }
+}
+
+int Communicator::openSerial() {
+    serial.setLowLatency(deviceLowLatency);
+    int result = serial.openDevice(devicePath.c_str(), deviceBauds);
+    if (result != 1) {
+        return result;
+    }
+    if (deviceFlowControl != SERIAL_FLOW_NONE && serial.setFlowControl(deviceFlowControl) != 1) {
+        serial.closeDevice();
+        return -5; // 与 openDevice 相同：写入串口参数失败
+    }
+    return 1;
+}
+
+int Communicator::openPort(const char* device, unsigned int bauds, bool lowLatency, SerialFlowControl flowControl) {
+    stop();
+
+    devicePath = device;
+    deviceBauds = bauds;
+    deviceLowLatency = lowLatency;
+    deviceFlowControl = flowControl;
+    int result = openSerial();
+    if (result != 1) {
+        return result;
+    }
+    connection.store(++connectionCount, std::memory_order_relaxed);
+    resuming = false;
+
+    // 新会话从序号 0 开始，发送第一个可靠帧之前用 Sync 通知 STM32
+    sender.reset();
+    session = SessionState::Unsynced;
+    syncReply.store(-1, std::memory_order_relaxed);
+    latestAck.store(-1, std::memory_order_relaxed);
+    packetPool.reset();
+    std::fill(std::begin(inFlightPackets), std::end(inFlightPackets), nullptr);
+    std::fill(std::begin(inFlightTickets), std::end(inFlightTickets), 0);
+    txWriteHead = txWriteCount = txWriteOffset = txWriteBytes = 0;
+    backlogBytes.store(0, std::memory_order_relaxed);
+    txLastProgress = TransportClock::now();
+    stopPacket = nullptr;
+    // 上一个会话中没有确认的急停，在新会话中重新发送
+    if (stopPendingSeq.exchange(-1, std::memory_order_relaxed) >= 0) {
+        stopRequested.store(true, std::memory_order_relaxed);
+    }
+
+    // 限制驱动中积压的字节数
+    size_t bytesPerSecond = std::max(bauds / 10, 1u); // 8N1: 每字节 10 位
+    byteTime = std::chrono::nanoseconds(1'000'000'000LL / bytesPerSecond);
+    txLineIdle = TransportClock::now();
+    txDriverLimit = std::max<size_t>(FRAME_MAX_ENCODED, bytesPerSecond * TX_DRIVER_QUEUE_MS / 1000);
+    // 排出一半积压的时间
+    size_t drain_ms = (txDriverLimit / 2 * 1000 + bytesPerSecond - 1) / bytesPerSecond;
+    txDrainWait_ms = static_cast<int>(std::clamp<size_t>(drain_ms, 1, TX_FLOW_WAIT_MS));
+    rxDecoder.reset();
+    telemetryHistory.restartSequence();
+    // STM32 可能已经重启，时钟重新同步
+    clockSync.reset();
+    syncsSent = 0;
+    nextSync = TransportClock::now();
+    return 1;
+}
+
+int Communicator::start(const char* device, unsigned int bauds, bool lowLatency, SerialFlowControl flowControl) {
+    int result = openPort(device, bauds, lowLatency, flowControl);
+    if (result != 1) {
+        return result;
+    }
+    running.store(true, std::memory_order_release);
+    rxThread = std::thread(&Communicator::rxLoop, this, connection.load(std::memory_order_relaxed));
+    txThread = std::thread(&Communicator::txLoop, this);
+    return 1;
+}
+
+int Communicator::addToReactor(SerialReactor& eventLoop, int connectionId) {
+    return eventLoop.addDevice(
+        serial,
+        [this](const uint8_t* data, size_t length, int64_t time_ns) { processReceived(data, length, time_ns); },
+        [this, connectionId]() { linkFailed("read", connectionId); });
+}
+
+int Communicator::start(SerialReactor& eventLoop, const char* device, unsigned int bauds, bool lowLatency,
+                        SerialFlowControl flowControl) {
+    int result = openPort(device, bauds, lowLatency, flowControl);
+    if (result != 1) {
+        return result;
+    }
+    running.store(true, std::memory_order_release);
+    reactorId = addToReactor(eventLoop, connection.load(std::memory_order_relaxed));
+    if (reactorId < 0) {
+        running.store(false, std::memory_order_release);
+        serial.closeDevice();
+        return -2; // 与 openDevice 相同：无法使用该设备
+    }
+    reactor = &eventLoop;
+    txThread = std::thread(&Communicator::txLoop, this);
+    return 1;
+}
+
+bool Communicator::openJournal(const char* path, size_t capacity) {
+    if (running.load(std::memory_order_acquire)) return false; // 收发线程运行时不能替换日志
+    return journal.open(path, capacity);
+}
+
+void Communicator::stop() {
+    running.store(false, std::memory_order_release);
+    // 唤醒发送线程和等待接收的调用方，接收线程最多在 RX_WAIT_MS 后退出
+    uint64_t one = 1;
+    (void)!write(txEventFd, &one, sizeof(one));
+    (void)!write(rxEventFd, &one, sizeof(one));
+
+    // 先等发送线程退出：重连时由它重启接收线程、重新注册到事件循环
+    if (txThread.joinable()) txThread.join();
+    // 从事件循环注销后不会再有接收回调
+    if (reactor != nullptr) {
+        reactor->removeDevice(reactorId);
+        reactor = nullptr;
+        reactorId = -1;
+    }
+    if (rxThread.joinable()) rxThread.join();
+    if (serial.isDeviceOpen()) serial.closeDevice();
+    if (deviceWatchFd >= 0) {
+        close(deviceWatchFd);
+        deviceWatchFd = -1;
+    }
+}
+
+void Communicator::fail(const char* reason) {
+    std::cerr << "[Error] Serial " << reason << " failed, communicator stopped." << std::endl;
+    running.store(false, std::memory_order_release);
+    // 唤醒另一侧的线程和等待接收的调用方
+    uint64_t one = 1;
+    (void)!write(txEventFd, &one, sizeof(one));
+    (void)!write(rxEventFd, &one, sizeof(one));
+}
+
+void Communicator::linkFailed(const char* reason, int connectionId) {
+    if (!running.load(std::memory_order_acquire)) return;
+    if (reconnectTimeout.count() == 0) {
+        fail(reason);
+        return;
+    }
+    // 接收方和发送线程可能都发现了断开，只处理第一次
+    int expected = connectionId;
+    if (connectionId < 0 || !connection.compare_exchange_strong(expected, -1, std::memory_order_acq_rel)) return;
+    connectionLostTime.store(monotonicNanos(), std::memory_order_relaxed);
+    std::cerr << "[Warning] Serial " << reason << " failed, waiting for " << devicePath << " to come back." << std::endl;
+    uint64_t one = 1;
+    (void)!write(txEventFd, &one, sizeof(one));
+}
+
+bool Communicator::waitForDevice(TransportClock::time_point deadline) {
+    // 监视设备所在的目录：设备节点 (或 udev 的符号链接) 出现、权限设置好时立即重试，不必轮询。
+    // 监视一直保留到 stop()：关闭 inotify 描述符要等待几毫秒 (RCU 宽限期)，不能放在恢复路径上
+    size_t slash = devicePath.find_last_of('/');
+    std::string name = devicePath.substr(slash == std::string::npos ? 0 : slash + 1);
+    if (deviceWatchFd < 0) {
+        std::string directory = slash == std::string::npos ? "." : devicePath.substr(0, std::max<size_t>(slash, 1));
+        deviceWatchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (deviceWatchFd >= 0 &&
+            inotify_add_watch(deviceWatchFd, directory.c_str(), IN_CREATE | IN_MOVED_TO | IN_ATTRIB) < 0) {
+            close(deviceWatchFd);
+            deviceWatchFd = -1;
+        }
+    }
+    // 返回是否有这个设备的事件 (连接期间积累的事件也在这里清掉)
+    auto deviceEvent = [this, &name]() {
+        bool found = false;
+        alignas(struct inotify_event) char events[4096];
+        ssize_t length;
+        while ((length = read(deviceWatchFd, events, sizeof(events))) > 0) {
+            for (ssize_t offset = 0; offset < length;) {
+                const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(events + offset);
+                if (event->len > 0 && name == event->name) found = true;
+                offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+            }
+        }
+        return found;
+    };
+    if (deviceWatchFd >= 0) deviceEvent();
+
+    bool retry = true;
+    while (running.load(std::memory_order_acquire)) {
+        if (retry && openSerial() == 1) return true;
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(deadline - TransportClock::now());
+        if (left.count() <= 0) return false;
+
+        struct pollfd fds[2] = {{txEventFd, POLLIN, 0}, {deviceWatchFd, POLLIN, 0}};
+        int ready = poll(fds, deviceWatchFd >= 0 ? 2 : 1,
+                         static_cast<int>(std::min<long long>(left.count(), RECONNECT_RETRY_MS)));
+        retry = ready == 0;
+        if (ready < 0) continue;
+        if (fds[0].revents & POLLIN) {
+            uint64_t counter; // stop()
+            (void)!read(txEventFd, &counter, sizeof(counter));
+        }
+        if (deviceWatchFd >= 0 && (fds[1].revents & POLLIN) && deviceEvent()) retry = true;
+    }
+    return false;
+}
+
+bool Communicator::reconnect() {
+    // 1. 停止接收：接收线程发现连接编号变化后退出，事件循环在出错时已经删除了注册
+    if (reactor != nullptr) {
+        reactor->removeDevice(reactorId);
+        reactorId = -1;
+    }
+    if (rxThread.joinable()) rxThread.join();
+    serial.closeDevice();
+
+    // 2. 写队列中的字节随旧连接丢失 (最早的帧可能只写出一半)，在途帧留在窗口中，会话恢复后重放
+    dropWriteQueue();
+
+    // 3. 等待设备重新出现，用相同的参数打开
+    if (!waitForDevice(TransportClock::now() + reconnectTimeout)) {
+        if (running.load(std::memory_order_acquire)) fail("reconnect (device did not come back)");
+        return false;
+    }
+
+    // 4. 新连接：重启接收，重新和 STM32 对齐序号 (遥测序号也从头开始，重连前后的序号差不算丢失)
+    rxDecoder.reset();
+    telemetryHistory.restartSequence();
+    // STM32 可能在断线期间掉电重启，时钟重新同步 (接收线程已停止，此时没有其他线程写时钟同步状态)
+    clockSync.reset();
+    syncsSent = 0;
+    nextSync = TransportClock::now();
+    int id = ++connectionCount;
+    connection.store(id, std::memory_order_release);
+    if (reactor != nullptr) {
+        reactorId = addToReactor(*reactor, id);
+        if (reactorId < 0) {
+            fail("reconnect (reactor registration)");
+            return false;
+        }
+    } else {
+        rxThread = std::thread(&Communicator::rxLoop, this, id);
+    }
+    reconnectCount.fetch_add(1, std::memory_order_relaxed);
+    auto now = TransportClock::now();
+    txLineIdle = txLastProgress = now;
+    session = SessionState::Unsynced;
+    resuming = true;
+    stopResendAt = now; // 没有确认的急停立即重发
+    std::cout << "[Info] Serial device " << devicePath << " reopened after "
+              << (monotonicNanos() - connectionLostTime.load(std::memory_order_relaxed)) / 1000 << " us." << std::endl;
+    return true;
+}
+
+void Communicator::dropWriteQueue() {
+    while (txWriteCount > 0) {
+        packetPool.release(txWriteQueue[txWriteHead]);
+        txWriteHead = (txWriteHead + 1) % TX_WRITE_QUEUE_SIZE;
+        --txWriteCount;
+    }
+    txWriteHead = txWriteOffset = txWriteBytes = 0;
+    backlogBytes.store(0, std::memory_order_relaxed);
+    if (stopPacket != nullptr) {
+        packetPool.release(stopPacket);
+        stopPacket = nullptr;
+    }
+}
+
+void Communicator::wakeTx() {
+    // 与 waitTx 中的栅栏配对：要么发送线程看到新数据，要么这里看到它在休眠
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (txSleeping.load(std::memory_order_relaxed)) {
+        uint64_t one = 1;
+        (void)!write(txEventFd, &one, sizeof(one));
+    }
+}
+
+void Communicator::waitTx(int timeout_ms) {
+    txSleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    // 休眠前再检查一次，避免错过刚刚到达的数据或 ACK
+    bool work = stopRequested.load(std::memory_order_relaxed) || hasLaneWork() ||
+                latestAck.load(std::memory_order_relaxed) >= 0 || syncReply.load(std::memory_order_relaxed) >= 0 ||
+                connection.load(std::memory_order_relaxed) < 0 || !running.load(std::memory_order_relaxed);
+    if (!work) {
+        struct pollfd pfd = {txEventFd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0) {
+            uint64_t counter;
+            (void)!read(txEventFd, &counter, sizeof(counter));
+        }
+    }
+    txSleeping.store(false, std::memory_order_relaxed);
+}
+
+bool Communicator::enqueue(const Frame& frame, TxPriority priority) {
+    return submit(frame, priority) != 0;
+}
+
+uint64_t Communicator::submit(const Frame& frame, TxPriority priority) {
+    TxRequest request{frame, nextTicket.fetch_add(1, std::memory_order_relaxed)};
+    bool queued = false;
+    switch (priority) {
+        case TxPriority::Setpoint:
+            queued = setpointQueue.push(request);
+            break;
+        case TxPriority::Bulk:
+            queued = bulkQueue.push(request);
+            break;
+        case TxPriority::Diagnostic:
+            queued = diagnosticQueue.push(request);
+            break;
+    }
+    if (!queued) {
+        return 0;
+    }
+    wakeTx();
+    return request.ticket;
+}
+
+bool Communicator::enqueueCommand(const char* command) {
+    Frame frame;
+    if (!makeCommandFrame(frame, 0, command)) {
+        return false; // 超过 FRAME_MAX_PAYLOAD
+    }
+    return enqueue(frame, frame.type == MsgType::Motion ? TxPriority::Setpoint : TxPriority::Diagnostic);
+}
+
+size_t Communicator::enqueueActions(const std::vector<std::string>& actions) {
+    size_t queued = 0;
+    Frame frame;
+    for (const std::string& action : actions) {
+        // 保持顺序，后面的指令不能越过失败的这条
+        if (!makeCommandFrame(frame, 0, action.c_str()) || !enqueue(frame, TxPriority::Bulk)) break;
+        ++queued;
+    }
+    return queued;
+}
+
+void Communicator::emergencyStop() {
+    stopRequestTime.store(monotonicNanos(), std::memory_order_relaxed);
+    stopRequested.store(true, std::memory_order_release);
+    wakeTx();
+}
+
+bool Communicator::dequeue(Frame& frame) {
+    int64_t receiveTime;
+    return dequeue(frame, receiveTime);
+}
+
+bool Communicator::dequeue(Frame& frame, int64_t& receiveTime_ns) {
+    ReceivedFrame received;
+    if (!rxQueue.pop(received)) {
+        return false;
+    }
+    frame = received.frame;
+    receiveTime_ns = received.time_ns;
+    return true;
+}
+
+bool Communicator::waitForFrame(int timeout_ms) {
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeout_ms);
+
+    while (rxQueue.empty()) {
+        if (!isRunning()) return false;
+
+        int remaining = -1;
+        if (timeout_ms >= 0) {
+            auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+            if (left.count() <= 0) return false;
+            remaining = static_cast<int>(left.count());
+        }
+
+        struct pollfd pfd = {rxEventFd, POLLIN, 0};
+        if (poll(&pfd, 1, remaining) > 0) {
+            // 清空 eventfd 计数后再检查队列，不会丢失唤醒；计数可能来自已取走的帧，所以要循环检查
+            uint64_t counter;
+            (void)!read(rxEventFd, &counter, sizeof(counter));
+        }
+    }
+    return true;
+}
+
+void Communicator::rxLoop(int connectionId) {
+    uint8_t buffer[512];
+
+    // 发送线程发现断开时 (写入出错) 连接编号改变，接收线程退出，重连后发送线程启动新的接收线程
+    while (running.load(std::memory_order_acquire) && connection.load(std::memory_order_acquire) == connectionId) {
+        // 有数据时立即返回，没有数据时在 poll() 中休眠
+        int bytesRead = serial.readAvailable(buffer, sizeof(buffer), RX_WAIT_MS);
+        if (bytesRead < 0) {
+            linkFailed("read", connectionId);
+            return;
+        }
+        // 同一批字节中的帧使用同一个接收时间戳
+        processReceived(buffer, static_cast<size_t>(bytesRead), monotonicNanos());
+    }
+}
+
+void Communicator::processReceived(const uint8_t* data, size_t length, int64_t receiveTime) {
+    bool delivered = false;
+    for (size_t i = 0; i < length; ++i) {
+        Frame frame;
+        if (!rxDecoder.push(data[i], frame)) continue;
+        receivedCount.fetch_add(1, std::memory_order_relaxed);
+        // 同一次读取的字节陆续到达：最后一个字节在读取时刻，之前的字节每个早一个字节时间
+        int64_t frameTime = receiveTime - static_cast<int64_t>(length - 1 - i) * byteTime.count();
+        journal.record(JournalDirection::Rx, frame, frameTime);
+        if (frame.type == MsgType::Ack) {
+            // 累计 ACK 只需要最新的一个，交给发送线程处理
+            latestAck.store(frame.seq, std::memory_order_release);
+            wakeTx();
+            continue;
+        }
+        if (frame.type == MsgType::Stop) {
+            // STM32 回显急停：只认正在等待的那一次，重发产生的重复回显忽略
+            int expected = frame.seq;
+            if (stopPendingSeq.compare_exchange_strong(expected, -1, std::memory_order_acq_rel)) {
+                int64_t latency = frameTime - stopPendingTime.load(std::memory_order_relaxed);
+                lastStopLatency.store(latency, std::memory_order_relaxed);
+                storeMax(maxStopLatency, latency);
+                stopConfirmedCount.fetch_add(1, std::memory_order_relaxed);
+            }
+            continue;
+        }
+        if (frame.type == MsgType::Sync) {
+            // 会话同步的回复交给发送线程
+            if (frame.length == SYNC_REPLY_SIZE) {
+                syncReply.store(frame.seq << 8 | frame.payload[0], std::memory_order_release);
+                wakeTx();
+            }
+            continue;
+        }
+        if (frame.type == MsgType::TimeSync) {
+            TimeSyncMessage reply;
+            if (decodeTimeSync(frame, reply)) clockSync.addSample(reply, frameTime);
+            continue;
+        }
+        if (frame.type == MsgType::Telemetry) {
+            // 高频遥测直接写入历史，不占用接收队列。同步后使用 STM32 的采样时刻
+            int64_t sampleTime = frameTime;
+            if (frame.length == TELEMETRY_PAYLOAD_SIZE) clockSync.toHostTime(getU32(frame.payload), sampleTime);
+            telemetryHistory.appendFrame(frame, sampleTime);
+            continue;
+        }
+        if (rxQueue.push(ReceivedFrame{frame, frameTime})) {
+            delivered = true;
+        } else {
+            rxDroppedCount.fetch_add(1, std::memory_order_relaxed); // 调用方处理不过来，丢弃最新帧
+        }
+    }
+    crcErrorCount.store(rxDecoder.crcErrors(), std::memory_order_relaxed);
+
+    if (delivered) {
+        uint64_t one = 1;
+        (void)!write(rxEventFd, &one, sizeof(one));
+    }
+}
+
+bool Communicator::hasLaneWork() const {
+    if (session == SessionState::Unsynced) {
+        // 有帧要发就先开始会话同步
+        return !setpointQueue.empty() || !bulkQueue.empty() || !diagnosticQueue.empty();
+    }
+    if (session == SessionState::Syncing || !hasRoom()) return false;
+    if (!setpointQueue.empty() && sender.canSend()) return true;
+    return sender.inFlight() < lowPriorityWindow && (!bulkQueue.empty() || !diagnosticQueue.empty());
+}
+
+bool Communicator::popLane(TxRequest& request) {
+    // 高优先级先取；窗口只剩留给 Setpoint 的部分时，低优先级的帧留在队列中
+    if (sender.canSend() && setpointQueue.pop(request)) return true;
+    if (sender.inFlight() >= lowPriorityWindow) return false;
+    return bulkQueue.pop(request) || diagnosticQueue.pop(request);
+}
+
+void Communicator::complete(uint64_t ticket) {
+    if (ticket == 0 || !completionsEnabled.load(std::memory_order_relaxed)) return;
+    if (completionQueue.push(ticket)) {
+        completionsToSignal = true; // 本轮循环结束时统一通知一次
+    } else {
+        completionDroppedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void Communicator::releaseAcked(uint8_t oldestSeq, size_t count) {
+    // 确认的帧不再需要重传，归还帧池
+    for (size_t i = 0; i < count; ++i) {
+        size_t slot = static_cast<uint8_t>(oldestSeq + i) % (ReliableSender::MAX_WINDOW + 1);
+        packetPool.release(inFlightPackets[slot]);
+        inFlightPackets[slot] = nullptr;
+        complete(inFlightTickets[slot]);
+    }
+    ackedCount.fetch_add(count, std::memory_order_relaxed);
+}
+
+bool Communicator::hasRoom() const {
+    // 帧池和写队列各留一个位置给急停
+    return packetPool.available() > 1 && txWriteCount < TX_WRITE_QUEUE_SIZE - 1;
+}
+
+bool Communicator::queuePacket(Packet* packet, bool urgent) {
+    if (txWriteCount >= (urgent ? TX_WRITE_QUEUE_SIZE : TX_WRITE_QUEUE_SIZE - 1)) return false;
+    packetPool.retain(packet);
+    if (urgent) {
+        // 插到写队列最前面；最早的帧已经写出一部分时不能打断它，插在它后面
+        txWriteHead = (txWriteHead + TX_WRITE_QUEUE_SIZE - 1) % TX_WRITE_QUEUE_SIZE;
+        size_t second = (txWriteHead + 1) % TX_WRITE_QUEUE_SIZE;
+        if (txWriteOffset > 0) {
+            txWriteQueue[txWriteHead] = txWriteQueue[second];
+            txWriteQueue[second] = packet;
+        } else {
+            txWriteQueue[txWriteHead] = packet;
+        }
+    } else {
+        txWriteQueue[(txWriteHead + txWriteCount) % TX_WRITE_QUEUE_SIZE] = packet;
+    }
+    ++txWriteCount;
+    txWriteBytes += packet->length;
+    return true;
+}
+
+bool Communicator::sendStop(TransportClock::time_point now) {
+    Frame frame;
+    makeFrame(frame, MsgType::Stop, stopSeq, nullptr, 0);
+    Packet* packet = packetPool.acquire(frame);
+    if (packet == nullptr) return false;
+    if (!queuePacket(packet, true)) {
+        packetPool.release(packet);
+        return false;
+    }
+    // 保留 acquire 的引用：引用计数回到 1 时 Stop 帧已经交给串口驱动
+    stopPacket = packet;
+    stopResendAt = now + resendInterval;
+    sentCount.fetch_add(1, std::memory_order_relaxed);
+    journal.record(JournalDirection::Tx, frame,
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    return true;
+}
+
+bool Communicator::sendSync(TransportClock::time_point now) {
+    // 在途窗口：STM32 据此判断哪些帧已经执行
+    uint8_t window[SYNC_REQUEST_SIZE] = {sender.oldestSeq(), static_cast<uint8_t>(sender.oldestSeq() + sender.inFlight())};
+    Frame frame;
+    makeFrame(frame, MsgType::Sync, syncId, window, sizeof(window));
+    syncResendAt = now + resendInterval;
+    Packet* packet = packetPool.acquire(frame);
+    if (packet == nullptr) return false;
+    bool queued = queuePacket(packet);
+    packetPool.release(packet);
+    if (!queued) return false;
+    sentCount.fetch_add(1, std::memory_order_relaxed);
+    journal.record(JournalDirection::Tx, frame,
+                   std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    return true;
+}
+
+bool Communicator::flushTx() {
+    // 驱动中积压的字节越少，急停前面排队的字节越少。积压量按波特率估算 (pty、部分 USB 串口不报告)，
+    // 驱动报告的更多时 (CTS 暂停、USB 转换芯片更慢) 以驱动为准
+    size_t budget = txWriteBytes;
+    auto now = TransportClock::now();
+    if (txWriteCount > 0) {
+        size_t queued = txLineIdle > now ? static_cast<size_t>((txLineIdle - now) / byteTime) : 0;
+        queued = std::max<size_t>(queued, std::max(serial.pendingOutput(), 0));
+        budget = std::min(budget, queued >= txDriverLimit ? 0 : txDriverLimit - queued);
+    }
+    if (budget > 0) {
+        // 待写入的帧一次提交，不拷贝到连续缓冲区
+        struct iovec batch[TX_WRITE_QUEUE_SIZE];
+        size_t count = 0;
+        size_t bytes = 0;
+        for (; count < txWriteCount && bytes < budget; ++count) {
+            Packet* packet = txWriteQueue[(txWriteHead + count) % TX_WRITE_QUEUE_SIZE];
+            size_t offset = count == 0 ? txWriteOffset : 0;
+            batch[count].iov_base = packet->data + offset;
+            batch[count].iov_len = std::min(packet->length - offset, budget - bytes);
+            bytes += batch[count].iov_len;
+        }
+
+        int written = serial.writeVector(batch, static_cast<int>(count), 0);
+        if (written < 0) return false;
+        if (written > 0) {
+            txLastProgress = now;
+            txLineIdle = std::max(txLineIdle, now) + written * byteTime;
+        }
+        txWriteBytes -= static_cast<size_t>(written);
+
+        // 释放完整写出的帧 (在途帧仍被窗口引用，直到收到 ACK)
+        size_t left = static_cast<size_t>(written) + txWriteOffset;
+        while (txWriteCount > 0 && left >= txWriteQueue[txWriteHead]->length) {
+            left -= txWriteQueue[txWriteHead]->length;
+            packetPool.release(txWriteQueue[txWriteHead]);
+            txWriteHead = (txWriteHead + 1) % TX_WRITE_QUEUE_SIZE;
+            --txWriteCount;
+        }
+        txWriteOffset = left;
+    }
+    backlogBytes.store(txWriteBytes, std::memory_order_relaxed);
+    return true;
+}
+
+void Communicator::txLoop() {
+    TxRequest request;
+    constexpr size_t SLOTS = ReliableSender::MAX_WINDOW + 1;
+    unsigned int stopSends = 0; // 当前急停发送的次数
+    // 本轮循环的时间，也作为日志中发送帧的时间戳
+    auto now = TransportClock::now();
+    auto recordSent = [this, &now](const Frame& out) {
+        sentCount.fetch_add(1, std::memory_order_relaxed);
+        journal.record(JournalDirection::Tx, out,
+                       std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count());
+    };
+    // 重传复用窗口中已编码的帧。还在写队列中的帧不必再排一次，写队列满时由下一次超时重传补上
+    auto retransmit = [this, &recordSent](const Frame& out) {
+        Packet* packet = inFlightPackets[out.seq % SLOTS];
+        if (packet != nullptr && packet->refs == 1 && queuePacket(packet)) {
+            recordSent(out);
+        }
+    };
+
+    while (running.load(std::memory_order_acquire)) {
+        // 串口断开：等待设备重新出现，期间应用照常入队
+        if (connection.load(std::memory_order_acquire) < 0 && !reconnect()) return;
+        now = TransportClock::now();
+
+        // 0. 急停优先于一切：新的请求立即发送，没有确认则按重传超时重发 (上一个 Stop 帧写出之后)
+        if (stopRequested.exchange(false, std::memory_order_acq_rel)) {
+            ++stopSeq;
+            stopSends = 0;
+            stopResendAt = now;
+            stopPendingTime.store(stopRequestTime.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            stopPendingSeq.store(stopSeq, std::memory_order_release);
+        }
+        if (stopPendingSeq.load(std::memory_order_acquire) == stopSeq && stopPacket == nullptr &&
+            now >= stopResendAt && sendStop(now)) {
+            if (++stopSends > 1) stopRetransmitCount.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // 1. 处理接收线程转交的累计 ACK
+        int ack = latestAck.exchange(-1, std::memory_order_acq_rel);
+        if (ack >= 0) {
+            uint8_t oldest = sender.oldestSeq();
+            releaseAcked(oldest, sender.onAck(static_cast<uint8_t>(ack), now));
+        }
+
+        // 2. 会话同步：新会话的第一个可靠帧之前、重连之后，先和 STM32 对齐序号
+        if (session == SessionState::Unsynced && (resuming || sender.inFlight() > 0 || hasLaneWork())) {
+            syncReply.store(-1, std::memory_order_relaxed);
+            ++syncId;
+            syncAttempts = 0;
+            syncResendAt = now;
+            session = SessionState::Syncing;
+        }
+        if (session == SessionState::Syncing) {
+            int reply = syncReply.exchange(-1, std::memory_order_acq_rel);
+            if (reply >= 0 && (reply >> 8) == syncId) {
+                // STM32 已经执行了它期望的序号之前的帧 (ACK 随断开丢失)，直接确认；其余在途帧按原序号重放
+                uint8_t oldest = sender.oldestSeq();
+                size_t delivered = sender.resync(static_cast<uint8_t>(reply & 0xFF), now);
+                releaseAcked(oldest, delivered);
+                size_t replayed = sender.replay(now, retransmit);
+                replayedCount.fetch_add(replayed, std::memory_order_relaxed);
+                session = SessionState::Synced;
+                if (resuming) {
+                    resuming = false;
+                    int64_t recovery = monotonicNanos() - connectionLostTime.load(std::memory_order_relaxed);
+                    lastRecoveryTime.store(recovery, std::memory_order_relaxed);
+                    storeMax(maxRecoveryTime, recovery);
+                    std::cout << "[Info] Serial session resumed " << recovery / 1000 << " us after the loss: "
+                              << delivered << " frames in flight had been executed, " << replayed << " replayed."
+                              << std::endl;
+                }
+            } else if (now >= syncResendAt) {
+                if (++syncAttempts > maxSyncAttempts) {
+                    fail("resync (no answer from STM32)");
+                    return;
+                }
+                sendSync(now);
+            }
+        }
+
+        // 3. 最早的在途帧超时则整窗重传 (会话同步期间暂停，由同步后的重放代替)
+        if (session == SessionState::Synced) {
+            retransmitCount.fetch_add(sender.retransmitExpired(now, retransmit), std::memory_order_relaxed);
+            if (sender.failed()) {
+                fail("transport (no ACK from STM32)");
+                return;
+            }
+        }
+
+        // 4. 时钟同步：只在线路空闲时发送，TimeSync 帧不在驱动中排队，发送时间戳才准确
+        if (now >= nextSync && txWriteCount == 0 && txLineIdle <= now) {
+            TimeSyncMessage ping;
+            ping.hostTime_ns = monotonicNanos();
+            Frame syncFrame;
+            makeTimeSyncFrame(syncFrame, syncSeq++, ping);
+            Packet* packet = packetPool.acquire(syncFrame);
+            queuePacket(packet);
+            packetPool.release(packet);
+            recordSent(syncFrame);
+            ++syncsSent;
+            nextSync = now + std::chrono::milliseconds(syncsSent < TIME_SYNC_FAST_COUNT ? TIME_SYNC_FAST_INTERVAL_MS
+                                                                                        : TIME_SYNC_INTERVAL_MS);
+        }
+
+        // 5. 按优先级取新帧，窗口或写队列满时帧留在发送队列中 (背压)
+        while (session == SessionState::Synced && hasRoom() && popLane(request)) {
+            const Frame& out = isReliable(request.frame.type) ? sender.send(request.frame, now) : request.frame;
+            Packet* packet = packetPool.acquire(out);
+            queuePacket(packet);
+            if (isReliable(out.type)) {
+                inFlightPackets[out.seq % SLOTS] = packet; // acquire 的引用归在途窗口所有
+                inFlightTickets[out.seq % SLOTS] = request.ticket;
+            } else {
+                packetPool.release(packet);
+                complete(request.ticket);
+            }
+            recordSent(out);
+        }
+        if (completionsToSignal) {
+            completionsToSignal = false;
+            uint64_t one = 1;
+            (void)!write(completionFd, &one, sizeof(one));
+        }
+        inFlightCount.store(sender.inFlight(), std::memory_order_relaxed);
+
+        // 6. 写入串口驱动能接收的部分，整批帧一次系统调用
+        if (!flushTx()) {
+            linkFailed("write", connection.load(std::memory_order_relaxed));
+            if (!running.load(std::memory_order_acquire)) return;
+            continue; // 重连
+        }
+        if (stopPacket != nullptr && stopPacket->refs == 1) {
+            // Stop 帧已交给串口驱动
+            if (stopSends == 1) {
+                storeMax(maxStopWriteLatency, monotonicNanos() - stopPendingTime.load(std::memory_order_relaxed));
+            }
+            packetPool.release(stopPacket);
+            stopPacket = nullptr;
+        }
+        if (txWriteCount > 0) {
+            // 驱动积压已到上限或 STM32 暂停接收 (CTS)：等驱动排出一部分，急停、ACK 和新帧随时唤醒发送线程
+            if (TransportClock::now() - txLastProgress >= std::chrono::milliseconds(TX_FLOW_WAIT_MS)) {
+                stallCount.fetch_add(1, std::memory_order_relaxed);
+                txLastProgress = TransportClock::now();
+            }
+            waitTx(txDrainWait_ms);
+            continue;
+        }
+
+        // 7. 休眠到有新数据、新 ACK，或重传、急停和 Sync 重发、时钟同步的时间到达 (时钟同步等线路空闲)
+        auto wake = std::max(nextSync, txLineIdle);
+        if (session == SessionState::Syncing) {
+            wake = std::min(wake, syncResendAt);
+        } else if (sender.inFlight() > 0) {
+            wake = std::min(wake, sender.deadline());
+        }
+        if (stopPendingSeq.load(std::memory_order_relaxed) == stopSeq && stopPacket == nullptr) {
+            wake = std::min(wake, stopResendAt);
+        }
+        auto left = std::chrono::ceil<std::chrono::milliseconds>(wake - TransportClock::now());
+        waitTx(static_cast<int>(std::max<long long>(left.count(), 0)));
+    }
+}
+
+// ---------------- 命令行调试工具 ----------------
 
 int communicator_main() {
-    // 1. 创建 serialib 对象
-    serialib serial;
+    // 1. 创建通信子系统对象
+    Communicator link;
 
-    // 2. 打开串口设备
+    // 2. 打开收发日志 (可选)，然后打开串口设备并启动收发线程
+    if (!link.openJournal(JOURNAL_PATH)) {
+        std::cerr << "[Warning] Cannot create journal " << JOURNAL_PATH << ", traffic is not recorded." << std::endl;
+    }
+    // USB 转串口断开时等待它重新出现并恢复会话，而不是退出
+    link.setReconnect(RECONNECT_TIMEOUT_MS);
     // 参数: 设备名称, 波特率
     // serialib 会自动处理 8N1 (8数据位, 无校验, 1停止位) 的默认设置
-    char errorOpening = serial.openDevice(SERIAL_PORT, BAUD_RATE);
+    int errorOpening = link.start(SERIAL_PORT, BAUD_RATE, LOW_LATENCY, FLOW_CONTROL);
 
     // 检查串口是否成功打开
     if (errorOpening != 1) {
         std::cerr << "[Error] Cannot open serial port " << SERIAL_PORT
-                  << ". Error code: " << (int)errorOpening << std::endl;
+                  << ". Error code: " << errorOpening << std::endl;
         std::cerr << "Possible reasons:\n"
                   << "- Port name is incorrect (Did you change SERIAL_PORT in the code?).\n"
                   << "- Device is not connected or powered.\n"
@@ -33,59 +873,72 @@ int communicator_main() {
     }
     std::cout << "[Info] Successfully connected to " << SERIAL_PORT
               << " at " << BAUD_RATE << " bps." << std::endl;
+    if (LOW_LATENCY) {
+        std::cout << "[Info] Low latency features: 0x" << std::hex << link.lowLatencyFeatures() << std::dec << std::endl;
+    }
 
-    // 3. 通信主循环
-    std::cout << "Enter data to send to STM32 (type 'exit' to quit):" << std::endl;
-
-    while (true) {
-        // --- 检查并读取接收到的数据 ---
-        // serialib 提供了多种读取方式，这里使用 readString / readBytes
-        // readBytes 更通用，可以接收任意字节数据
-        char receiveBuffer[256]; // 设定一个接收缓冲区
-        int bytesRead = serial.readBytes(receiveBuffer, sizeof(receiveBuffer) - 1, 10); // 读取最多255字节，超时10ms
-
-        if (bytesRead < 0) {
-            // 读取发生错误 (非超时)
-            std::cerr << "[Error] Error reading from serial port. Code: " << bytesRead << std::endl;
-            // 这里可以根据需要添加错误处理逻辑，比如尝试重新连接或直接退出
-             break; // 简单起见，直接退出循环
-        } else if (bytesRead > 0) {
-            // 成功读取到数据
-            receiveBuffer[bytesRead] = '\0'; // 将缓冲区末尾置零，以便作为字符串处理（如果确定是文本）
-            std::cout << "[Received] Bytes: " << bytesRead << ", Data: " << receiveBuffer << std::endl;
+    // 3. 打印线程：作为接收队列唯一的消费者，收到帧就打印，不受命令行输入阻塞的影响
+    std::thread printer([&link]() {
+        Frame frame;
+        while (link.isRunning()) {
+            if (link.waitForFrame(100)) {
+                while (link.dequeue(frame)) {
+                    printFrame(frame);
+                }
+            }
         }
+    });
 
+    // 4. 命令行输入循环，主线程是发送队列唯一的生产者
+    std::cout << "Enter data to send to STM32 (type 'stop' for emergency stop, 'exit' to quit):" << std::endl;
+
+    while (link.isRunning()) {
         std::string dataToSend;
         std::cout << "> "; // 提示符
-        std::getline(std::cin, dataToSend);
-
-        if (dataToSend == "exit") {
-            break; // 用户输入 exit，退出循环
+        if (!std::getline(std::cin, dataToSend) || dataToSend == "exit") {
+            break; // 输入结束或用户输入 exit，退出循环
         }
-
-        if (!dataToSend.empty()) {
-            // 使用 writeString 发送字符串 (会自动添加空终止符，STM32端需注意处理)
-            // 或者使用 writeBytes 发送原始字节数据
-            std::string stringToSend = "@" + dataToSend;
-            int bytesSent = serial.writeString(stringToSend.c_str());
-            // int bytesSent = serial.writeBytes(dataToSend.data(), dataToSend.length()); // 发送原始字节
-
-            if (bytesSent <= 0) {
-                std::cerr << "[Error] Failed to write data to serial port." << std::endl;
-                 // 这里也可以添加错误处理逻辑
-                 break; // 简单起见，直接退出循环
-            } else {
-                std::cout << "[Sent] " << bytesSent << " bytes: " << dataToSend << std::endl;
-            }
+        if (dataToSend.empty()) {
+            continue;
         }
 
-        // 短暂延时，避免CPU占用过高（尤其是在没有数据收发时）
-        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        if (dataToSend == "stop") {
+            link.emergencyStop(); // 越过所有排队的指令
+            std::cout << "[Stop] Emergency stop sent." << std::endl;
+            continue;
+        }
+        if (!link.enqueueCommand(dataToSend.c_str())) {
+            std::cerr << "[Error] Command longer than " << FRAME_MAX_PAYLOAD
+                      << " bytes or transmit queue full." << std::endl;
+        } else {
+            std::cout << "[Queued] " << dataToSend << std::endl;
+        }
     }
 
-    // 4. 关闭串口
-    serial.closeDevice();
-    std::cout << "[Info] Serial port closed." << std::endl;
+    // 5. 停止收发线程并关闭串口
+    link.stop();
+    printer.join();
+    std::cout << "[Info] Serial port closed. Sent " << link.framesSent()
+              << " frames, received " << link.framesReceived() << " frames ("
+              << link.telemetry().totalSamples() << " telemetry samples, "
+              << link.telemetry().missedSamples() << " missed), "
+              << link.flowStalls() << " flow control stalls. Traffic journal: " << JOURNAL_PATH << std::endl;
+    if (link.stopsConfirmed() > 0) {
+        std::cout << "[Info] Emergency stops confirmed: " << link.stopsConfirmed()
+                  << ", worst-case latency " << link.maxStopLatency_ns() / 1000 << " us (written to driver after "
+                  << link.maxStopWriteLatency_ns() / 1000 << " us), " << link.stopRetransmissions()
+                  << " retransmissions." << std::endl;
+    }
+    if (link.reconnects() > 0) {
+        std::cout << "[Info] Reconnections: " << link.reconnects() << ", worst-case recovery "
+                  << link.maxRecoveryTime_ns() / 1000 << " us (last " << link.lastRecoveryTime_ns() / 1000 << " us), "
+                  << link.framesReplayed() << " frames replayed." << std::endl;
+    }
+    if (link.clock().synchronized()) {
+        std::cout << "[Info] STM32 clock drift " << link.clock().drift_ppm() << " ppm, offset uncertainty "
+                  << link.clock().uncertainty_ns() / 1000 << " us (" << link.clock().samples() << " sync samples)."
+                  << std::endl;
+    }
 
     return 0; // 程序正常退出
-}
\ No newline at end of file
+}
@@ -6,10 +6,308 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <atomic>
 #include <chrono> // 用于延时
 #include <thread> // 用于延时
 #include "serialib.h" // 包含 serialib 头文件
+#include "protocol.h" // 二进制帧协议 (COBS + CRC16)
+#include "spsc_ring.h" // 无锁单生产者/单消费者环形队列
+#include "packet_pool.h" // 预分配的已编码帧池
+#include "transport.h" // 滑动窗口可靠传输 (ACK + 重传)
+#include "telemetry.h" // 里程计/IMU 遥测历史
+#include "clock_sync.h" // Pi 与 STM32 的时钟同步
+#include "monotonic_clock.h"
+#include "frame_journal.h" // 串口收发帧的 mmap 日志
+#include "serial_reactor.h" // 多串口共用的 epoll 事件循环
+
+// 发送优先级，从高到低。每个优先级有自己的发送队列，高优先级的帧在帧边界抢占低优先级的帧。
+// 急停高于所有优先级，不经过队列，见 Communicator::emergencyStop()
+enum class TxPriority : uint8_t {
+    Setpoint,   // 控制设定值：实时运动指令
+    Bulk,       // 批量下发：整条动作序列
+    Diagnostic, // 诊断：调试文本、查询
+};
+
+// 接收队列中的一帧和它的接收时间
+struct ReceivedFrame {
+    Frame frame;
+    int64_t time_ns = 0; // 帧最后一个字节到达的 Pi 单调时间 (monotonicNanos)，按波特率从读取时间倒推
+};
+
+/**
+ * @brief 串口通信子系统：独立的接收线程和发送线程。
+ *
+ * 接收线程一直从串口读取并解码帧，放入接收队列；发送线程从发送队列取帧写入串口。
+ * 应用与两个线程之间只通过无锁 SPSC 队列交换数据，调用方不会阻塞在串口上，
+ * 串口线程也不会等待调用方。
+ *
+ * Motion/Text 帧经过滑动窗口可靠传输：最多 windowSize 帧同时在途，STM32 用累计 ACK 确认，
+ * 超时后整窗重传，因此整条动作序列可以连续下发，不需要每条指令等待一次往返。
+ *
+ * 发送线程把帧编码到预分配的帧池 (PacketPool) 中，每批帧用一次 writev 写入串口 (serialib::writeVector)，
+ * 重传直接复用在途窗口中已编码的帧，稳定运行时发送路径没有任何堆内存分配。
+ * 开启 RTS/CTS 流控后，STM32 暂停接收时帧留在写队列中，发送线程不再从发送队列取帧，
+ * 队列满后 enqueue 返回 false，调用方由此感知背压，而不是无限阻塞或丢字节。
+ *
+ * 发送队列按优先级分为几条通道 (TxPriority)，发送线程每次取帧都先取高优先级通道，
+ * 并为 Setpoint 保留 1/4 的发送窗口，批量下发的动作序列不会让实时指令排到整个窗口之后。
+ * 急停 (emergencyStop) 不占用窗口，插到写队列最前面 (正在写的帧之后)，并限制交给串口驱动但尚未发出的字节数，
+ * 急停前面最多只有几十字节；STM32 回显确认前按重传超时重发，从调用到确认的延迟记录在 maxStopLatency_ns()。
+ *
+ * 调用 openJournal 后，收发的每一帧 (含时间戳) 都写入 mmap 预分配的日志文件，可以用 journal_replay 回放。
+ *
+ * Telemetry 帧不进入接收队列，由接收线程直接解码写入 telemetry() 历史，控制器和定位模块可以无锁读取。
+ *
+ * 每个会话发送第一个 Motion/Text 帧之前，发送线程先用 Sync 帧和 STM32 对齐序号。开启 setReconnect 后，
+ * 串口断开 (USB 转串口拔出、驱动重新枚举) 不再停止通信：发送线程用 inotify 等待设备节点重新出现，
+ * 以相同参数重新打开，再用 Sync 帧得知 STM32 已经执行到哪一帧，只重放没有执行的在途帧，
+ * 断开期间入队的帧照常发送。从断开到会话恢复的时间记录在 maxRecoveryTime_ns()。
+ *
+ * 发送线程在线路空闲时定期发送 TimeSync 帧 (启动后较密，之后每秒一次)，clock() 据此估计 STM32 时钟的
+ * 偏移和漂移。同步后遥测样本的时间是 STM32 采样时刻换算成的 Pi 单调时间，而不是到达时间，
+ * 相机等其他传感器可以直接用 monotonicNanos() 对齐。
+ *
+ * 注意：每个优先级的发送队列只允许一个生产者线程调用 enqueue* (不同优先级可以是不同线程)，
+ * emergencyStop 可以由任意线程调用，接收队列只允许一个消费者线程调用 dequeue/waitForFrame。
+ */
+class Communicator {
+public:
+    static constexpr size_t TX_QUEUE_SIZE = 256;      // Bulk 队列，可以放下整条动作序列
+    static constexpr size_t SETPOINT_QUEUE_SIZE = 32;
+    static constexpr size_t DIAGNOSTIC_QUEUE_SIZE = 32;
+    static constexpr size_t RX_QUEUE_SIZE = 1024;
+    static constexpr size_t TX_POOL_SIZE = 256;       // 已编码帧的数量：在途窗口 + 待写入
+    static constexpr size_t TX_WRITE_QUEUE_SIZE = 128; // 等待写入串口的帧，一次 writev 提交 (最后一个位置留给急停)
+    static constexpr size_t COMPLETION_QUEUE_SIZE = 512; // 已完成、等待事件循环取走的发送票据
+
+    explicit Communicator(const TransportConfig& config = {});
+    ~Communicator();
+    Communicator(const Communicator&) = delete;
+    Communicator& operator=(const Communicator&) = delete;
+
+    // 打开串口并启动收发线程，返回 serialib::openDevice 的错误码 (1 表示成功)
+    // lowLatency: 使用 serialib 低延迟模式 (任意波特率、ASYNC_LOW_LATENCY)
+    // flowControl: RTS/CTS 流控，STM32 接收缓冲区满时拉高 RTS，发送线程暂停而不是丢字节
+    int start(const char* device, unsigned int bauds, bool lowLatency = false,
+              SerialFlowControl flowControl = SERIAL_FLOW_NONE);
+    // 同上，但不创建接收线程：串口注册到 reactor，由它的事件循环线程解码 (与激光雷达等其他串口共用一个线程)
+    int start(SerialReactor& eventLoop, const char* device, unsigned int bauds, bool lowLatency = false,
+              SerialFlowControl flowControl = SERIAL_FLOW_NONE);
+    // 停止线程并关闭串口
+    void stop();
+    // 记录所有收发帧到日志文件 (需在 start() 之前调用)，capacity 为记录条数，写满后覆盖最旧的记录
+    bool openJournal(const char* path, size_t capacity = FrameJournal::DEFAULT_CAPACITY);
+    // 串口断开后等待设备重新出现并恢复会话的最长时间 (需在 start() 之前调用)，0 表示不重连，出错即停止 (默认)
+    void setReconnect(unsigned int timeout_ms) { reconnectTimeout = std::chrono::milliseconds(timeout_ms); }
+    // 线程是否在运行 (串口出错且没有重连成功后会变为 false)
+    bool isRunning() const { return running.load(std::memory_order_acquire); }
+    // 串口是否打开 (重连期间为 false，此时仍然可以入队)
+    bool isConnected() const { return isRunning() && connection.load(std::memory_order_acquire) >= 0; }
+    // 低延迟模式实际生效的功能 (SERIAL_LOW_LATENCY_* 标志)
+    int lowLatencyFeatures() { return serial.lowLatencyFeatures(); }
+
+    // 将一帧放入对应优先级的发送队列，序号由发送线程分配。队列满时返回 false
+    bool enqueue(const Frame& frame, TxPriority priority = TxPriority::Bulk);
+    // 同 enqueue，返回这一帧的票据 (非 0)，队列满时返回 0。开启完成通知后，
+    // 帧被 STM32 确认 (Motion/Text) 或离开发送队列 (其他帧) 时，票据出现在 nextCompletion() 中
+    uint64_t submit(const Frame& frame, TxPriority priority = TxPriority::Bulk);
+    // 动作指令 (如 "F100") 作为 Motion 帧以 Setpoint 优先级发送，其余作为 Text 帧以 Diagnostic 优先级发送
+    bool enqueueCommand(const char* command);
+    // 将 generateActionSequence 生成的整条动作序列以 Bulk 优先级入队，返回成功入队的条数
+    size_t enqueueActions(const std::vector<std::string>& actions);
+    // 急停：立即发送 Stop 帧，越过所有排队的帧和发送窗口，直到 STM32 确认。任意线程可调用，不会阻塞。
+    // 已经排队的动作不会被丢弃，STM32 收到 Stop 后自行清除它的运动队列
+    void emergencyStop();
+    // 最近一次急停还没有收到 STM32 的确认
+    bool stopPending() const {
+        return stopRequested.load(std::memory_order_relaxed) || stopPendingSeq.load(std::memory_order_relaxed) >= 0;
+    }
+
+    // 从接收队列取出一帧，队列为空时返回 false
+    bool dequeue(Frame& frame);
+    // 同上，并返回帧的接收时间 (monotonicNanos)
+    bool dequeue(Frame& frame, int64_t& receiveTime_ns);
+    // 等待接收队列中有数据，超时返回 false。timeout_ms < 0 表示一直等待
+    bool waitForFrame(int timeout_ms);
+    // 接收队列有新帧、通信出错或停止时可读的 eventfd，接收队列的消费者可以把它放进自己的 epoll/poll，
+    // 可读后先 read 清零再 dequeue 到队列为空
+    int receiveEventFd() const { return rxEventFd; }
+
+    // 发送完成通知 (AsyncLink 使用)：只允许一个消费者线程
+    void enableCompletions(bool enable) { completionsEnabled.store(enable, std::memory_order_release); }
+    // 取出一个已完成的票据，没有时返回 false
+    bool nextCompletion(uint64_t& ticket) { return completionQueue.pop(ticket); }
+    // 有新的完成票据时可读的 eventfd，用法同 receiveEventFd
+    int completionEventFd() const { return completionFd; }
+
+    // 遥测历史 (接收线程是唯一的写者，任意线程可以读取)
+    const TelemetryHistory& telemetry() const { return telemetryHistory; }
+    // STM32 时钟到 Pi 单调时钟的换算 (接收线程更新，任意线程可以读取)
+    const ClockSync& clock() const { return clockSync; }
+
+    // 统计信息
+    uint64_t framesSent() const { return sentCount.load(std::memory_order_relaxed); }
+    uint64_t framesReceived() const { return receivedCount.load(std::memory_order_relaxed); }
+    uint64_t rxDropped() const { return rxDroppedCount.load(std::memory_order_relaxed); } // 接收队列满而丢弃的帧
+    uint32_t crcErrors() const { return crcErrorCount.load(std::memory_order_relaxed); }
+    uint64_t framesAcked() const { return ackedCount.load(std::memory_order_relaxed); }
+    uint64_t retransmissions() const { return retransmitCount.load(std::memory_order_relaxed); }
+    size_t framesInFlight() const { return inFlightCount.load(std::memory_order_relaxed); }
+    uint64_t completionsDropped() const { return completionDroppedCount.load(std::memory_order_relaxed); } // 完成队列满而丢弃的票据
+    uint64_t flowStalls() const { return stallCount.load(std::memory_order_relaxed); } // 串口暂停接收 (CTS 或驱动缓冲区满) 的次数
+    size_t txBacklog() const { return backlogBytes.load(std::memory_order_relaxed); }  // 等待写入串口的字节数
+    // 急停统计：调用 emergencyStop() 到 Stop 帧交给串口驱动 (write) / 收到 STM32 确认 (latency) 的时间
+    uint64_t stopsConfirmed() const { return stopConfirmedCount.load(std::memory_order_relaxed); }
+    uint64_t stopRetransmissions() const { return stopRetransmitCount.load(std::memory_order_relaxed); }
+    int64_t lastStopLatency_ns() const { return lastStopLatency.load(std::memory_order_relaxed); }
+    int64_t maxStopLatency_ns() const { return maxStopLatency.load(std::memory_order_relaxed); }
+    int64_t maxStopWriteLatency_ns() const { return maxStopWriteLatency.load(std::memory_order_relaxed); }
+    // 重连统计：从发现串口断开到重新打开并与 STM32 对齐序号 (会话恢复) 的时间，以及恢复后重放的在途帧
+    uint64_t reconnects() const { return reconnectCount.load(std::memory_order_relaxed); }
+    uint64_t framesReplayed() const { return replayedCount.load(std::memory_order_relaxed); }
+    int64_t lastRecoveryTime_ns() const { return lastRecoveryTime.load(std::memory_order_relaxed); }
+    int64_t maxRecoveryTime_ns() const { return maxRecoveryTime.load(std::memory_order_relaxed); }
+
+private:
+    // 发送队列中的一帧和它的票据
+    struct TxRequest {
+        Frame frame;
+        uint64_t ticket = 0;
+    };
+
+    // 会话同步状态 (只由发送线程访问)
+    enum class SessionState : uint8_t {
+        Unsynced, // 新会话或重连后，发送第一个可靠帧之前需要 Sync
+        Syncing,  // Sync 已发出，等待 STM32 回复
+        Synced,
+    };
+
+    int openPort(const char* device, unsigned int bauds, bool lowLatency, SerialFlowControl flowControl);
+    // 用保存的参数打开串口 (start 和重连共用)
+    int openSerial();
+    void rxLoop(int connectionId);
+    // 串口读写出错：开启重连时标记断开并唤醒发送线程，否则 fail()。过时连接的报告被忽略
+    void linkFailed(const char* reason, int connectionId);
+    // 发送线程：等待设备重新出现并打开，重启接收。失败或 stop() 时返回 false
+    bool reconnect();
+    int addToReactor(SerialReactor& eventLoop, int connectionId);
+    bool waitForDevice(TransportClock::time_point deadline);
+    void dropWriteQueue();
+    void releaseAcked(uint8_t oldestSeq, size_t count);
+    bool sendSync(TransportClock::time_point now);
+    // 解码一批收到的字节并分发 (接收线程或 reactor 线程调用)
+    void processReceived(const uint8_t* data, size_t length, int64_t receiveTime);
+    void txLoop();
+    void fail(const char* reason);
+    void wakeTx();
+    void waitTx(int timeout_ms);
+    bool hasLaneWork() const;
+    bool popLane(TxRequest& request);
+    void complete(uint64_t ticket);
+    bool hasRoom() const;
+    bool queuePacket(Packet* packet, bool urgent = false);
+    bool sendStop(TransportClock::time_point now);
+    bool flushTx();
+
+    serialib serial;
+    std::string devicePath;            // 打开串口的参数，重连时使用
+    unsigned int deviceBauds = 0;
+    bool deviceLowLatency = false;
+    SerialFlowControl deviceFlowControl = SERIAL_FLOW_NONE;
+    std::chrono::milliseconds reconnectTimeout{0};
+    int deviceWatchFd = -1;            // inotify 监视设备所在的目录 (第一次重连时创建，只由发送线程访问)
+    std::thread rxThread;
+    std::thread txThread;
+    std::atomic<bool> running{false};
+    std::atomic<int> connection{0};    // 当前串口连接的编号，-1 表示已断开、等待重连
+    int connectionCount = 0;           // 以下只由发送线程访问 (start 时除外)
+    std::atomic<int64_t> connectionLostTime{0}; // 发现断开的 monotonicNanos()
+    bool resuming = false;             // 重连后会话还没有恢复
+    SerialReactor* reactor = nullptr;  // 使用事件循环接收时不为空
+    int reactorId = -1;
+    FrameDecoder rxDecoder;            // 只由接收方 (接收线程或 reactor 线程) 访问
+
+    // 发送队列，每个优先级一条
+    SpscRing<TxRequest, SETPOINT_QUEUE_SIZE> setpointQueue;
+    SpscRing<TxRequest, TX_QUEUE_SIZE> bulkQueue;
+    SpscRing<TxRequest, DIAGNOSTIC_QUEUE_SIZE> diagnosticQueue;
+    std::atomic<uint64_t> nextTicket{1};
+    SpscRing<ReceivedFrame, RX_QUEUE_SIZE> rxQueue;
+    int txEventFd = -1;                // 有新数据入队或收到 ACK 时唤醒发送线程
+    std::atomic<bool> txSleeping{false}; // 发送线程即将休眠，只有此时才需要写 txEventFd
+    int rxEventFd = -1;                // 接收队列有新数据时通知消费者
+
+    // 发送完成通知：发送线程写入，事件循环读取
+    std::atomic<bool> completionsEnabled{false};
+    SpscRing<uint64_t, COMPLETION_QUEUE_SIZE> completionQueue;
+    int completionFd = -1;
+    bool completionsToSignal = false;  // 本轮循环有新的完成票据 (只由发送线程访问)
+
+    ReliableSender sender;             // 只由发送线程访问
+    std::atomic<int> latestAck{-1};    // 接收线程收到的最新累计 ACK，-1 表示没有新的 ACK
+    size_t lowPriorityWindow = 1;      // Bulk/Diagnostic 帧最多占用的窗口，其余留给 Setpoint
+
+    // 急停：emergencyStop() 设置请求，发送线程发出 Stop 帧，接收线程收到回显后清除 stopPendingSeq
+    std::atomic<bool> stopRequested{false};
+    std::atomic<int64_t> stopRequestTime{0};  // 最近一次 emergencyStop() 的 monotonicNanos()
+    std::atomic<int64_t> stopPendingTime{0};  // 正在等待确认的急停的请求时间
+    std::atomic<int> stopPendingSeq{-1};      // 正在等待确认的 Stop 帧序号，-1 表示没有
+    std::chrono::microseconds resendInterval; // Stop、Sync 帧没有回复时的重发间隔
+    uint8_t stopSeq = 0;                      // 以下只由发送线程访问
+    Packet* stopPacket = nullptr;             // 还在写队列中的 Stop 帧
+    TransportClock::time_point stopResendAt;
+
+    // 会话同步：发送线程发出 Sync 帧，接收线程转交 STM32 的回复
+    std::atomic<int> syncReply{-1};   // (Sync 帧序号 << 8) | STM32 期望的下一个序号，-1 表示没有新回复
+    SessionState session = SessionState::Unsynced; // 以下只由发送线程访问
+    uint8_t syncId = 0;
+    unsigned int syncAttempts = 0;
+    unsigned int maxSyncAttempts = 1;
+    TransportClock::time_point syncResendAt;
+
+    // 发送路径 (只由发送线程访问)：帧编码一次存入帧池，写队列和在途窗口引用同一个 Packet
+    PacketPool<TX_POOL_SIZE> packetPool;
+    Packet* inFlightPackets[ReliableSender::MAX_WINDOW + 1] = {}; // 按 seq 索引，等待 ACK 的帧
+    uint64_t inFlightTickets[ReliableSender::MAX_WINDOW + 1] = {}; // 在途帧的票据
+    Packet* txWriteQueue[TX_WRITE_QUEUE_SIZE] = {};
+    size_t txWriteHead = 0;   // 最早的待写入帧
+    size_t txWriteCount = 0;
+    size_t txWriteOffset = 0; // 最早的帧已经写出的字节数
+    size_t txWriteBytes = 0;  // 待写入的总字节数
+    size_t txDriverLimit = 0; // 串口驱动中最多积压的字节数，积压的字节不能被急停抢占
+    std::chrono::nanoseconds byteTime{0};      // 线路传输一个字节的时间 (收发两个方向相同)
+    TransportClock::time_point txLineIdle;     // 按波特率估算，已交给驱动的字节全部发出的时间
+    int txDrainWait_ms = 1;   // 驱动积压达到上限时，等待它排出一部分的时间
+    TransportClock::time_point txLastProgress; // 串口驱动最近一次接收数据的时间
+
+    TelemetryHistory telemetryHistory;
+    ClockSync clockSync;               // 只由接收方写入
+    uint8_t syncSeq = 0;               // 以下只由发送线程访问
+    unsigned int syncsSent = 0;
+    TransportClock::time_point nextSync;
+    FrameJournal journal;              // 收发线程都会写入，record() 无锁
+
+    std::atomic<uint64_t> sentCount{0};
+    std::atomic<uint64_t> receivedCount{0};
+    std::atomic<uint64_t> rxDroppedCount{0};
+    std::atomic<uint32_t> crcErrorCount{0};
+    std::atomic<uint64_t> ackedCount{0};
+    std::atomic<uint64_t> retransmitCount{0};
+    std::atomic<size_t> inFlightCount{0};
+    std::atomic<uint64_t> stallCount{0};
+    std::atomic<size_t> backlogBytes{0};
+    std::atomic<uint64_t> completionDroppedCount{0};
+    std::atomic<uint64_t> stopConfirmedCount{0};
+    std::atomic<uint64_t> stopRetransmitCount{0};
+    std::atomic<int64_t> lastStopLatency{0};
+    std::atomic<int64_t> maxStopLatency{0};
+    std::atomic<int64_t> maxStopWriteLatency{0};
+    std::atomic<uint64_t> reconnectCount{0};
+    std::atomic<uint64_t> replayedCount{0};
+    std::atomic<int64_t> lastRecoveryTime{0};
+    std::atomic<int64_t> maxRecoveryTime{0};
+};
 
 int communicator_main();
 
-#endif
\ No newline at end of file
+#endif
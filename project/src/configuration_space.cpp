@@ -0,0 +1,217 @@
+#include "configuration_space.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// dst = src dilated by s cells along the row (1 <= s <= 63). src[-1] and src[words] are read.
+void shiftOr(uint64_t* dst, const uint64_t* src, int words, int s) {
+    int w = 0;
+#if defined(__SSE2__)
+    const __m128i up = _mm_cvtsi32_si128(s);
+    const __m128i down = _mm_cvtsi32_si128(64 - s);
+    for (; w + 2 <= words; w += 2) {
+        __m128i here = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + w));
+        __m128i previous = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + w - 1));
+        __m128i next = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + w + 1));
+        __m128i towardsEnd = _mm_or_si128(_mm_sll_epi64(here, up), _mm_srl_epi64(previous, down));
+        __m128i towardsStart = _mm_or_si128(_mm_srl_epi64(here, up), _mm_sll_epi64(next, down));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + w),
+                         _mm_or_si128(here, _mm_or_si128(towardsEnd, towardsStart)));
+    }
+#elif defined(__ARM_NEON)
+    // vshlq shifts right for negative counts
+    const int64x2_t up = vdupq_n_s64(s);
+    const int64x2_t upRight = vdupq_n_s64(-s);
+    const int64x2_t down = vdupq_n_s64(64 - s);
+    const int64x2_t downRight = vdupq_n_s64(s - 64);
+    for (; w + 2 <= words; w += 2) {
+        uint64x2_t here = vld1q_u64(src + w);
+        uint64x2_t previous = vld1q_u64(src + w - 1);
+        uint64x2_t next = vld1q_u64(src + w + 1);
+        uint64x2_t towardsEnd = vorrq_u64(vshlq_u64(here, up), vshlq_u64(previous, downRight));
+        uint64x2_t towardsStart = vorrq_u64(vshlq_u64(here, upRight), vshlq_u64(next, down));
+        vst1q_u64(dst + w, vorrq_u64(here, vorrq_u64(towardsEnd, towardsStart)));
+    }
+#endif
+    for (; w < words; ++w) {
+        dst[w] = src[w] | (src[w] << s) | (src[w - 1] >> (64 - s)) | (src[w] >> s) | (src[w + 1] << (64 - s));
+    }
+}
+
+// dst = a | b | c
+void orRows(uint64_t* dst, const uint64_t* a, const uint64_t* b, const uint64_t* c, int words) {
+    int w = 0;
+#if defined(__SSE2__)
+    for (; w + 2 <= words; w += 2) {
+        __m128i value = _mm_or_si128(_mm_loadu_si128(reinterpret_cast<const __m128i*>(a + w)),
+                                     _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + w)));
+        value = _mm_or_si128(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(c + w)));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + w), value);
+    }
+#elif defined(__ARM_NEON)
+    for (; w + 2 <= words; w += 2) {
+        vst1q_u64(dst + w, vorrq_u64(vorrq_u64(vld1q_u64(a + w), vld1q_u64(b + w)), vld1q_u64(c + w)));
+    }
+#endif
+    for (; w < words; ++w) dst[w] = a[w] | b[w] | c[w];
+}
+
+// dst |= src
+void orInto(uint64_t* dst, const uint64_t* src, int words) {
+    orRows(dst, dst, src, src, words);
+}
+
+// 16 cells of a GridMap row to 16 blocked bits
+inline uint32_t packBlocked16(const uint8_t* cells) {
+#if defined(__SSE2__)
+    __m128i values = _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells));
+    return static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(values, _mm_setzero_si128())));
+#else
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; ++i) bits |= static_cast<uint32_t>(cells[i] != GridMap::FREE) << i;
+    return bits;
+#endif
+}
+
+// Bytes of 8 cells (FREE / BLOCKED) for each byte of blocked bits
+struct CellPatterns {
+    uint8_t cells[256][8];
+    CellPatterns() {
+        for (int bits = 0; bits < 256; ++bits) {
+            for (int i = 0; i < 8; ++i) cells[bits][i] = (bits >> i) & 1 ? GridMap::BLOCKED : GridMap::FREE;
+        }
+    }
+};
+const CellPatterns patterns;
+
+} // namespace
+
+ConfigurationSpace::ConfigurationSpace(int radius, Footprint footprint, bool mapEdgeIsObstacle)
+    : footprintRadius(std::max(radius, 0)), shape(footprint), edgeIsObstacle(mapEdgeIsObstacle) {
+    halfWidths.resize(footprintRadius + 1);
+    for (int dy = 0; dy <= footprintRadius; ++dy) {
+        int halfWidth = static_cast<int>(std::sqrt(static_cast<double>(footprintRadius * footprintRadius - dy * dy)));
+        // Exact integer floor of the square root
+        while (halfWidth * halfWidth + dy * dy > footprintRadius * footprintRadius) --halfWidth;
+        while ((halfWidth + 1) * (halfWidth + 1) + dy * dy <= footprintRadius * footprintRadius) ++halfWidth;
+        halfWidths[dy] = halfWidth;
+    }
+}
+
+int ConfigurationSpace::radiusInCells(int radius_mm, int resolution_mm) {
+    if (radius_mm <= 0 || resolution_mm <= 0) return 0;
+    return (radius_mm + resolution_mm - 1) / resolution_mm;
+}
+
+void ConfigurationSpace::packObstacles(const GridMap& map) {
+    width = map.width();
+    height = map.height();
+    words = (width + 63) / 64;
+    rowStride = words + 2;
+    edgeWord = edgeIsObstacle ? ~uint64_t(0) : 0;
+    blocked.resize(static_cast<size_t>(height) * rowStride);
+    scratch.resize(blocked.size());
+    for (int y = 0; y < height; ++y) {
+        const uint8_t* cells = map.row(y);
+        uint64_t* bits = row(blocked, y);
+        bits[-1] = edgeWord;
+        bits[words] = edgeWord;
+        for (int w = 0; w < words; ++w) {
+            int first = w * 64;
+            int count = std::min(64, width - first);
+            uint64_t value = 0;
+            int i = 0;
+            for (; i + 16 <= count; i += 16) value |= static_cast<uint64_t>(packBlocked16(cells + first + i)) << i;
+            for (; i < count; ++i) value |= static_cast<uint64_t>(cells[first + i] != GridMap::FREE) << i;
+            // Cells past the right edge of the map
+            if (count < 64) value |= edgeWord << count;
+            bits[w] = value;
+        }
+    }
+}
+
+void ConfigurationSpace::dilateSquare() {
+    // Along the rows: each pass grows the covered span [-covered, covered] by up to covered + 1
+    for (int covered = 0; covered < footprintRadius;) {
+        int step = std::min({covered + 1, footprintRadius - covered, 63});
+        for (int y = 0; y < height; ++y) {
+            uint64_t* target = row(scratch, y);
+            shiftOr(target, row(blocked, y), words, step);
+            target[-1] = edgeWord;
+            target[words] = edgeWord;
+        }
+        blocked.swap(scratch);
+        covered += step;
+    }
+    // Across the rows, the same way; rows outside the map are edge rows
+    std::vector<uint64_t> edgeRow(rowStride, edgeWord);
+    for (int covered = 0; covered < footprintRadius;) {
+        int step = std::min(covered + 1, footprintRadius - covered);
+        for (int y = 0; y < height; ++y) {
+            const uint64_t* above = y - step >= 0 ? row(blocked, y - step) : edgeRow.data() + 1;
+            const uint64_t* below = y + step < height ? row(blocked, y + step) : edgeRow.data() + 1;
+            uint64_t* target = row(scratch, y);
+            orRows(target, row(blocked, y), above, below, words);
+            target[-1] = edgeWord;
+            target[words] = edgeWord;
+        }
+        blocked.swap(scratch);
+        covered += step;
+    }
+}
+
+void ConfigurationSpace::dilateDisk() {
+    // Each source row, dilated along the row by every half width of the footprint, is ORed into
+    // the output rows at the matching distance
+    std::fill(scratch.begin(), scratch.end(), 0);
+    dilations.resize(static_cast<size_t>(footprintRadius + 1) * rowStride);
+    for (int source = 0; source < height; ++source) {
+        std::copy_n(&blocked[static_cast<size_t>(source) * rowStride], rowStride, dilations.begin());
+        for (int k = 1; k <= footprintRadius; ++k) {
+            uint64_t* target = row(dilations, k);
+            shiftOr(target, row(dilations, k - 1), words, 1);
+            target[-1] = edgeWord;
+            target[words] = edgeWord;
+        }
+        int first = std::max(source - footprintRadius, 0);
+        int last = std::min(source + footprintRadius, height - 1);
+        for (int y = first; y <= last; ++y) {
+            orInto(row(scratch, y), row(dilations, halfWidths[std::abs(y - source)]), words);
+        }
+    }
+    // Outside rows: with the edge as an obstacle, rows closer to it than the radius are blocked
+    if (edgeIsObstacle) {
+        for (int y = 0; y < height; ++y) {
+            if (y < footprintRadius || y >= height - footprintRadius) std::fill_n(row(scratch, y), words, edgeWord);
+        }
+    }
+    blocked.swap(scratch);
+}
+
+void ConfigurationSpace::build(const GridMap& map, GridMap& inflated) {
+    packObstacles(map);
+    if (footprintRadius > 0) {
+        if (shape == Footprint::Square) {
+            dilateSquare();
+        } else {
+            dilateDisk();
+        }
+    }
+    inflated.assign(width, height, [&](int y, uint8_t* cells) {
+        const uint64_t* bits = row(blocked, y);
+        int x = 0;
+        for (; x + 8 <= width; x += 8) {
+            memcpy(cells + x, patterns.cells[(bits[x / 64] >> (x % 64)) & 0xFF], 8);
+        }
+        for (; x < width; ++x) cells[x] = (bits[x / 64] >> (x % 64)) & 1 ? GridMap::BLOCKED : GridMap::FREE;
+    });
+}
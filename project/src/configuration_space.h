@@ -0,0 +1,68 @@
+//
+// Configuration space of the vehicle: the map with its obstacles grown by the vehicle radius.
+//
+// The planners treat the vehicle as a point on a cell; planning on the inflated map keeps the
+// whole chassis clear of the obstacles. Obstacles are dilated on bit-packed rows, 64 cells per
+// word (two per SIMD register: SSE2 on x86, NEON on the Pi), in separable passes: along the rows
+// with shift-OR, then across the rows with OR. The buffers are kept between builds, so the map
+// can be inflated again after every update.
+//
+//   ConfigurationSpace space(ConfigurationSpace::radiusInCells(120, resolution_mm));
+//   space.build(map, inflated);
+//   generateActionSequence(inflated, resolution_mm, start);
+//
+
+#ifndef CONFIGURATION_SPACE_H
+#define CONFIGURATION_SPACE_H
+
+#include <cstdint>
+#include <vector>
+#include "grid_map.h"
+
+class ConfigurationSpace {
+public:
+    enum class Footprint {
+        Disk,   // Cells within radius (euclidean, centre to centre) of the vehicle centre
+        Square, // Cells within radius along both axes: the bounding square, fully separable
+    };
+
+    // radius in cells; the edge of the map counts as an obstacle unless mapEdgeIsObstacle is false
+    explicit ConfigurationSpace(int radius, Footprint footprint = Footprint::Disk, bool mapEdgeIsObstacle = true);
+
+    // Smallest radius in cells that covers radius_mm
+    static int radiusInCells(int radius_mm, int resolution_mm);
+
+    // Write into inflated the cells of map where the footprint centred on the cell hits no obstacle
+    void build(const GridMap& map, GridMap& inflated);
+    GridMap build(const GridMap& map) {
+        GridMap inflated;
+        build(map, inflated);
+        return inflated;
+    }
+
+    int radius() const { return footprintRadius; }
+    Footprint footprint() const { return shape; }
+
+private:
+    // Rows of blocked bits (1 = obstacle), one padding word on each side holding the edge
+    uint64_t* row(std::vector<uint64_t>& grid, int y) { return &grid[static_cast<size_t>(y) * rowStride + 1]; }
+    void packObstacles(const GridMap& map);
+    void dilateSquare();
+    void dilateDisk();
+
+    int footprintRadius;
+    Footprint shape;
+    bool edgeIsObstacle;
+    std::vector<int> halfWidths; // Disk: half width of the footprint at each row offset
+
+    int width = 0;
+    int height = 0;
+    int words = 0;     // Words of map cells per row
+    int rowStride = 0; // words + 2 padding words
+    uint64_t edgeWord = 0;
+    std::vector<uint64_t> blocked;
+    std::vector<uint64_t> scratch;
+    std::vector<uint64_t> dilations; // Disk: one source row dilated by 0 .. radius
+};
+
+#endif //CONFIGURATION_SPACE_H
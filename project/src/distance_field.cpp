@@ -0,0 +1,78 @@
+#include "distance_field.h"
+
+#include "grid_map.h"
+
+namespace {
+
+// Directions in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+
+} // namespace
+
+void DistanceField::build(const GridMap& map, Point goal) {
+    width = map.width();
+    height = map.height();
+    stride = map.stride();
+    goalCell = goal;
+    builtVersion = map.version();
+    built = true;
+    distances.assign(map.dataSize(), UNREACHABLE);
+    if (map.empty() || !map.contains(goal) || !map.isFree(goal)) return;
+
+    const uint8_t* cells = map.data();
+    const int offset[] = {1, stride, -1, -stride};
+    queue.resize(map.freeCount());
+    size_t head = 0;
+    size_t tail = 0;
+    uint32_t origin = map.index(goal.x, goal.y);
+    distances[origin] = 0;
+    queue[tail++] = origin;
+    while (head < tail) {
+        uint32_t current = queue[head++];
+        int32_t distance = distances[current] + 1;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t next = current + offset[i];
+            if (cells[next] != GridMap::FREE || distances[next] != UNREACHABLE) continue;
+            distances[next] = distance;
+            queue[tail++] = next;
+        }
+    }
+}
+
+bool DistanceField::isCurrent(const GridMap& map, Point goal) const {
+    return built && builtVersion == map.version() && goalCell == goal;
+}
+
+void DistanceField::release() {
+    *this = DistanceField();
+}
+
+int32_t DistanceField::distance(Point p) const {
+    if (!built || p.x < 0 || p.x >= width || p.y < 0 || p.y >= height) return UNREACHABLE;
+    return distances[index(p)];
+}
+
+std::vector<Point> DistanceField::pathFrom(Point start) const {
+    std::vector<Point> path;
+    int32_t remaining = distance(start);
+    if (remaining == UNREACHABLE) return path;
+    path.reserve(remaining + 1);
+    path.push_back(start);
+    const int offset[] = {1, stride, -1, -stride};
+    size_t cell = index(start);
+    int heading = -1;
+    while (remaining > 0) {
+        // Every reachable cell but the goal has a neighbour one step closer
+        int step = heading >= 0 && distances[cell + offset[heading]] == remaining - 1 ? heading : -1;
+        for (int i = 0; step < 0; ++i) {
+            if (distances[cell + offset[i]] == remaining - 1) step = i;
+        }
+        heading = step;
+        cell += offset[step];
+        --remaining;
+        Point last = path.back();
+        path.push_back({last.x + dx[step], last.y + dy[step]});
+    }
+    return path;
+}
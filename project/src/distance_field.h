@@ -0,0 +1,56 @@
+//
+// Distance to a goal from every cell of a map (breadth-first search from the goal).
+//
+// Built once per (map version, goal), it answers "how do I get to the goal from here" for any
+// start cell by walking down the distances: O(path length) per query instead of a search.
+// Among the equally short next steps the walk keeps its current heading, so it does not turn
+// more than needed.
+//
+//   DistanceField field;
+//   if (!field.isCurrent(map, goal)) field.build(map, goal);
+//   std::vector<Point> path = field.pathFrom(start);
+//
+
+#ifndef DISTANCE_FIELD_H
+#define DISTANCE_FIELD_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "path_planner.h"
+
+class GridMap;
+
+class DistanceField {
+public:
+    static constexpr int32_t UNREACHABLE = INT32_MAX;
+
+    // Distances of every cell of map to goal (all UNREACHABLE if goal is not a free cell)
+    void build(const GridMap& map, Point goal);
+    // True if the field was built for this goal on this version of the map
+    bool isCurrent(const GridMap& map, Point goal) const;
+    // Free the distances (about 8 bytes per map cell), build() is needed again
+    void release();
+
+    Point goal() const { return goalCell; }
+    uint64_t mapVersion() const { return builtVersion; }
+    // Steps from p to the goal, UNREACHABLE for blocked, unreachable or outside cells
+    int32_t distance(Point p) const;
+    // Shortest path from start to the goal, start and goal included. Empty if unreachable.
+    std::vector<Point> pathFrom(Point start) const;
+
+private:
+    size_t index(Point p) const { return static_cast<size_t>(p.y + 1) * stride + static_cast<size_t>(p.x + 1); }
+
+    // Same bordered layout as the GridMap, borders are UNREACHABLE
+    std::vector<int32_t> distances;
+    std::vector<uint32_t> queue;
+    int width = 0;
+    int height = 0;
+    int stride = 0;
+    Point goalCell;
+    uint64_t builtVersion = 0;
+    bool built = false;
+};
+
+#endif //DISTANCE_FIELD_H
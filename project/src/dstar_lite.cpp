@@ -0,0 +1,172 @@
+#include "dstar_lite.h"
+
+#include <algorithm>
+#include <cstdlib>
+
+namespace {
+
+// Directions in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+
+} // namespace
+
+bool DStarLite::reset(const GridMap& map, Point start, Point goal) {
+    ready = false;
+    expansions = 0;
+    grid = map;
+    if (grid.empty() || !grid.contains(start) || !grid.contains(goal) || !grid.isFree(start) || !grid.isFree(goal)) {
+        return false;
+    }
+    startCell = start;
+    goalCell = goal;
+    startIndex = grid.index(start.x, start.y);
+    goalIndex = grid.index(goal.x, goal.y);
+    int stride = grid.stride();
+    offset[0] = 1;
+    offset[1] = stride;
+    offset[2] = -1;
+    offset[3] = -stride;
+
+    g.assign(grid.dataSize(), INFINITE_COST);
+    rhs.assign(grid.dataSize(), INFINITE_COST);
+    open.reset(grid.dataSize());
+    km = 0;
+    rhs[goalIndex] = 0;
+    open.push(goalIndex, calculateKey(goalIndex));
+    ready = true;
+    return true;
+}
+
+int DStarLite::heuristic(uint32_t cell) const {
+    Point p = grid.pointAt(cell);
+    return std::abs(p.x - startCell.x) + std::abs(p.y - startCell.y);
+}
+
+uint64_t DStarLite::calculateKey(uint32_t cell) const {
+    int distance = std::min(g[cell], rhs[cell]);
+    return (static_cast<uint64_t>(distance + heuristic(cell) + km) << 32) | static_cast<uint32_t>(distance);
+}
+
+int DStarLite::lookahead(uint32_t cell) const {
+    const uint8_t* cells = grid.data();
+    if (cells[cell] != GridMap::FREE) return INFINITE_COST;
+    if (cell == goalIndex) return 0;
+    int best = INFINITE_COST;
+    for (int i = 0; i < 4; ++i) {
+        // A neighbour that was just blocked may still have its old g
+        uint32_t s = cell + offset[i];
+        if (cells[s] == GridMap::FREE) best = std::min(best, g[s] + 1);
+    }
+    return best;
+}
+
+void DStarLite::updateVertex(uint32_t cell) {
+    if (g[cell] != rhs[cell]) {
+        if (open.contains(cell)) {
+            open.update(cell, calculateKey(cell));
+        } else {
+            open.push(cell, calculateKey(cell));
+        }
+    } else {
+        open.erase(cell);
+    }
+}
+
+void DStarLite::computeShortestPath() {
+    const uint8_t* cells = grid.data();
+    while (!open.empty() && (open.topKey() < calculateKey(startIndex) || rhs[startIndex] > g[startIndex])) {
+        uint32_t u = open.top();
+        uint64_t oldKey = open.topKey();
+        uint64_t newKey = calculateKey(u);
+        ++expansions;
+        if (oldKey < newKey) {
+            // Queued before the start moved, its key was a lower bound
+            open.update(u, newKey);
+        } else if (g[u] > rhs[u]) {
+            // Overconsistent: the distance dropped, propagate it to the neighbours
+            g[u] = rhs[u];
+            open.pop();
+            for (int i = 0; i < 4; ++i) {
+                uint32_t s = u + offset[i];
+                if (cells[s] != GridMap::FREE || s == goalIndex) continue;
+                rhs[s] = std::min(rhs[s], g[u] + 1);
+                updateVertex(s);
+            }
+        } else {
+            // Underconsistent: the distance grew, the cells that relied on it look again
+            int oldG = g[u];
+            g[u] = INFINITE_COST;
+            for (int i = 0; i < 4; ++i) {
+                uint32_t s = u + offset[i];
+                if (cells[s] != GridMap::FREE) continue;
+                if (rhs[s] == oldG + 1) rhs[s] = lookahead(s);
+                updateVertex(s);
+            }
+            rhs[u] = lookahead(u);
+            updateVertex(u);
+        }
+    }
+}
+
+std::vector<Point> DStarLite::plan() {
+    std::vector<Point> path;
+    if (!ready || !grid.isFree(startCell)) return path;
+    expansions = 0;
+    computeShortestPath();
+    if (rhs[startIndex] >= INFINITE_COST) return path;
+
+    // Walk down the distances, keeping the direction on ties to avoid needless turns
+    path.reserve(rhs[startIndex] + 1);
+    path.push_back(startCell);
+    uint32_t cell = startIndex;
+    int direction = -1;
+    while (cell != goalIndex && path.size() <= grid.freeCount()) {
+        int best = INFINITE_COST;
+        int bestDirection = -1;
+        for (int i = 0; i < 4; ++i) {
+            int candidate = grid.data()[cell + offset[i]] == GridMap::FREE ? g[cell + offset[i]] : INFINITE_COST;
+            if (candidate < best || (candidate == best && i == direction)) {
+                best = candidate;
+                bestDirection = i;
+            }
+        }
+        if (best >= INFINITE_COST) return {};
+        direction = bestDirection;
+        cell += offset[direction];
+        Point last = path.back();
+        path.push_back({last.x + dx[direction], last.y + dy[direction]});
+    }
+    if (cell != goalIndex) return {};
+    return path;
+}
+
+bool DStarLite::moveStart(Point start) {
+    if (!ready || !grid.contains(start) || !grid.isFree(start)) return false;
+    // Keys queued so far were computed from the old start: raise every future key by the same
+    // bound instead of reordering the queue
+    km += std::abs(start.x - startCell.x) + std::abs(start.y - startCell.y);
+    startCell = start;
+    startIndex = grid.index(start.x, start.y);
+    return true;
+}
+
+size_t DStarLite::updateCells(const std::vector<CellChange>& changes) {
+    if (!ready) return 0;
+    size_t changed = 0;
+    for (const CellChange& change : changes) {
+        if (!grid.contains(change.cell) || !grid.set(change.cell.x, change.cell.y, change.value)) continue;
+        ++changed;
+        // Only the edges of the cell changed: the cell and its neighbours get a new lookahead
+        uint32_t cell = grid.index(change.cell.x, change.cell.y);
+        rhs[cell] = lookahead(cell);
+        updateVertex(cell);
+        for (int i = 0; i < 4; ++i) {
+            uint32_t s = cell + offset[i];
+            if (grid.data()[s] != GridMap::FREE) continue;
+            rhs[s] = lookahead(s);
+            updateVertex(s);
+        }
+    }
+    return changed;
+}
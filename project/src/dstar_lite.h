@@ -0,0 +1,79 @@
+//
+// Incremental shortest-path planner (D* Lite, Koenig & Likhachev 2002).
+//
+// The search runs backwards from the goal and is kept between calls: when cells change (an
+// obstacle seen by the vision side, a cleared passage) only the cells whose distance to the goal
+// is affected are expanded again, and when the vehicle moves the start simply follows it.
+//
+//   DStarLite planner;
+//   planner.reset(map, start, map.endPoint());
+//   std::vector<Point> path = planner.plan();
+//   planner.updateCells({{{12, 7}, GridMap::BLOCKED}});
+//   path = planner.plan();    // repairs the previous search
+//
+// The planner keeps its own copy of the map: changes must be given to updateCells, not to the
+// map passed to reset.
+//
+
+#ifndef DSTAR_LITE_H
+#define DSTAR_LITE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "grid_map.h"
+#include "indexed_heap.h"
+#include "path_planner.h"
+
+// New value of one map cell
+struct CellChange {
+    Point cell;
+    uint8_t value; // GridMap::FREE or GridMap::BLOCKED
+};
+
+class DStarLite {
+public:
+    // Start a new search on a copy of map. Returns false if start or goal is not a free cell.
+    bool reset(const GridMap& map, Point start, Point goal);
+
+    // Shortest path from the current start to the goal, start and goal included.
+    // Empty if the goal is unreachable (or before a successful reset).
+    std::vector<Point> plan();
+
+    // The vehicle moved: plan from start from now on (any free cell, not only the path)
+    bool moveStart(Point start);
+    // Apply cell changes to the planner map. Returns the number of cells that actually changed.
+    size_t updateCells(const std::vector<CellChange>& changes);
+
+    const GridMap& map() const { return grid; }
+    Point start() const { return startCell; }
+    Point goal() const { return goalCell; }
+    // Cells expanded by the last plan(): the whole search after reset, the repair afterwards
+    size_t lastExpansions() const { return expansions; }
+
+private:
+    static constexpr int INFINITE_COST = INT32_MAX / 4;
+
+    // Lexicographic key [min(g, rhs) + h + km, min(g, rhs)] packed in one integer
+    uint64_t calculateKey(uint32_t cell) const;
+    int heuristic(uint32_t cell) const;
+    // rhs from the successors: one step plus the cheapest neighbour distance
+    int lookahead(uint32_t cell) const;
+    void updateVertex(uint32_t cell);
+    void computeShortestPath();
+
+    GridMap grid;
+    Point startCell;
+    Point goalCell;
+    uint32_t startIndex = 0;
+    uint32_t goalIndex = 0;
+    int offset[4] = {};
+    std::vector<int> g;   // Distance to the goal found by the search
+    std::vector<int> rhs; // One-step lookahead of g; the cell is consistent when both are equal
+    IndexedHeap<uint64_t> open;
+    int km = 0;           // Sum of the start moves, keeps the keys of queued cells valid
+    bool ready = false;
+    size_t expansions = 0;
+};
+
+#endif //DSTAR_LITE_H
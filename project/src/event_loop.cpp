@@ -0,0 +1,126 @@
+#include "event_loop.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <iostream>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int MAX_EVENTS = 16;
+
+} // namespace
+
+EventLoop::EventLoop() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd >= 0 && wakeFd >= 0) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = wakeFd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    }
+}
+
+EventLoop::~EventLoop() {
+    // Destroying a suspended task unwinds its awaiters, which may still cancel timers
+    std::vector<void*> remaining(tasks.begin(), tasks.end());
+    for (void* task : remaining) std::coroutine_handle<>::from_address(task).destroy();
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+EventLoop::Detached EventLoop::runDetached(EventLoop& loop, Task<> task) {
+    try {
+        co_await task;
+    } catch (const std::exception& error) {
+        ++loop.failedCount;
+        std::cerr << "[Error] Task failed: " << error.what() << std::endl;
+    } catch (...) {
+        ++loop.failedCount;
+        std::cerr << "[Error] Task failed with an unknown exception." << std::endl;
+    }
+}
+
+void EventLoop::spawn(Task<> task) {
+    runDetached(*this, std::move(task));
+}
+
+EventLoop::TimerId EventLoop::addTimer(Clock::time_point when, Callback callback) {
+    TimerId id(when, nextTimerId++);
+    timers.emplace(id, std::move(callback));
+    return id;
+}
+
+bool EventLoop::cancelTimer(const TimerId& id) {
+    return timers.erase(id) > 0;
+}
+
+bool EventLoop::watch(int fd, Callback onReadable) {
+    if (!isValid() || fd < 0 || !onReadable) return false;
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return false;
+    watchers[fd] = std::move(onReadable);
+    return true;
+}
+
+void EventLoop::unwatch(int fd) {
+    if (watchers.erase(fd) > 0) {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    }
+}
+
+int EventLoop::runTimers() {
+    Clock::time_point now = Clock::now();
+    while (!timers.empty() && timers.begin()->first.first <= now) {
+        // Detach the timer first: the callback may add or cancel timers
+        auto node = timers.extract(timers.begin());
+        node.mapped()();
+    }
+    if (timers.empty()) return -1;
+    auto left = std::chrono::ceil<std::chrono::milliseconds>(timers.begin()->first.first - Clock::now());
+    return static_cast<int>(std::max<long long>(left.count(), 0));
+}
+
+void EventLoop::run() {
+    if (!isValid()) return;
+    struct epoll_event events[MAX_EVENTS];
+
+    while (!stopRequested.load(std::memory_order_acquire) && !tasks.empty()) {
+        int timeout_ms = runTimers();
+        if (stopRequested.load(std::memory_order_acquire) || tasks.empty()) break;
+
+        int count = epoll_wait(epollFd, events, MAX_EVENTS, timeout_ms);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd) {
+                uint64_t counter;
+                (void)!read(wakeFd, &counter, sizeof(counter));
+                continue;
+            }
+            auto it = watchers.find(fd);
+            if (it == watchers.end()) continue; // Unwatched by an earlier callback
+            // The callback may unwatch its own descriptor
+            Callback onReadable = it->second;
+            onReadable();
+        }
+    }
+    // Ready for the next run()
+    stopRequested.store(false, std::memory_order_release);
+}
+
+void EventLoop::stop() {
+    stopRequested.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+}
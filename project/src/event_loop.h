@@ -0,0 +1,121 @@
+//
+// Single-threaded event loop running coroutine tasks (see task.h).
+//
+// Tasks suspend on timers or on file descriptors (eventfd of the Communicator, sockets ...) and
+// are resumed by the loop when the timer expires or the descriptor becomes readable. Any number
+// of tasks, commands and timeouts can be outstanding at once, all served by the thread calling run().
+// Everything except stop() must be called from that thread.
+//
+
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include "task.h"
+
+class EventLoop {
+public:
+    using Clock = std::chrono::steady_clock;
+    using Callback = std::function<void()>;
+    using TimerId = std::pair<Clock::time_point, uint64_t>;
+
+    EventLoop();
+    ~EventLoop();
+    EventLoop(const EventLoop&) = delete;
+    EventLoop& operator=(const EventLoop&) = delete;
+
+    // False if the epoll instance could not be created
+    bool isValid() const { return epollFd >= 0 && wakeFd >= 0; }
+
+    // Start a top-level task. It runs until its first suspension before spawn returns, then
+    // belongs to the loop. Tasks still suspended when the loop is destroyed are destroyed with it.
+    void spawn(Task<> task);
+    size_t activeTasks() const { return tasks.size(); }
+    uint64_t failedTasks() const { return failedCount; } // Tasks ended by an exception
+
+    // Serve timers and descriptors until every spawned task has finished or stop() is called
+    void run();
+    // Make run() return, callable from any thread
+    void stop();
+
+    // Call callback once at the given time (not earlier). The id can be used to cancel it.
+    TimerId addTimer(Clock::time_point when, Callback callback);
+    // Returns false if the timer already fired or was cancelled
+    bool cancelTimer(const TimerId& id);
+
+    // Call onReadable whenever fd is readable (level triggered: it must consume what makes it readable)
+    bool watch(int fd, Callback onReadable);
+    void unwatch(int fd);
+
+    // co_await loop.sleepFor(duration) / sleepUntil(time)
+    class SleepOperation {
+    public:
+        SleepOperation(EventLoop& loop, Clock::time_point when) : loop(loop), when(when) {}
+        ~SleepOperation() {
+            if (armed) loop.cancelTimer(timer);
+        }
+        SleepOperation(const SleepOperation&) = delete;
+        SleepOperation& operator=(const SleepOperation&) = delete;
+
+        bool await_ready() const { return when <= Clock::now(); }
+        void await_suspend(std::coroutine_handle<> waiter) {
+            armed = true;
+            timer = loop.addTimer(when, [this, waiter]() {
+                armed = false;
+                waiter.resume();
+            });
+        }
+        void await_resume() const {}
+
+    private:
+        EventLoop& loop;
+        Clock::time_point when;
+        TimerId timer;
+        bool armed = false;
+    };
+
+    SleepOperation sleepUntil(Clock::time_point when) { return SleepOperation(*this, when); }
+    SleepOperation sleepFor(Clock::duration duration) { return SleepOperation(*this, Clock::now() + duration); }
+
+private:
+    // Coroutine owning a spawned task, registered in tasks while it is alive
+    struct Detached {
+        struct promise_type {
+            promise_type(EventLoop& loop, Task<>&) : loop(loop) {
+                loop.tasks.insert(std::coroutine_handle<promise_type>::from_promise(*this).address());
+            }
+            ~promise_type() { loop.tasks.erase(std::coroutine_handle<promise_type>::from_promise(*this).address()); }
+            Detached get_return_object() { return {}; }
+            std::suspend_never initial_suspend() const noexcept { return {}; }
+            std::suspend_never final_suspend() const noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() {}
+
+            EventLoop& loop;
+        };
+    };
+
+    static Detached runDetached(EventLoop& loop, Task<> task);
+    // Run the timers that are due. Returns the time until the next one in ms, -1 if there is none.
+    int runTimers();
+
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd used by stop()
+    std::atomic<bool> stopRequested{false};
+
+    std::map<TimerId, Callback> timers;
+    uint64_t nextTimerId = 0;
+    std::unordered_map<int, Callback> watchers;
+    std::unordered_set<void*> tasks; // Frame addresses of the Detached coroutines
+    uint64_t failedCount = 0;
+};
+
+#endif //EVENT_LOOP_H
@@ -0,0 +1,114 @@
+#include "frame_journal.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "monotonic_clock.h"
+
+FrameJournal::~FrameJournal() {
+    close();
+}
+
+bool FrameJournal::open(const char* path, size_t recordCapacity) {
+    close();
+    if (recordCapacity == 0) return false;
+
+    // The previous run is usually the one to debug: keep its journal as path.1 instead of truncating it
+    std::string previous = std::string(path) + ".1";
+    if (access(path, F_OK) == 0 && std::rename(path, previous.c_str()) != 0) return false;
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    // Reserve the blocks now: the hot path must never hit ENOSPC or allocate file space
+    mappingSize = sizeof(JournalFileHeader) + recordCapacity * sizeof(JournalFileRecord);
+    if (posix_fallocate(fd, 0, static_cast<off_t>(mappingSize)) != 0 &&
+        ftruncate(fd, static_cast<off_t>(mappingSize)) != 0) {
+        close();
+        return false;
+    }
+    // MAP_POPULATE faults the pages in up front, record() then only touches resident memory
+    mapping = mmap(nullptr, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        mapping = nullptr;
+        close();
+        return false;
+    }
+
+    header = static_cast<JournalFileHeader*>(mapping);
+    memcpy(header->magic, JOURNAL_MAGIC, sizeof(header->magic));
+    header->recordSize = sizeof(JournalFileRecord);
+    header->reserved = 0;
+    header->capacity = recordCapacity;
+    header->startTime_ns = monotonicNanos();
+    header->next = 0;
+    capacity = recordCapacity;
+    records = reinterpret_cast<JournalFileRecord*>(static_cast<uint8_t*>(mapping) + sizeof(JournalFileHeader));
+    return true;
+}
+
+void FrameJournal::close() {
+    if (mapping != nullptr) {
+        msync(mapping, mappingSize, MS_ASYNC);
+        munmap(mapping, mappingSize);
+    }
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    mapping = nullptr;
+    header = nullptr;
+    records = nullptr;
+    capacity = 0;
+    mappingSize = 0;
+}
+
+bool readJournal(const char* path, std::vector<JournalRecord>& out) {
+    out.clear();
+    int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    JournalFileHeader header;
+    struct stat status;
+    bool valid = fstat(fd, &status) == 0 && static_cast<uint64_t>(status.st_size) >= sizeof(header) &&
+                 pread(fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                 memcmp(header.magic, JOURNAL_MAGIC, sizeof(header.magic)) == 0 &&
+                 header.recordSize == sizeof(JournalFileRecord) && header.capacity > 0 &&
+                 // A truncated or corrupt file must not size the allocation
+                 header.capacity <= (static_cast<uint64_t>(status.st_size) - sizeof(header)) / sizeof(JournalFileRecord);
+    std::vector<JournalFileRecord> slots;
+    if (valid) {
+        slots.resize(header.capacity);
+        size_t bytes = slots.size() * sizeof(JournalFileRecord);
+        valid = pread(fd, slots.data(), bytes, sizeof(header)) == static_cast<ssize_t>(bytes);
+    }
+    ::close(fd);
+    if (!valid) return false;
+
+    // Keep the committed records that are really in their slot, in recording order
+    std::vector<const JournalFileRecord*> committed;
+    for (size_t index = 0; index < slots.size(); ++index) {
+        const JournalFileRecord& slot = slots[index];
+        if (slot.commit != 0 && (slot.commit - 1) % header.capacity == index &&
+            slot.length <= FRAME_MAX_PAYLOAD) {
+            committed.push_back(&slot);
+        }
+    }
+    std::sort(committed.begin(), committed.end(),
+              [](const JournalFileRecord* a, const JournalFileRecord* b) { return a->commit < b->commit; });
+
+    out.reserve(committed.size());
+    for (const JournalFileRecord* slot : committed) {
+        JournalRecord record;
+        record.time_ns = slot->time_ns;
+        record.direction = static_cast<JournalDirection>(slot->direction);
+        record.frame.type = static_cast<MsgType>(slot->type);
+        record.frame.seq = slot->seq;
+        record.frame.length = slot->length;
+        memcpy(record.frame.payload, slot->payload, slot->length);
+        out.push_back(record);
+    }
+    return true;
+}
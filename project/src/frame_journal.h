@@ -0,0 +1,111 @@
+//
+// Always-on record of the frames crossing the UART, for post-mortem analysis and replay.
+//
+// The journal is a preallocated file mapped in memory and used as a ring of fixed-size records:
+// recording a frame is a copy into the mapping, without system call, lock or allocation, and the
+// kernel writes the pages back in the background. The file survives a crash of the program.
+//
+// File layout: JournalFileHeader, then `capacity` JournalFileRecord slots. A record is valid when
+// its commit field equals its sequence number + 1, which is written last.
+//
+
+#ifndef FRAME_JOURNAL_H
+#define FRAME_JOURNAL_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include "protocol.h"
+
+enum class JournalDirection : uint8_t {
+    Tx = 0, // Pi -> STM32
+    Rx = 1, // STM32 -> Pi
+};
+
+// One journal entry, as returned by readJournal
+struct JournalRecord {
+    int64_t time_ns = 0; // monotonicNanos() when the frame was sent or received
+    JournalDirection direction = JournalDirection::Tx;
+    Frame frame;
+};
+
+constexpr char JOURNAL_MAGIC[8] = {'V', 'S', 'J', 'O', 'U', 'R', 'N', '1'};
+
+struct JournalFileHeader {
+    char magic[8];
+    uint32_t recordSize;
+    uint32_t reserved;
+    uint64_t capacity;           // Number of record slots
+    int64_t startTime_ns;        // monotonicNanos() when the journal was opened
+    alignas(64) uint64_t next;   // Sequence number of the next record, updated atomically
+};
+
+struct JournalFileRecord {
+    uint64_t commit; // Sequence number + 1 once the record is complete, 0 if never written
+    int64_t time_ns;
+    uint8_t direction;
+    uint8_t type;
+    uint8_t seq;
+    uint8_t length;
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint8_t padding[4];
+};
+static_assert(sizeof(JournalFileRecord) == 88, "Journal record layout must not depend on the compiler");
+
+/**
+ * @brief Writer side of the journal. record() may be called concurrently by the serial threads.
+ */
+class FrameJournal {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 1 << 16; // About 5.5 MB, several minutes of traffic
+
+    FrameJournal() = default;
+    ~FrameJournal();
+    FrameJournal(const FrameJournal&) = delete;
+    FrameJournal& operator=(const FrameJournal&) = delete;
+
+    // Create the journal file and map it. An existing file at path is first renamed to path.1 (replacing
+    // the one before), so the journal of the previous run survives a restart. Returns false on I/O errors.
+    bool open(const char* path, size_t capacity = DEFAULT_CAPACITY);
+    // Unmap and close; the records already written stay in the file
+    void close();
+    bool isOpen() const { return records != nullptr; }
+
+    // Append a frame, overwriting the oldest record when the journal is full. Lock-free.
+    void record(JournalDirection direction, const Frame& frame, int64_t time_ns) {
+        if (records == nullptr) return;
+        uint64_t sequence = std::atomic_ref<uint64_t>(header->next).fetch_add(1, std::memory_order_relaxed);
+        JournalFileRecord& slot = records[sequence % capacity];
+        // Invalidate first, so a reader never mixes the old and new contents of the slot
+        std::atomic_ref<uint64_t>(slot.commit).store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        slot.time_ns = time_ns;
+        slot.direction = static_cast<uint8_t>(direction);
+        slot.type = static_cast<uint8_t>(frame.type);
+        slot.seq = frame.seq;
+        slot.length = frame.length;
+        memcpy(slot.payload, frame.payload, frame.length);
+        std::atomic_ref<uint64_t>(slot.commit).store(sequence + 1, std::memory_order_release);
+    }
+
+    // Number of frames recorded since open (including the overwritten ones)
+    uint64_t recorded() const {
+        return header ? std::atomic_ref<uint64_t>(header->next).load(std::memory_order_relaxed) : 0;
+    }
+
+private:
+    int fd = -1;
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+    JournalFileHeader* header = nullptr;
+    JournalFileRecord* records = nullptr;
+    size_t capacity = 0;
+};
+
+// Load the complete records of a journal file, oldest first. Returns false if the file is not a journal
+// or is shorter than its header says.
+bool readJournal(const char* path, std::vector<JournalRecord>& out);
+
+#endif //FRAME_JOURNAL_H
@@ -0,0 +1,102 @@
+#include "grid_map.h"
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// Versions are unique across maps, a cache keyed by version cannot confuse two maps
+uint64_t nextVersion() {
+    static std::atomic<uint64_t> counter{0};
+    return counter.fetch_add(1, std::memory_order_relaxed) + 1;
+}
+
+} // namespace
+
+GridMap::GridMap(int width, int height, uint8_t fill) {
+    resize(width, height);
+    this->fill(fill);
+}
+
+void GridMap::resize(int width, int height) {
+    width = std::max(width, 0);
+    height = std::max(height, 0);
+    if (width == 0 || height == 0) width = height = 0;
+    if (width == cols && height == rows && !cells.empty()) return;
+    cols = width;
+    rows = height;
+    rowStride = (cols + 2 + ROW_ALIGN - 1) / ROW_ALIGN * ROW_ALIGN;
+    cells.assign(static_cast<size_t>(rows + 2) * rowStride, BLOCKED);
+}
+
+void GridMap::recount() {
+    size_t count = 0;
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* cell = row(y);
+        for (int x = 0; x < cols; ++x) count += cell[x] == FREE;
+    }
+    freeCells = count;
+    findEndPoint();
+    currentVersion = nextVersion();
+}
+
+GridMap GridMap::fromMatrix(const std::vector<std::vector<int>>& mapMatrix) {
+    if (mapMatrix.empty()) return GridMap();
+    int width = mapMatrix[0].size();
+    for (const std::vector<int>& line : mapMatrix) {
+        if (static_cast<int>(line.size()) != width) return GridMap();
+    }
+    GridMap map;
+    map.assign(width, mapMatrix.size(), [&](int y, uint8_t* cell) {
+        const int* value = mapMatrix[y].data();
+        for (int x = 0; x < width; ++x) cell[x] = value[x] == 1 ? FREE : BLOCKED;
+    });
+    return map;
+}
+
+std::vector<std::vector<int>> GridMap::toMatrix() const {
+    std::vector<std::vector<int>> mapMatrix(rows, std::vector<int>(cols));
+    for (int y = 0; y < rows; ++y) {
+        const uint8_t* cell = row(y);
+        std::copy(cell, cell + cols, mapMatrix[y].begin());
+    }
+    return mapMatrix;
+}
+
+bool GridMap::set(int x, int y, uint8_t value) {
+    value = value == FREE ? FREE : BLOCKED;
+    uint8_t& cell = cells[index(x, y)];
+    if (cell == value) return false;
+    cell = value;
+    currentVersion = nextVersion();
+    if (value == FREE) {
+        ++freeCells;
+        // A new free cell can only move the end point down or right
+        if (y > cachedEnd.y || (y == cachedEnd.y && x > cachedEnd.x)) cachedEnd = {x, y};
+    } else {
+        --freeCells;
+        if (cachedEnd == Point{x, y}) findEndPoint();
+    }
+    return true;
+}
+
+void GridMap::fill(uint8_t value) {
+    value = value == FREE ? FREE : BLOCKED;
+    for (int y = 0; y < rows; ++y) std::fill_n(&cells[index(0, y)], cols, value);
+    freeCells = value == FREE ? static_cast<size_t>(cols) * rows : 0;
+    cachedEnd = value == FREE ? Point{cols - 1, rows - 1} : Point{};
+    currentVersion = nextVersion();
+}
+
+void GridMap::findEndPoint() {
+    cachedEnd = Point{};
+    for (int y = rows - 1; y >= 0 && freeCells > 0; --y) {
+        const uint8_t* cell = row(y);
+        for (int x = cols - 1; x >= 0; --x) {
+            if (cell[x] == FREE) {
+                cachedEnd = {x, y};
+                return;
+            }
+        }
+    }
+}
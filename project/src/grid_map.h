@@ -0,0 +1,98 @@
+//
+// Occupancy grid shared by the path planners.
+//
+// Cells are bytes (BLOCKED / FREE, FREE being the '1' path cells of the old map matrices) stored
+// row after row in one allocation. Every row is surrounded by blocked cells: one column on each
+// side and one row above and below, so a planner can look at the 4 neighbours of any cell without
+// bounds checks. Rows are padded to a multiple of ROW_ALIGN bytes.
+//
+// The map keeps what planners used to recompute on every call: the default end point
+// (bottom-most, then right-most free cell), the number of free cells, and a version that changes
+// whenever a cell does, so derived data (search caches, distance fields) can tell it is stale.
+//
+
+#ifndef GRID_MAP_H
+#define GRID_MAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "path_planner.h"
+
+class GridMap {
+public:
+    static constexpr uint8_t BLOCKED = 0;
+    static constexpr uint8_t FREE = 1;
+    static constexpr int ROW_ALIGN = 16;
+
+    GridMap() = default;
+    // width x height cells, all set to fill
+    GridMap(int width, int height, uint8_t fill = BLOCKED);
+
+    // Adapters from/to the map matrices (1 = path, anything else is blocked).
+    // Rows of different lengths are an error: an empty map is returned.
+    static GridMap fromMatrix(const std::vector<std::vector<int>>& mapMatrix);
+    std::vector<std::vector<int>> toMatrix() const;
+
+    int width() const { return cols; }
+    int height() const { return rows; }
+    bool empty() const { return cols == 0 || rows == 0; }
+    // Distance in bytes between vertically adjacent cells
+    int stride() const { return rowStride; }
+
+    bool contains(int x, int y) const { return x >= 0 && x < cols && y >= 0 && y < rows; }
+    bool contains(Point p) const { return contains(p.x, p.y); }
+    // Valid from -1 to width / height included (border cells are blocked)
+    uint8_t at(int x, int y) const { return cells[index(x, y)]; }
+    bool isFree(int x, int y) const { return at(x, y) == FREE; }
+    bool isFree(Point p) const { return at(p.x, p.y) == FREE; }
+
+    // Offset of a cell in data(); neighbours are at index +/- 1 and +/- stride()
+    size_t index(int x, int y) const {
+        return static_cast<size_t>(y + 1) * rowStride + static_cast<size_t>(x + 1);
+    }
+    Point pointAt(size_t index) const {
+        return {static_cast<int>(index % rowStride) - 1, static_cast<int>(index / rowStride) - 1};
+    }
+    // All cells, border and padding included: (height() + 2) * stride() bytes
+    const uint8_t* data() const { return cells.data(); }
+    size_t dataSize() const { return cells.size(); }
+    const uint8_t* row(int y) const { return &cells[index(0, y)]; }
+
+    // Change one cell (x, y must be inside the map). Returns false if it already had that value.
+    bool set(int x, int y, uint8_t value);
+    // Change every cell
+    void fill(uint8_t value);
+    // Replace the whole map: fillRow(y, cells) writes the width cells of row y (FREE or BLOCKED).
+    // Reuses the storage when the size does not change, and changes the version once.
+    template <typename FillRow>
+    void assign(int width, int height, FillRow&& fillRow) {
+        resize(width, height);
+        for (int y = 0; y < rows; ++y) fillRow(y, &cells[index(0, y)]);
+        recount();
+    }
+
+    // Bottom-most, then right-most free cell, {-1, -1} if there is none
+    Point endPoint() const { return cachedEnd; }
+    size_t freeCount() const { return freeCells; }
+    // Changes whenever a cell does. Maps with different contents never share a version.
+    uint64_t version() const { return currentVersion; }
+
+private:
+    // Size the storage for width x height cells, the border blocked
+    void resize(int width, int height);
+    // Free cells, end point and version after the cells were written directly
+    void recount();
+    // Scan up from the bottom row: short unless the bottom of the map is blocked
+    void findEndPoint();
+
+    int cols = 0;
+    int rows = 0;
+    int rowStride = 0;
+    std::vector<uint8_t> cells;
+    size_t freeCells = 0;
+    uint64_t currentVersion = 0;
+    Point cachedEnd;
+};
+
+#endif //GRID_MAP_H
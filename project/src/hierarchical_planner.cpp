@@ -0,0 +1,262 @@
+#include "hierarchical_planner.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <unordered_map>
+
+namespace {
+
+// Directions in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+
+// Entrances at least this wide get a transition at each end instead of one in the middle
+constexpr int WIDE_ENTRANCE = 6;
+
+// Same open list order as the A* planner
+inline uint64_t openKey(int f, int g) {
+    return (static_cast<uint64_t>(f) << 32) | (UINT32_MAX - static_cast<uint32_t>(g));
+}
+
+inline int manhattan(Point a, Point b) {
+    return std::abs(a.x - b.x) + std::abs(a.y - b.y);
+}
+
+} // namespace
+
+HierarchicalPlanner::HierarchicalPlanner(int clusterSize) : clusterSize(std::max(clusterSize, 2)) {
+    size_t localSize = static_cast<size_t>(this->clusterSize + 2) * (this->clusterSize + 2);
+    localCells.resize(localSize);
+    localDistance.resize(localSize);
+    localMove.resize(localSize);
+    localQueue.resize(localSize);
+}
+
+void HierarchicalPlanner::build(const GridMap& map) {
+    grid = map;
+    loadedCluster = -1;
+    clustersX = (grid.width() + clusterSize - 1) / clusterSize;
+    clustersY = (grid.height() + clusterSize - 1) / clusterSize;
+    nodes.clear();
+    clusterNodes.assign(static_cast<size_t>(clustersX) * clustersY, {});
+    edges = 0;
+
+    // Entrances on the right and bottom border of every cluster
+    std::unordered_map<size_t, uint32_t> nodeAtCell;
+    auto addNode = [&](Point cell) {
+        auto [it, added] = nodeAtCell.emplace(grid.index(cell.x, cell.y), static_cast<uint32_t>(nodes.size()));
+        if (added) {
+            nodes.push_back({cell, clusterOf(cell), {}});
+            clusterNodes[nodes.back().cluster].push_back(it->second);
+        }
+        return it->second;
+    };
+    auto addEntrances = [&](Point first, int length, Point along, Point across) {
+        int runStart = -1;
+        for (int i = 0; i <= length; ++i) {
+            Point inside = {first.x + along.x * i, first.y + along.y * i};
+            bool open = i < length && grid.isFree(inside) && grid.isFree(inside.x + across.x, inside.y + across.y);
+            if (open && runStart < 0) runStart = i;
+            if (open || runStart < 0) continue;
+            int runLength = i - runStart;
+            int positions[2] = {runStart + runLength / 2, -1};
+            if (runLength >= WIDE_ENTRANCE) {
+                positions[0] = runStart;
+                positions[1] = i - 1;
+            }
+            for (int position : positions) {
+                if (position < 0) continue;
+                Point a = {first.x + along.x * position, first.y + along.y * position};
+                uint32_t from = addNode(a);
+                uint32_t to = addNode({a.x + across.x, a.y + across.y});
+                nodes[from].edges.push_back({to, 1});
+                nodes[to].edges.push_back({from, 1});
+                edges += 2;
+            }
+            runStart = -1;
+        }
+    };
+    for (int cy = 0; cy < clustersY; ++cy) {
+        for (int cx = 0; cx < clustersX; ++cx) {
+            int x0 = cx * clusterSize;
+            int y0 = cy * clusterSize;
+            int columns = std::min(clusterSize, grid.width() - x0);
+            int lines = std::min(clusterSize, grid.height() - y0);
+            if (cx + 1 < clustersX) addEntrances({x0 + clusterSize - 1, y0}, lines, {0, 1}, {1, 0});
+            if (cy + 1 < clustersY) addEntrances({x0, y0 + clusterSize - 1}, columns, {1, 0}, {0, 1});
+        }
+    }
+
+    // Distances between the nodes of each cluster, without leaving it
+    for (size_t cluster = 0; cluster < clusterNodes.size(); ++cluster) {
+        const std::vector<uint32_t>& members = clusterNodes[cluster];
+        for (uint32_t from : members) {
+            searchCluster(nodes[from].cell, cluster);
+            for (uint32_t to : members) {
+                int distance = clusterDistance(nodes[to].cell);
+                if (to == from || distance < 0) continue;
+                nodes[from].edges.push_back({to, distance});
+                ++edges;
+            }
+        }
+    }
+
+    // Room for the start and goal nodes added by the queries
+    stamp.assign(nodes.size() + 2, 0);
+    searchStamp = 0;
+    gScore.resize(nodes.size() + 2);
+    parent.resize(nodes.size() + 2);
+    open.reset(nodes.size() + 2);
+    built = true;
+    builtVersion = map.version();
+}
+
+void HierarchicalPlanner::loadCluster(int cluster) {
+    if (cluster == loadedCluster) return;
+    loadedCluster = cluster;
+    int x0 = (cluster % clustersX) * clusterSize;
+    int y0 = (cluster / clustersX) * clusterSize;
+    int columns = std::min(clusterSize, grid.width() - x0);
+    int lines = std::min(clusterSize, grid.height() - y0);
+    clusterOrigin = {x0, y0};
+    // Cells outside the cluster (border and the missing part of the last clusters) stay blocked
+    std::fill(localCells.begin(), localCells.end(), GridMap::BLOCKED);
+    for (int y = 0; y < lines; ++y) {
+        std::copy_n(grid.row(y0 + y) + x0, columns, &localCells[localIndex({x0, y0 + y})]);
+    }
+}
+
+void HierarchicalPlanner::searchCluster(Point from, int cluster) {
+    loadCluster(cluster);
+    std::fill(localDistance.begin(), localDistance.end(), -1);
+    const int stride = clusterSize + 2;
+    const int offset[] = {1, stride, -1, -stride};
+    size_t head = 0;
+    size_t tail = 0;
+    uint32_t origin = localIndex(from);
+    localDistance[origin] = 0;
+    localQueue[tail++] = origin;
+    while (head < tail) {
+        uint32_t current = localQueue[head++];
+        int distance = localDistance[current] + 1;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t next = current + offset[i];
+            if (localCells[next] != GridMap::FREE || localDistance[next] >= 0) continue;
+            localDistance[next] = distance;
+            localMove[next] = i;
+            localQueue[tail++] = next;
+        }
+    }
+}
+
+int HierarchicalPlanner::clusterDistance(Point p) const {
+    return localDistance[localIndex(p)];
+}
+
+bool HierarchicalPlanner::refine(Point from, Point to, int cluster, std::vector<Point>& path) {
+    searchCluster(from, cluster);
+    int distance = clusterDistance(to);
+    if (distance < 0) return false;
+    size_t end = path.size() + distance;
+    path.resize(end);
+    Point cell = to;
+    for (size_t i = end; cell != from;) {
+        path[--i] = cell;
+        uint8_t move = localMove[localIndex(cell)];
+        cell = {cell.x - dx[move], cell.y - dy[move]};
+    }
+    return true;
+}
+
+void HierarchicalPlanner::release() {
+    // The cluster buffers only depend on the cluster size and are kept
+    *this = HierarchicalPlanner(clusterSize);
+}
+
+std::vector<Point> HierarchicalPlanner::findPath(Point start, Point goal) {
+    std::vector<Point> path;
+    expansions = 0;
+    if (!built || !grid.contains(start) || !grid.contains(goal) || !grid.isFree(start) || !grid.isFree(goal)) {
+        return path;
+    }
+    if (start == goal) return {start};
+
+    // Temporary nodes for start and goal, linked to the nodes of their clusters
+    const uint32_t startNode = nodes.size();
+    const uint32_t goalNode = startNode + 1;
+    int startCluster = clusterOf(start);
+    int goalCluster = clusterOf(goal);
+    nodes.push_back({start, startCluster, {}});
+    nodes.push_back({goal, goalCluster, {}});
+    searchCluster(start, startCluster);
+    for (uint32_t member : clusterNodes[startCluster]) {
+        int distance = clusterDistance(nodes[member].cell);
+        if (distance >= 0) nodes[startNode].edges.push_back({member, distance});
+    }
+    if (goalCluster == startCluster && clusterDistance(goal) >= 0) {
+        nodes[startNode].edges.push_back({goalNode, clusterDistance(goal)});
+    }
+    std::vector<uint32_t> linked;
+    searchCluster(goal, goalCluster);
+    for (uint32_t member : clusterNodes[goalCluster]) {
+        int distance = clusterDistance(nodes[member].cell);
+        if (distance < 0) continue;
+        nodes[member].edges.push_back({goalNode, distance});
+        linked.push_back(member);
+    }
+
+    // A* on the abstract graph
+    if (searchStamp >= UINT32_MAX - 2) {
+        std::fill(stamp.begin(), stamp.end(), 0);
+        searchStamp = 0;
+    }
+    searchStamp += 2;
+    const uint32_t seen = searchStamp;
+    const uint32_t closed = seen + 1;
+    open.clear();
+    stamp[startNode] = seen;
+    gScore[startNode] = 0;
+    open.push(startNode, openKey(manhattan(start, goal), 0));
+    while (!open.empty()) {
+        uint32_t current = open.pop();
+        if (current == goalNode) break;
+        stamp[current] = closed;
+        ++expansions;
+        for (const Edge& edge : nodes[current].edges) {
+            int g = gScore[current] + edge.cost;
+            if (stamp[edge.to] == closed || (stamp[edge.to] == seen && g >= gScore[edge.to])) continue;
+            stamp[edge.to] = seen;
+            gScore[edge.to] = g;
+            parent[edge.to] = current;
+            open.push(edge.to, openKey(g + manhattan(nodes[edge.to].cell, goal), g));
+        }
+    }
+
+    // Refine the abstract path cluster by cluster
+    if (stamp[goalNode] == seen) {
+        std::vector<uint32_t> route;
+        for (uint32_t node = goalNode; node != startNode; node = parent[node]) route.push_back(node);
+        path.reserve(gScore[goalNode] + 1);
+        path.push_back(start);
+        Point at = start;
+        int cluster = startCluster;
+        for (auto it = route.rbegin(); it != route.rend(); ++it) {
+            const Node& next = nodes[*it];
+            if (next.cell == at) continue;
+            if (next.cluster != cluster) {
+                // Transition: the two nodes face each other across the border
+                path.push_back(next.cell);
+            } else if (!refine(at, next.cell, cluster, path)) {
+                path.clear();
+                break;
+            }
+            at = next.cell;
+            cluster = next.cluster;
+        }
+    }
+
+    for (uint32_t member : linked) nodes[member].edges.pop_back();
+    nodes.pop_back();
+    nodes.pop_back();
+    return path;
+}
@@ -0,0 +1,96 @@
+//
+// Hierarchical path planner (HPA*, Botea, Müller & Schaeffer 2004) for large site maps.
+//
+// build() splits the map into square clusters and finds the entrances between neighbouring
+// clusters: every run of free cells along a shared border gets one transition (two for long runs),
+// a pair of abstract nodes facing each other. Inside each cluster, the distances between its
+// nodes are precomputed. A query connects start and goal to the nodes of their own clusters,
+// runs A* on this small abstract graph, then refines only the chosen abstract edges into cells,
+// one cluster at a time. Query time follows the number of clusters crossed, not the map area.
+//
+// Paths are close to the shortest (transitions are fixed points on the borders), not always
+// equal to it. The planner keeps a copy of the map: build() again after the map changes
+// (mapVersion() tells which version the abstraction describes).
+//
+
+#ifndef HIERARCHICAL_PLANNER_H
+#define HIERARCHICAL_PLANNER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "grid_map.h"
+#include "indexed_heap.h"
+#include "path_planner.h"
+
+class HierarchicalPlanner {
+public:
+    static constexpr int DEFAULT_CLUSTER_SIZE = 32;
+
+    explicit HierarchicalPlanner(int clusterSize = DEFAULT_CLUSTER_SIZE);
+
+    // Build the clusters, entrances and intra-cluster distances of map
+    void build(const GridMap& map);
+    uint64_t mapVersion() const { return builtVersion; }
+    bool isBuilt() const { return built; }
+    // Free the abstraction and the search buffers, build() is needed again
+    void release();
+
+    // Near-shortest path from start to goal, start and goal included. Empty if unreachable.
+    std::vector<Point> findPath(Point start, Point goal);
+
+    size_t nodeCount() const { return nodes.size(); }
+    size_t edgeCount() const { return edges; }
+    // Abstract nodes expanded by the last findPath
+    size_t lastExpansions() const { return expansions; }
+
+private:
+    struct Edge {
+        uint32_t to;
+        int cost;
+    };
+    struct Node {
+        Point cell;
+        int cluster;
+        std::vector<Edge> edges;
+    };
+
+    int clusterOf(Point p) const { return (p.y / clusterSize) * clustersX + p.x / clusterSize; }
+    // Copy the cells of cluster into localCells, framed by blocked cells
+    void loadCluster(int cluster);
+    uint32_t localIndex(Point p) const {
+        return (p.y - clusterOrigin.y + 1) * (clusterSize + 2) + (p.x - clusterOrigin.x + 1);
+    }
+    // Breadth-first search from `from` that does not leave cluster
+    void searchCluster(Point from, int cluster);
+    // Distance from the origin of the last searchCluster to a cell of that cluster, -1 if unreached
+    int clusterDistance(Point p) const;
+    // Append the cells after from, up to and including to, of a shortest path inside cluster
+    bool refine(Point from, Point to, int cluster, std::vector<Point>& path);
+
+    GridMap grid;
+    int clusterSize;
+    int clustersX = 0;
+    int clustersY = 0;
+    bool built = false;
+    uint64_t builtVersion = 0;
+    std::vector<Node> nodes;
+    std::vector<std::vector<uint32_t>> clusterNodes; // Abstract nodes of each cluster
+    size_t edges = 0;
+
+    // Search buffers
+    int loadedCluster = -1;
+    Point clusterOrigin;                 // Top-left cell of the loaded cluster
+    std::vector<uint8_t> localCells;     // Loaded cluster with a blocked frame
+    std::vector<int> localDistance;      // By local cell, -1 if unreached
+    std::vector<uint8_t> localMove;      // Move that reached the cell
+    std::vector<uint32_t> localQueue;
+    std::vector<uint32_t> stamp; // Abstract search number: searchStamp seen, searchStamp + 1 closed
+    uint32_t searchStamp = 0;
+    std::vector<int> gScore;
+    std::vector<uint32_t> parent;
+    IndexedHeap<uint64_t> open;
+    size_t expansions = 0;
+};
+
+#endif //HIERARCHICAL_PLANNER_H
@@ -0,0 +1,140 @@
+//
+// Binary min-heap of integer ids with decrease-key, used as the open list of the path planners.
+//
+// Ids are dense (0 .. capacity-1, e.g. a cell index); the heap keeps the position of every id so
+// that lowering the key of a queued id is O(log n) instead of pushing a duplicate entry. Storage is
+// allocated by reset() only: a planner keeps one heap and reuses it between searches.
+//
+
+#ifndef INDEXED_HEAP_H
+#define INDEXED_HEAP_H
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+template <typename Key, typename Compare = std::less<Key>>
+class IndexedHeap {
+public:
+    static constexpr uint32_t NOT_QUEUED = UINT32_MAX;
+
+    explicit IndexedHeap(size_t capacity = 0) { reset(capacity); }
+
+    // Empty the heap and accept ids below capacity
+    void reset(size_t capacity) {
+        entries.clear();
+        positions.assign(capacity, NOT_QUEUED);
+    }
+    // Empty the heap, O(size) instead of O(capacity)
+    void clear() {
+        for (const Entry& entry : entries) positions[entry.id] = NOT_QUEUED;
+        entries.clear();
+    }
+
+    size_t capacity() const { return positions.size(); }
+    size_t size() const { return entries.size(); }
+    bool empty() const { return entries.empty(); }
+    bool contains(uint32_t id) const { return positions[id] != NOT_QUEUED; }
+    // Key of a queued id
+    const Key& keyOf(uint32_t id) const { return entries[positions[id]].key; }
+
+    uint32_t top() const { return entries.front().id; }
+    const Key& topKey() const { return entries.front().key; }
+
+    // Queue id, or lower its key if it is already queued with a worse one.
+    // Returns false if the id was queued with a key at least as good (nothing changed).
+    bool push(uint32_t id, const Key& key) {
+        uint32_t position = positions[id];
+        if (position == NOT_QUEUED) {
+            position = static_cast<uint32_t>(entries.size());
+            entries.push_back({key, id});
+        } else if (compare(key, entries[position].key)) {
+            entries[position].key = key;
+        } else {
+            return false;
+        }
+        siftUp(position);
+        return true;
+    }
+
+    // Set the key of a queued id whatever its direction (D* Lite raises keys as well)
+    void update(uint32_t id, const Key& key) {
+        uint32_t position = positions[id];
+        bool lower = compare(key, entries[position].key);
+        entries[position].key = key;
+        if (lower) {
+            siftUp(position);
+        } else {
+            siftDown(position);
+        }
+    }
+
+    uint32_t pop() {
+        uint32_t id = entries.front().id;
+        removeAt(0);
+        return id;
+    }
+
+    // Remove a queued id, no-op if it is not queued
+    void erase(uint32_t id) {
+        if (contains(id)) removeAt(positions[id]);
+    }
+
+private:
+    struct Entry {
+        Key key;
+        uint32_t id;
+    };
+
+    void removeAt(uint32_t position) {
+        positions[entries[position].id] = NOT_QUEUED;
+        Entry last = entries.back();
+        entries.pop_back();
+        if (position == entries.size()) return;
+        bool lower = compare(last.key, entries[position].key);
+        entries[position] = last;
+        positions[last.id] = position;
+        if (lower) {
+            siftUp(position);
+        } else {
+            siftDown(position);
+        }
+    }
+
+    // Hole-based sifts: the moving entry is written once, at its final position
+    void siftUp(uint32_t position) {
+        Entry moving = entries[position];
+        while (position > 0) {
+            uint32_t parent = (position - 1) / 2;
+            if (!compare(moving.key, entries[parent].key)) break;
+            entries[position] = entries[parent];
+            positions[entries[position].id] = position;
+            position = parent;
+        }
+        entries[position] = moving;
+        positions[moving.id] = position;
+    }
+
+    void siftDown(uint32_t position) {
+        Entry moving = entries[position];
+        size_t count = entries.size();
+        while (true) {
+            size_t child = 2 * static_cast<size_t>(position) + 1;
+            if (child >= count) break;
+            if (child + 1 < count && compare(entries[child + 1].key, entries[child].key)) ++child;
+            if (!compare(entries[child].key, moving.key)) break;
+            entries[position] = entries[child];
+            positions[entries[position].id] = position;
+            position = static_cast<uint32_t>(child);
+        }
+        entries[position] = moving;
+        positions[moving.id] = position;
+    }
+
+    std::vector<Entry> entries;
+    std::vector<uint32_t> positions; // Index in entries by id, NOT_QUEUED if absent
+    Compare compare;
+};
+
+#endif //INDEXED_HEAP_H
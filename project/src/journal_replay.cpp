@@ -0,0 +1,94 @@
+#include "journal_replay.h"
+
+#include <algorithm>
+#include <poll.h>
+#include <unistd.h>
+#include "monotonic_clock.h"
+
+JournalReplayer::JournalReplayer(std::vector<JournalRecord> records, double speed) : speed(speed) {
+    for (JournalRecord& record : records) {
+        if (record.direction == JournalDirection::Rx) rxFrames.push_back(record);
+    }
+}
+
+JournalReplayer::~JournalReplayer() {
+    stop();
+}
+
+bool JournalReplayer::start() {
+    stop();
+    if (!pty.open()) return false;
+    hostDecoder.reset();
+    replayedCount.store(0, std::memory_order_relaxed);
+    hostCount.store(0, std::memory_order_relaxed);
+    done.store(false, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    worker = std::thread(&JournalReplayer::run, this);
+    return true;
+}
+
+void JournalReplayer::stop() {
+    running.store(false, std::memory_order_release);
+    if (worker.joinable()) worker.join();
+    pty.close();
+}
+
+void JournalReplayer::drainHost(int64_t wait_ns) {
+    struct pollfd pfd = {pty.master, POLLIN, 0};
+    struct timespec timeout = {0, 0};
+    if (wait_ns > 0) {
+        timeout.tv_sec = static_cast<time_t>(wait_ns / 1'000'000'000LL);
+        timeout.tv_nsec = static_cast<long>(wait_ns % 1'000'000'000LL);
+    }
+    if (ppoll(&pfd, 1, &timeout, nullptr) <= 0 || !(pfd.revents & POLLIN)) return;
+
+    uint8_t buffer[512];
+    ssize_t received = read(pty.master, buffer, sizeof(buffer));
+    for (ssize_t i = 0; i < received; ++i) {
+        Frame frame;
+        if (hostDecoder.push(buffer[i], frame)) hostCount.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+bool JournalReplayer::writeAll(const uint8_t* data, size_t length) {
+    while (length > 0 && running.load(std::memory_order_acquire)) {
+        ssize_t written = write(pty.master, data, length);
+        if (written > 0) {
+            data += written;
+            length -= static_cast<size_t>(written);
+            continue;
+        }
+        // The host is not reading fast enough: wait for room, keep draining what it sends
+        struct pollfd pfd = {pty.master, POLLOUT, 0};
+        poll(&pfd, 1, 10);
+        drainHost(-1);
+    }
+    return length == 0;
+}
+
+void JournalReplayer::run() {
+    // Replay times are relative to the first frame, so the session starts right away
+    int64_t firstTime = rxFrames.empty() ? 0 : rxFrames.front().time_ns;
+    int64_t startTime = monotonicNanos();
+
+    for (const JournalRecord& record : rxFrames) {
+        if (speed > 0) {
+            int64_t due = startTime + static_cast<int64_t>(static_cast<double>(record.time_ns - firstTime) / speed);
+            int64_t now;
+            while ((now = monotonicNanos()) < due && running.load(std::memory_order_acquire)) {
+                drainHost(std::min<int64_t>(due - now, 50'000'000));
+            }
+        }
+        if (!running.load(std::memory_order_acquire)) return;
+
+        uint8_t encoded[FRAME_MAX_ENCODED];
+        size_t length = encodeFrame(record.frame, encoded, sizeof(encoded));
+        if (!writeAll(encoded, length)) return;
+        replayedCount.fetch_add(1, std::memory_order_relaxed);
+    }
+    done.store(true, std::memory_order_release);
+
+    while (running.load(std::memory_order_acquire)) {
+        drainHost(50'000'000);
+    }
+}
@@ -0,0 +1,60 @@
+//
+// Replay of a recorded serial session (see frame_journal.h).
+//
+// The replayer plays the STM32: it opens a pseudo-terminal and writes the received (Rx) frames of the
+// journal to it with their original timing, scaled by a speed factor, or as fast as the pty accepts.
+// The host code opens devicePath() like the real port, so the whole receive path is exercised.
+// Frames written by the host during the replay are decoded and counted, not answered.
+//
+
+#ifndef JOURNAL_REPLAY_H
+#define JOURNAL_REPLAY_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+#include "frame_journal.h"
+#include "pseudo_terminal.h"
+
+class JournalReplayer {
+public:
+    // speed: 1.0 replays at the recorded pace, 2.0 twice as fast, 0 as fast as possible
+    explicit JournalReplayer(std::vector<JournalRecord> records, double speed = 1.0);
+    ~JournalReplayer();
+    JournalReplayer(const JournalReplayer&) = delete;
+    JournalReplayer& operator=(const JournalReplayer&) = delete;
+
+    // Create the pty and start replaying. Returns false if the pty cannot be created.
+    // Open devicePath() before the first recorded frame is due, or it is lost in the pty.
+    bool start();
+    void stop();
+
+    const std::string& devicePath() const { return pty.path; }
+    // All the Rx frames have been written
+    bool finished() const { return done.load(std::memory_order_acquire); }
+
+    uint64_t framesToReplay() const { return rxFrames.size(); }
+    uint64_t framesReplayed() const { return replayedCount.load(std::memory_order_relaxed); }
+    uint64_t hostFrames() const { return hostCount.load(std::memory_order_relaxed); }
+
+private:
+    void run();
+    // Decode what the host wrote, wait at most until the deadline (negative: do not wait)
+    void drainHost(int64_t wait_ns);
+    bool writeAll(const uint8_t* data, size_t length);
+
+    std::vector<JournalRecord> rxFrames;
+    double speed;
+    PseudoTerminal pty;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> done{false};
+    FrameDecoder hostDecoder;
+
+    std::atomic<uint64_t> replayedCount{0};
+    std::atomic<uint64_t> hostCount{0};
+};
+
+#endif //JOURNAL_REPLAY_H
@@ -0,0 +1,222 @@
+#include "jump_point_search.h"
+
+#include <bit>
+#include <cstdint>
+#include <cstdlib>
+#include "bit_grid.h"
+#include "grid_map.h"
+#include "indexed_heap.h"
+
+namespace {
+
+// Directions in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+constexpr uint8_t NO_DIRECTION = 4;
+constexpr int NO_JUMP = INT32_MIN;
+
+inline bool isHorizontal(uint8_t direction) { return direction == 0 || direction == 2; }
+
+// Same open list order as the A* planner
+inline uint64_t openKey(int f, int g) {
+    return (static_cast<uint64_t>(f) << 32) | (UINT32_MAX - static_cast<uint32_t>(g));
+}
+
+// Reused by the searches of a thread. Cell states are stamped with the search number,
+// so nothing proportional to the map is cleared between searches. Released after maps above
+// PLANNER_RETAINED_CELLS.
+struct JumpBuffers {
+    BitGrid grid;
+    std::vector<uint32_t> stamp;    // searchStamp: seen, searchStamp + 1: closed, older: unseen
+    std::vector<int> gScore;
+    std::vector<uint32_t> parent;   // Previous jump point
+    std::vector<uint8_t> direction; // Direction of the jump that reached the cell
+    IndexedHeap<uint64_t> open;
+    uint32_t searchStamp = 0;
+};
+thread_local JumpBuffers jumpBuffers;
+
+class Jumper {
+public:
+    Jumper(const BitGrid& grid, Point goal) : grid(grid), goal(goal) {}
+
+    // Jump from (x, y) along the row. Returns the x of the jump point, NO_JUMP on a dead end.
+    // A cell is a jump point if it is the goal or if it has a forced neighbour: a free cell above
+    // or below whose counterpart behind is blocked, so no vertical-first path could reach it.
+    int jumpHorizontal(int x, int y, int step) const {
+        const uint64_t* cells = grid.row(y);
+        const uint64_t* above = grid.row(y - 1);
+        const uint64_t* below = grid.row(y + 1);
+        int words = grid.stride();
+        int bit = x + 1 + step; // Bit of the first cell to look at
+        int stop = -1;
+        if (step > 0) {
+            uint64_t mask = ~uint64_t(0) << (bit % 64);
+            for (int w = bit / 64; w < words; ++w, mask = ~uint64_t(0)) {
+                // Cells behind are at bit - 1
+                uint64_t aboveBehind = (above[w] << 1) | (w > 0 ? above[w - 1] >> 63 : 0);
+                uint64_t belowBehind = (below[w] << 1) | (w > 0 ? below[w - 1] >> 63 : 0);
+                uint64_t forced = (above[w] & ~aboveBehind) | (below[w] & ~belowBehind);
+                uint64_t hits = (~cells[w] | forced) & mask;
+                if (hits) {
+                    stop = w * 64 + std::countr_zero(hits);
+                    break;
+                }
+            }
+        } else {
+            uint64_t mask = ~uint64_t(0) >> (63 - bit % 64);
+            for (int w = bit / 64; w >= 0; --w, mask = ~uint64_t(0)) {
+                // Cells behind are at bit + 1
+                uint64_t aboveBehind = (above[w] >> 1) | (w + 1 < words ? above[w + 1] << 63 : 0);
+                uint64_t belowBehind = (below[w] >> 1) | (w + 1 < words ? below[w + 1] << 63 : 0);
+                uint64_t forced = (above[w] & ~aboveBehind) | (below[w] & ~belowBehind);
+                uint64_t hits = (~cells[w] | forced) & mask;
+                if (hits) {
+                    stop = w * 64 + 63 - std::countl_zero(hits);
+                    break;
+                }
+            }
+        }
+        // The border bits are blocked, a scan always stops
+        int stopX = stop - 1;
+        if (y == goal.y && (goal.x - x) * step > 0 && (stopX - goal.x) * step >= 0) return goal.x;
+        return grid.isFree(stopX, y) ? stopX : NO_JUMP;
+    }
+
+    // Jump from (x, y) along the column. Returns the y of the jump point, NO_JUMP on a dead end.
+    // Horizontal moves are natural after a vertical one: a cell is a jump point if a row scan
+    // from it finds one.
+    int jumpVertical(int x, int y, int step) const {
+        while (true) {
+            y += step;
+            if (!grid.isFree(x, y)) return NO_JUMP;
+            if (x == goal.x && y == goal.y) return y;
+            if (jumpHorizontal(x, y, 1) != NO_JUMP || jumpHorizontal(x, y, -1) != NO_JUMP) return y;
+        }
+    }
+
+    // Jump point reached from (x, y) in a direction, if any
+    bool jump(Point from, uint8_t direction, Point& to) const {
+        if (isHorizontal(direction)) {
+            int x = jumpHorizontal(from.x, from.y, dx[direction]);
+            if (x == NO_JUMP) return false;
+            to = {x, from.y};
+        } else {
+            int y = jumpVertical(from.x, from.y, dy[direction]);
+            if (y == NO_JUMP) return false;
+            to = {from.x, y};
+        }
+        return true;
+    }
+
+    // Directions worth exploring from a jump point reached in direction arrival (bit per direction)
+    unsigned successors(Point p, uint8_t arrival) const {
+        if (arrival == NO_DIRECTION) return 0xF;
+        if (!isHorizontal(arrival)) {
+            // Straight on, and both horizontal directions
+            return (1u << arrival) | 0x5;
+        }
+        unsigned directions = 1u << arrival;
+        int behind = p.x - dx[arrival];
+        // Turning is only needed where the cell behind could not have turned first
+        if (grid.isFree(p.x, p.y + 1) && !grid.isFree(behind, p.y + 1)) directions |= 1u << 1;
+        if (grid.isFree(p.x, p.y - 1) && !grid.isFree(behind, p.y - 1)) directions |= 1u << 3;
+        return directions;
+    }
+
+private:
+    const BitGrid& grid;
+    Point goal;
+};
+
+std::vector<Point> searchJumpPointPath(const GridMap& map, Point start, Point goal, JumpBuffers& buffers) {
+    std::vector<Point> path;
+    if (map.empty() || !map.contains(start) || !map.contains(goal) || !map.isFree(start) || !map.isFree(goal)) {
+        return path;
+    }
+
+    // Maps with different contents never share a version
+    if (buffers.grid.version() != map.version()) buffers.grid.assign(map);
+    size_t cells = map.dataSize();
+    if (buffers.stamp.size() < cells) {
+        buffers.stamp.assign(cells, 0);
+        buffers.gScore.resize(cells);
+        buffers.parent.resize(cells);
+        buffers.direction.resize(cells);
+        buffers.searchStamp = 0;
+    }
+    if (buffers.searchStamp >= UINT32_MAX - 2) {
+        std::fill(buffers.stamp.begin(), buffers.stamp.end(), 0);
+        buffers.searchStamp = 0;
+    }
+    buffers.searchStamp += 2;
+    if (buffers.open.capacity() < cells) {
+        buffers.open.reset(cells);
+    } else {
+        buffers.open.clear();
+    }
+    const uint32_t seen = buffers.searchStamp;
+    const uint32_t closed = seen + 1;
+    uint32_t* stamp = buffers.stamp.data();
+    int* gScore = buffers.gScore.data();
+    uint32_t* parent = buffers.parent.data();
+    uint8_t* direction = buffers.direction.data();
+    IndexedHeap<uint64_t>& open = buffers.open;
+
+    Jumper jumper(buffers.grid, goal);
+    auto heuristic = [&](Point p) { return std::abs(p.x - goal.x) + std::abs(p.y - goal.y); };
+    uint32_t startIndex = map.index(start.x, start.y);
+    uint32_t goalIndex = map.index(goal.x, goal.y);
+    stamp[startIndex] = seen;
+    gScore[startIndex] = 0;
+    parent[startIndex] = startIndex;
+    direction[startIndex] = NO_DIRECTION;
+    open.push(startIndex, openKey(heuristic(start), 0));
+
+    while (!open.empty()) {
+        uint32_t current = open.pop();
+        if (current == goalIndex) break;
+        stamp[current] = closed;
+        Point p = map.pointAt(current);
+        unsigned directions = jumper.successors(p, direction[current]);
+        for (uint8_t d = 0; d < 4; ++d) {
+            Point next;
+            if (!(directions & (1u << d)) || !jumper.jump(p, d, next)) continue;
+            uint32_t nextIndex = map.index(next.x, next.y);
+            int g = gScore[current] + std::abs(next.x - p.x) + std::abs(next.y - p.y);
+            if (stamp[nextIndex] == closed || (stamp[nextIndex] == seen && g >= gScore[nextIndex])) continue;
+            stamp[nextIndex] = seen;
+            gScore[nextIndex] = g;
+            parent[nextIndex] = current;
+            direction[nextIndex] = d;
+            open.push(nextIndex, openKey(g + heuristic(next), g));
+        }
+    }
+    if (stamp[goalIndex] != seen) return path;
+
+    // Fill the straight segments between jump points, from the goal back to the start
+    path.resize(gScore[goalIndex] + 1);
+    size_t i = path.size();
+    uint32_t index = goalIndex;
+    path[--i] = goal;
+    while (index != startIndex) {
+        Point to = map.pointAt(index);
+        Point from = map.pointAt(parent[index]);
+        int stepX = (from.x > to.x) - (from.x < to.x);
+        int stepY = (from.y > to.y) - (from.y < to.y);
+        for (Point cell = to; cell != from;) {
+            cell = {cell.x + stepX, cell.y + stepY};
+            path[--i] = cell;
+        }
+        index = parent[index];
+    }
+    return path;
+}
+
+} // namespace
+
+std::vector<Point> findJumpPointPath(const GridMap& map, Point start, Point goal) {
+    std::vector<Point> path = searchJumpPointPath(map, start, goal, jumpBuffers);
+    if (map.dataSize() > PLANNER_RETAINED_CELLS) jumpBuffers = JumpBuffers();
+    return path;
+}
@@ -0,0 +1,23 @@
+//
+// Jump point search for 4-connected uniform-cost grids.
+//
+// Among the many shortest paths of an open grid, only canonical ones are expanded: vertical
+// moves first, horizontal moves once a vertical scan sees something worth turning for. Cells
+// in between are skipped by jumping along rows and columns until a jump point (a cell where a
+// shortest path may have to turn, or the goal), so open areas cost a handful of heap operations
+// instead of one per cell. Rows are scanned 64 cells at a time on a bit-packed copy of the map,
+// rebuilt only when the map version changes.
+//
+
+#ifndef JUMP_POINT_SEARCH_H
+#define JUMP_POINT_SEARCH_H
+
+#include <vector>
+#include "path_planner.h"
+
+class GridMap;
+
+// Same result as findShortestPath (a shortest path, start and goal included, empty if unreachable)
+std::vector<Point> findJumpPointPath(const GridMap& map, Point start, Point goal);
+
+#endif //JUMP_POINT_SEARCH_H
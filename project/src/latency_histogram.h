@@ -0,0 +1,83 @@
+//
+// Log-linear latency histogram (HDR style) used by the benchmarks.
+//
+// Values below SUB_BUCKETS are counted exactly. Above, every power of two is split into SUB_BUCKETS
+// linear buckets, so a percentile is reported with a relative error below 1 / SUB_BUCKETS whatever
+// the magnitude, with a fixed table and no allocation when recording.
+//
+
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+
+class LatencyHistogram {
+public:
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr uint64_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKETS = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    // Record one value (e.g. nanoseconds). Negative values are counted as 0.
+    void record(int64_t value) {
+        uint64_t v = value > 0 ? static_cast<uint64_t>(value) : 0;
+        ++counts[bucketOf(v)];
+        ++total;
+        sum += v;
+        minimum = std::min(minimum, v);
+        maximum = std::max(maximum, v);
+    }
+
+    void reset() {
+        std::fill(std::begin(counts), std::end(counts), 0);
+        total = 0;
+        sum = 0;
+        minimum = std::numeric_limits<uint64_t>::max();
+        maximum = 0;
+    }
+
+    uint64_t count() const { return total; }
+    uint64_t min() const { return total ? minimum : 0; }
+    uint64_t max() const { return maximum; }
+    double mean() const { return total ? static_cast<double>(sum) / static_cast<double>(total) : 0.0; }
+
+    // Upper bound of the bucket holding the given quantile (0.5 = median, 0.999 = p99.9)
+    uint64_t percentile(double quantile) const {
+        if (total == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(quantile * static_cast<double>(total));
+        rank = std::clamp<uint64_t>(rank, 1, total);
+        uint64_t seen = 0;
+        for (size_t bucket = 0; bucket < BUCKETS; ++bucket) {
+            seen += counts[bucket];
+            if (seen >= rank) return std::min(upperBound(bucket), maximum);
+        }
+        return maximum;
+    }
+
+private:
+    static size_t bucketOf(uint64_t v) {
+        if (v < SUB_BUCKETS) return static_cast<size_t>(v);
+        int exponent = std::bit_width(v) - 1; // >= SUB_BUCKET_BITS
+        uint64_t sub = (v >> (exponent - SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+        return static_cast<size_t>((exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + sub);
+    }
+
+    static uint64_t upperBound(size_t bucket) {
+        if (bucket < SUB_BUCKETS) return bucket;
+        int exponent = static_cast<int>(bucket / SUB_BUCKETS) + SUB_BUCKET_BITS - 1;
+        uint64_t sub = bucket % SUB_BUCKETS;
+        uint64_t width = uint64_t(1) << (exponent - SUB_BUCKET_BITS);
+        return ((SUB_BUCKETS + sub) << (exponent - SUB_BUCKET_BITS)) + (width - 1);
+    }
+
+    uint64_t counts[BUCKETS] = {};
+    uint64_t total = 0;
+    uint64_t sum = 0;
+    uint64_t minimum = std::numeric_limits<uint64_t>::max();
+    uint64_t maximum = 0;
+};
+
+#endif //LATENCY_HISTOGRAM_H
@@ -0,0 +1,17 @@
+//
+// Monotonic time source shared by the serial stack (not affected by NTP adjustments).
+//
+
+#ifndef MONOTONIC_CLOCK_H
+#define MONOTONIC_CLOCK_H
+
+#include <chrono>
+#include <cstdint>
+
+// Nanoseconds of the monotonic clock (CLOCK_MONOTONIC on Linux)
+inline int64_t monotonicNanos() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#endif //MONOTONIC_CLOCK_H
@@ -0,0 +1,82 @@
+//
+// Fixed pool of encoded frames for the transmit path.
+//
+// A packet holds one frame already encoded for the wire (CRC + COBS + delimiter). It is encoded
+// once, then referenced by the write queue and, for reliable frames, by the retransmission window,
+// so a retransmission costs neither a new encoding nor a copy. Packets are reference counted and
+// return to the free list when the last user releases them: no allocation after construction.
+// Single-threaded (the transmit thread owns the pool).
+//
+
+#ifndef PACKET_POOL_H
+#define PACKET_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include "protocol.h"
+
+struct Packet {
+    uint8_t refs = 0;   // Number of users (write queue, retransmission window)
+    uint16_t length = 0; // Encoded size, including the delimiter
+    uint8_t data[FRAME_MAX_ENCODED];
+};
+
+template <size_t Capacity>
+class PacketPool {
+    static_assert(Capacity > 0 && Capacity <= UINT16_MAX, "Unsupported pool capacity");
+
+public:
+    PacketPool() { reset(); }
+    PacketPool(const PacketPool&) = delete;
+    PacketPool& operator=(const PacketPool&) = delete;
+
+    // Take a free packet with one reference, nullptr if the pool is exhausted
+    Packet* acquire() {
+        if (freeCount == 0) {
+            ++exhaustedTotal;
+            return nullptr;
+        }
+        Packet* packet = &packets[freeList[--freeCount]];
+        packet->refs = 1;
+        packet->length = 0;
+        return packet;
+    }
+
+    // Take a free packet holding the encoded frame, nullptr if the pool is exhausted
+    Packet* acquire(const Frame& frame) {
+        Packet* packet = acquire();
+        if (packet != nullptr) {
+            packet->length = static_cast<uint16_t>(encodeFrame(frame, packet->data, sizeof(packet->data)));
+        }
+        return packet;
+    }
+
+    void retain(Packet* packet) { ++packet->refs; }
+
+    void release(Packet* packet) {
+        if (--packet->refs == 0) {
+            freeList[freeCount++] = static_cast<uint16_t>(packet - packets);
+        }
+    }
+
+    // Return every packet to the pool (all references are dropped)
+    void reset() {
+        for (size_t i = 0; i < Capacity; ++i) {
+            packets[i].refs = 0;
+            freeList[i] = static_cast<uint16_t>(Capacity - 1 - i);
+        }
+        freeCount = Capacity;
+    }
+
+    size_t available() const { return freeCount; }
+    static constexpr size_t capacity() { return Capacity; }
+    uint64_t exhausted() const { return exhaustedTotal; }
+
+private:
+    Packet packets[Capacity];
+    uint16_t freeList[Capacity]; // Stack of free packet indices, recently released ones are reused first (warm in cache)
+    size_t freeCount = 0;
+    uint64_t exhaustedTotal = 0;
+};
+
+#endif //PACKET_POOL_H
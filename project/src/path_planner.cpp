@@ -1,5 +1,17 @@
 #include "path_planner.h"
 
+#include <cstdint>
+#include <cstdlib>
+#include "configuration_space.h"
+#include "distance_field.h"
+#include "dstar_lite.h"
+#include "grid_map.h"
+#include "hierarchical_planner.h"
+#include "indexed_heap.h"
+#include "jump_point_search.h"
+#include "monotonic_clock.h"
+#include "turn_penalty_search.h"
+
 // Function to find the default end point (bottom-most, then right-most '1')
 Point findDefaultEndPoint(const std::vector<std::vector<int>>& mapMatrix) {
     Point endPoint = {-1, -1};
@@ -30,46 +42,230 @@ Point findDefaultEndPoint(const std::vector<std::vector<int>>& mapMatrix) {
     return endPoint;
 }
 
+namespace {
+
+// Moves in command order: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+constexpr char directionChars[] = {'R', 'F', 'L', 'B'};
+constexpr uint8_t NO_PARENT = 4;
+
+// Search state of a cell. gScore and parentMove are only valid once a cell is SEEN.
+constexpr uint8_t BLOCKED = 0;
+constexpr uint8_t UNSEEN = 1; // Free, not reached yet
+constexpr uint8_t SEEN = 2;   // Reached, in the open list
+constexpr uint8_t CLOSED = 3; // Expanded, its cost is final
+
+// Reused by the searches of a thread: after the first search of a map size, planning allocates
+// nothing and only initialises the cell states. Released after maps above PLANNER_RETAINED_CELLS.
+struct SearchBuffers {
+    std::vector<uint8_t> state;
+    std::vector<int> gScore;          // Cost from the start
+    std::vector<uint8_t> parentMove;  // Move that reached the cell, to walk the path back
+    IndexedHeap<uint64_t> open;
+};
+thread_local SearchBuffers searchBuffers;
+
+// Open list key: lowest f first, then the deepest node (highest g), which on uniform grids
+// follows one of the many equal-length paths to the end instead of widening the search front
+inline uint64_t openKey(int f, int g) {
+    return (static_cast<uint64_t>(f) << 32) | (UINT32_MAX - static_cast<uint32_t>(g));
+}
+
+std::vector<Point> searchShortestPath(const GridMap& map, Point start, Point goal, SearchBuffers& buffers) {
+    std::vector<Point> path;
+    if (map.empty() || !map.contains(start) || !map.contains(goal) || !map.isFree(start) || !map.isFree(goal)) {
+        return path;
+    }
+
+    // The cell states start as a copy of the map (bordered, so no bounds checks when expanding)
+    static_assert(UNSEEN == GridMap::FREE && BLOCKED == GridMap::BLOCKED, "Cell states must match the map cells");
+    int stride = map.stride();
+    size_t cells = map.dataSize();
+    buffers.state.assign(map.data(), map.data() + cells);
+    if (buffers.gScore.size() < cells) {
+        buffers.gScore.resize(cells);
+        buffers.parentMove.resize(cells);
+    }
+    if (buffers.open.capacity() < cells) {
+        buffers.open.reset(cells);
+    } else {
+        buffers.open.clear();
+    }
+    uint8_t* state = buffers.state.data();
+    int* gScore = buffers.gScore.data();
+    uint8_t* parentMove = buffers.parentMove.data();
+    IndexedHeap<uint64_t>& open = buffers.open;
+    const int offset[] = {1, stride, -1, -stride};
+
+    auto heuristic = [&](int x, int y) { return std::abs(x - goal.x) + std::abs(y - goal.y); };
+    uint32_t startIndex = map.index(start.x, start.y);
+    uint32_t goalIndex = map.index(goal.x, goal.y);
+    state[startIndex] = SEEN;
+    gScore[startIndex] = 0;
+    parentMove[startIndex] = NO_PARENT;
+    open.push(startIndex, openKey(heuristic(start.x, start.y), 0));
+
+    while (!open.empty()) {
+        uint32_t current = open.pop();
+        if (current == goalIndex) break;
+        state[current] = CLOSED;
+        auto [x, y] = map.pointAt(current);
+        int g = gScore[current] + 1;
+        for (int i = 0; i < 4; ++i) {
+            uint32_t next = current + offset[i];
+            // Manhattan distance is consistent on a 4-connected unit grid: closed cells are final
+            if (state[next] == UNSEEN) {
+                state[next] = SEEN;
+            } else if (state[next] != SEEN || g >= gScore[next]) {
+                continue;
+            }
+            gScore[next] = g;
+            parentMove[next] = i;
+            open.push(next, openKey(g + heuristic(x + dx[i], y + dy[i]), g));
+        }
+    }
+    if (state[goalIndex] == UNSEEN) return path;
+
+    path.resize(gScore[goalIndex] + 1);
+    Point cell = goal;
+    for (size_t i = path.size(); i-- > 0;) {
+        path[i] = cell;
+        uint8_t move = parentMove[map.index(cell.x, cell.y)];
+        if (move != NO_PARENT) cell = {cell.x - dx[move], cell.y - dy[move]};
+    }
+    return path;
+}
+
+} // namespace
+
+std::vector<Point> findShortestPath(const GridMap& map, Point start, Point goal) {
+    std::vector<Point> path = searchShortestPath(map, start, goal, searchBuffers);
+    if (map.dataSize() > PLANNER_RETAINED_CELLS) searchBuffers = SearchBuffers();
+    return path;
+}
+
+std::vector<std::string> pathToActions(const std::vector<Point>& path, int resolution_mm) {
+    std::vector<std::string> actions;
+    char currentDirection = '\0';
+    int stepsInCurrentDirection = 0;
+    for (size_t i = 1; i < path.size(); ++i) {
+        char moveDirection = '\0';
+        for (int d = 0; d < 4; ++d) {
+            if (path[i].x - path[i - 1].x == dx[d] && path[i].y - path[i - 1].y == dy[d]) {
+                moveDirection = directionChars[d];
+                break;
+            }
+        }
+        if (moveDirection == '\0') {
+            std::cerr << "Error: Path cells (" << path[i - 1].x << "," << path[i - 1].y << ") and ("
+                      << path[i].x << "," << path[i].y << ") are not adjacent." << std::endl;
+            actions.clear();
+            return actions;
+        }
+
+        if (moveDirection == currentDirection) { // Continue in the same direction
+            stepsInCurrentDirection++;
+        } else { // First move or direction changed
+            // Add the completed command for the previous direction
+            if (stepsInCurrentDirection > 0) {
+                actions.push_back(std::string(1, currentDirection) + std::to_string(stepsInCurrentDirection * resolution_mm));
+            }
+            currentDirection = moveDirection;
+            stepsInCurrentDirection = 1;
+        }
+    }
+
+    // Add the last command segment after reaching the end point
+    if (stepsInCurrentDirection > 0) {
+        actions.push_back(std::string(1, currentDirection) + std::to_string(stepsInCurrentDirection * resolution_mm));
+    }
+    return actions;
+}
+
+std::vector<Point> findShortestPath(const std::vector<std::vector<int>>& mapMatrix, Point start, Point goal) {
+    return findShortestPath(GridMap::fromMatrix(mapMatrix), start, goal);
+}
+
+const char* plannerModeName(PlannerMode mode) {
+    switch (mode) {
+        case PlannerMode::AStar: return "A*";
+        case PlannerMode::JumpPoint: return "JPS";
+        case PlannerMode::Hierarchical: return "HPA*";
+        case PlannerMode::DistanceField: return "Distance field";
+        case PlannerMode::TurnPenalty: return "Turn penalty";
+    }
+    return "?";
+}
+
+std::vector<Point> findPath(const GridMap& map, Point start, Point goal, PlannerMode mode, int turnCost) {
+    switch (mode) {
+        case PlannerMode::AStar: return findShortestPath(map, start, goal);
+        case PlannerMode::JumpPoint: return findJumpPointPath(map, start, goal);
+        case PlannerMode::Hierarchical: {
+            // The abstraction of the last map planned on by this thread is kept until the map changes,
+            // unless the map is above PLANNER_RETAINED_CELLS
+            thread_local HierarchicalPlanner planner;
+            if (!planner.isBuilt() || planner.mapVersion() != map.version()) planner.build(map);
+            std::vector<Point> path = planner.findPath(start, goal);
+            if (map.dataSize() > PLANNER_RETAINED_CELLS) planner.release();
+            return path;
+        }
+        case PlannerMode::DistanceField: {
+            // Repeated queries towards the same end point only walk the field (same size limit)
+            thread_local DistanceField field;
+            if (!field.isCurrent(map, goal)) field.build(map, goal);
+            std::vector<Point> path = field.pathFrom(start);
+            if (map.dataSize() > PLANNER_RETAINED_CELLS) field.release();
+            return path;
+        }
+        case PlannerMode::TurnPenalty: return findTurnPenaltyPath(map, start, goal, turnCost);
+    }
+    return {};
+}
+
+Point findDefaultEndPoint(const GridMap& map) {
+    return map.endPoint();
+}
+
 /**
- * @brief Converts a path in a map matrix to a sequence of actions.
+ * @brief Plans the shortest path in a map and converts it to a sequence of actions.
  *
- * @param mapMatrix The map represented as a 2D vector (0=empty/obstacle, 1=path).
+ * @param map The map (free cells are the path, see GridMap).
  * @param resolution_mm The size of one grid cell in millimeters.
  * @param startPointOpt Optional starting point. If nullopt or invalid, defaults to (0,0) if it's part of the path.
+ * @param mode The search used to find the path.
+ * @param turnCost Cost of a direction change in cells, for PlannerMode::TurnPenalty.
  * @return A vector of strings representing the action sequence (e.g., "R5", "F10"). Returns an empty vector on error or if no path exists.
  */
 std::vector<std::string> generateActionSequence(
-    const std::vector<std::vector<int>>& mapMatrix,
+    const GridMap& map,
     int resolution_mm,
-    std::optional<Point> startPointOpt)
+    std::optional<Point> startPointOpt,
+    PlannerMode mode,
+    int turnCost)
 {
     std::vector<std::string> actions;
-    if (mapMatrix.empty() || mapMatrix[0].empty() || resolution_mm <= 0) {
+    if (map.empty() || resolution_mm <= 0) {
         std::cerr << "Error: Invalid map matrix or resolution." << std::endl;
         return actions; // Return empty vector for invalid input
     }
 
-    int rows = mapMatrix.size();
-    int cols = mapMatrix[0].size();
-
-    // Make a mutable copy or use a visited matrix
-    std::vector<std::vector<int>> visitedMap = mapMatrix; // Copy to mark visited cells (e.g., change 1 to 2)
-
     Point startPoint;
-    Point endPoint = findDefaultEndPoint(mapMatrix); // Find the logical end point
+    Point endPoint = map.endPoint(); // The logical end point, kept by the map
 
     // Validate or determine the start point
     if (startPointOpt.has_value()) {
         startPoint = startPointOpt.value();
         // Check if provided start point is valid and on the path
-        if (startPoint.y < 0 || startPoint.y >= rows || startPoint.x < 0 || startPoint.x >= cols || mapMatrix[startPoint.y][startPoint.x] != 1) {
+        if (!map.contains(startPoint) || !map.isFree(startPoint)) {
             std::cerr << "Error: Provided start point (" << startPoint.x << "," << startPoint.y << ") is invalid or not on the path." << std::endl;
             return actions; // Return empty if start is invalid
         }
     } else {
         // Default start: (0,0)
         startPoint = {0, 0};
-        if (mapMatrix[0][0] != 1) {
+        if (!map.isFree(startPoint)) {
              std::cerr << "Error: Default start point (0,0) is not on the path." << std::endl;
              // Optional: Could search for the first '1' as an alternative default
             return actions; // Return empty if default start is not on path
@@ -89,75 +285,28 @@ std::vector<std::string> generateActionSequence(
          return actions;
      }
 
-
-    Point currentPos = startPoint;
-    visitedMap[currentPos.y][currentPos.x] = 2; // Mark start as visited
-
-    char currentDirection = '\0'; // No initial direction
-    int stepsInCurrentDirection = 0;
-
-    while (currentPos != endPoint) {
-        Point nextPos = {-1, -1};
-        char moveDirection = '\0';
-
-        // Define potential moves (relative grid changes) and corresponding directions
-        // Order matters: Determines path choice at branches. Let's use R, F, L, B (relative to grid axes)
-        int dx[] = {1, 0, -1, 0}; // Change in x: Right, Stay, Left, Stay
-        int dy[] = {0, 1, 0, -1}; // Change in y: Stay, Down(Fwd), Stay, Up(Bwd)
-        char directionChars[] = {'R', 'F', 'L', 'B'}; // Commands
-
-        bool foundNext = false;
-        for (int i = 0; i < 4; ++i) {
-            int checkX = currentPos.x + dx[i];
-            int checkY = currentPos.y + dy[i];
-
-            // Check bounds
-            if (checkX >= 0 && checkX < cols && checkY >= 0 && checkY < rows) {
-                // Check if it's an unvisited path cell
-                if (visitedMap[checkY][checkX] == 1) {
-                    nextPos = {checkX, checkY};
-                    moveDirection = directionChars[i];
-                    foundNext = true;
-                    break; // Found the next step
-                }
-            }
-        }
-
-        if (!foundNext) {
-            // If we haven't reached the end but can't find a next step, the path is broken
-            // or the endpoint definition is inconsistent with the path connectivity.
-             std::cerr << "Error: Path broken or end point unreachable from current position ("
-                       << currentPos.x << "," << currentPos.y << ")" << std::endl;
-             // Optionally return actions generated so far, or clear it. Let's clear it.
-            actions.clear();
-            return actions;
-        }
-
-        // Process the move
-        if (stepsInCurrentDirection == 0) { // First move or direction just changed
-            currentDirection = moveDirection;
-            stepsInCurrentDirection = 1;
-        } else if (moveDirection == currentDirection) { // Continue in the same direction
-            stepsInCurrentDirection++;
-        } else { // Direction changed
-            // Add the completed command for the previous direction
-            actions.push_back(std::string(1, currentDirection) + std::to_string(stepsInCurrentDirection * resolution_mm));
-            // Reset for the new direction
-            currentDirection = moveDirection;
-            stepsInCurrentDirection = 1;
-        }
-
-        // Update position and mark as visited
-        currentPos = nextPos;
-        visitedMap[currentPos.y][currentPos.x] = 2; // Mark as visited
+    std::vector<Point> path = findPath(map, startPoint, endPoint, mode, turnCost);
+    if (path.empty()) {
+        std::cerr << "Error: End point (" << endPoint.x << "," << endPoint.y << ") unreachable from start point ("
+                  << startPoint.x << "," << startPoint.y << ")" << std::endl;
+        return actions;
     }
+    return pathToActions(path, resolution_mm);
+}
 
-    // Add the last command segment after reaching the end point
-    if (stepsInCurrentDirection > 0) {
-        actions.push_back(std::string(1, currentDirection) + std::to_string(stepsInCurrentDirection * resolution_mm));
+std::vector<std::string> generateActionSequence(
+    const std::vector<std::vector<int>>& mapMatrix,
+    int resolution_mm,
+    std::optional<Point> startPointOpt,
+    PlannerMode mode,
+    int turnCost)
+{
+    GridMap map = GridMap::fromMatrix(mapMatrix);
+    if (map.empty() && !mapMatrix.empty() && !mapMatrix[0].empty()) {
+        std::cerr << "Error: Map rows have different lengths." << std::endl;
+        return {};
     }
-
-    return actions;
+    return generateActionSequence(map, resolution_mm, startPointOpt, mode, turnCost);
 }
 
 // Helper function to print the action list
@@ -270,5 +419,207 @@ int path_planner_test_main() {
     printActions(actions4_custom);
     std::cout << std::endl;
 
+    // Example Map 5: Branch with a dead end. Taking the first free neighbour (R) runs into the dead end.
+    // 1 1 1 1 1
+    // 1 0 0 0 0
+    // 1 1 1 1 1  <-- End point (4, 2)
+    std::vector<std::vector<int>> map5 = {
+        {1, 1, 1, 1, 1},
+        {1, 0, 0, 0, 0},
+        {1, 1, 1, 1, 1}
+    };
+    std::cout << "--- Example 5: Branch with a dead end ---" << std::endl;
+    std::vector<std::string> actions5 = generateActionSequence(map5, 10);
+    // Expected actions: F20, R40
+    printActions(actions5);
+    // Same path with jump point search, which jumps along the first column and the last row
+    printActions(generateActionSequence(map5, 10, std::nullopt, PlannerMode::JumpPoint));
+    std::cout << std::endl;
+
+    // Example Map 6: 2000 x 1500 serpentine, walls with one gap at alternating ends every 4 rows
+    const int rows6 = 1500, cols6 = 2000;
+    GridMap map6(cols6, rows6, GridMap::FREE);
+    for (int y = 2; y < rows6; y += 4) {
+        for (int x = 0; x < cols6; ++x) map6.set(x, y, GridMap::BLOCKED);
+        map6.set((y / 4) % 2 == 0 ? cols6 - 1 : 0, y, GridMap::FREE);
+    }
+    std::cout << "--- Example 6: " << cols6 << " x " << rows6 << " serpentine, " << map6.freeCount()
+              << " free cells ---" << std::endl;
+    // First call of each mode: includes its one-off setup (bit grid for JPS, cluster graph for HPA*)
+    for (PlannerMode mode : {PlannerMode::AStar, PlannerMode::JumpPoint, PlannerMode::Hierarchical}) {
+        int64_t start6 = monotonicNanos();
+        std::vector<std::string> actions6 = generateActionSequence(map6, 5, std::nullopt, mode);
+        int64_t elapsed6 = monotonicNanos() - start6;
+        std::cout << plannerModeName(mode) << ": " << actions6.size() << " actions planned in "
+                  << elapsed6 / 1000000.0 << " ms" << std::endl;
+    }
+    std::cout << std::endl;
+
+    // Example 7: the end point follows the map. Blocking the end of map 2 moves it to (4, 2).
+    GridMap grid2 = GridMap::fromMatrix(map2);
+    std::cout << "--- Example 7: Map 2 end point (" << grid2.endPoint().x << "," << grid2.endPoint().y << ")";
+    grid2.set(4, 3, GridMap::BLOCKED);
+    std::cout << ", after blocking it (" << grid2.endPoint().x << "," << grid2.endPoint().y << ") ---" << std::endl;
+    std::vector<std::string> actions7 = generateActionSequence(grid2, resolution2);
+    // Expected actions: F10, R20, F10, R20
+    printActions(actions7);
+    std::cout << std::endl;
+
+    // Example 8: incremental replanning when obstacles appear or disappear
+    // 1 1 1 1 1
+    // 1 0 0 0 1
+    // 1 1 1 1 1  <-- End point (4, 2)
+    GridMap ring(5, 3, GridMap::FREE);
+    for (int x = 1; x <= 3; ++x) ring.set(x, 1, GridMap::BLOCKED);
+    DStarLite replanner;
+    replanner.reset(ring, {0, 0}, ring.endPoint());
+    std::cout << "--- Example 8: D* Lite replanning ---" << std::endl;
+    auto replan = [&](const char* what) {
+        std::vector<Point> path = replanner.plan();
+        std::cout << what << " (" << replanner.lastExpansions() << " cells expanded): ";
+        printActions(pathToActions(path, 10));
+    };
+    replan("Initial plan");
+    replanner.updateCells({{{4, 1}, GridMap::BLOCKED}});
+    replan("(4,1) blocked"); // Expected actions: F20, R40
+    replanner.updateCells({{{0, 1}, GridMap::BLOCKED}});
+    replan("(0,1) blocked"); // No path
+    replanner.updateCells({{{0, 1}, GridMap::FREE}, {{4, 1}, GridMap::FREE}});
+    replanner.moveStart({2, 0});
+    replan("Both cleared, start moved to (2,0)"); // Expected actions: R20, F20
+
+    // 1000 x 750 map crossed by walls with passages: the repair costs a fraction of the first search
+    GridMap walls(1000, 750, GridMap::FREE);
+    for (int y = 50; y < 700; y += 50) {
+        for (int x = 100; x < 900; ++x) {
+            if (x % 400 != 0) walls.set(x, y, GridMap::BLOCKED);
+        }
+    }
+    DStarLite incremental;
+    incremental.reset(walls, {0, 0}, walls.endPoint());
+    int64_t start8 = monotonicNanos();
+    std::vector<Point> path8 = incremental.plan();
+    int64_t initial8 = monotonicNanos() - start8;
+    Point blocked8 = path8[path8.size() / 2];
+    start8 = monotonicNanos();
+    incremental.updateCells({{blocked8, GridMap::BLOCKED}});
+    path8 = incremental.plan();
+    int64_t repair8 = monotonicNanos() - start8;
+    std::cout << "Walls: first plan " << initial8 / 1000000.0 << " ms, replan after blocking (" << blocked8.x << ","
+              << blocked8.y << ") " << repair8 / 1000.0 << " us (" << incremental.lastExpansions()
+              << " cells expanded), " << path8.size() << " cells" << std::endl;
+    std::cout << std::endl;
+
+    // Example 9: hierarchical planning on a site map the size of 11.png (1545 x 1393): rooms of 60 cells,
+    // walls with doors, every fifth wall segment missing
+    GridMap site(1545, 1393, GridMap::FREE);
+    for (int y = 0; y < site.height(); ++y) {
+        for (int x = 0; x < site.width(); ++x) {
+            bool wall = (y % 60 == 59 && x % 60 > 8 && (x / 60 + y / 60) % 5 != 0) ||
+                        (x % 60 == 59 && y % 60 > 8 && (x / 60 + 2 * (y / 60)) % 5 != 0);
+            if (wall) site.set(x, y, GridMap::BLOCKED);
+        }
+    }
+    std::cout << "--- Example 9: " << site.width() << " x " << site.height() << " site map ---" << std::endl;
+    HierarchicalPlanner hierarchical;
+    int64_t start9 = monotonicNanos();
+    hierarchical.build(site);
+    std::cout << "Abstraction: " << hierarchical.nodeCount() << " nodes, " << hierarchical.edgeCount() << " edges, built in "
+              << (monotonicNanos() - start9) / 1000000.0 << " ms" << std::endl;
+    const Point queries9[][2] = {{{0, 0}, site.endPoint()}, {{700, 650}, {820, 700}}};
+    for (const auto& query : queries9) {
+        start9 = monotonicNanos();
+        std::vector<Point> coarse = hierarchical.findPath(query[0], query[1]);
+        int64_t hierarchical9 = monotonicNanos() - start9;
+        start9 = monotonicNanos();
+        std::vector<Point> exact = findShortestPath(site, query[0], query[1]);
+        int64_t exact9 = monotonicNanos() - start9;
+        std::cout << "(" << query[0].x << "," << query[0].y << ") to (" << query[1].x << "," << query[1].y << "): HPA* "
+                  << coarse.size() << " cells in " << hierarchical9 / 1000.0 << " us, A* " << exact.size()
+                  << " cells in " << exact9 / 1000.0 << " us" << std::endl;
+    }
+    std::cout << std::endl;
+
+    // Example 10: many start points towards the site map end point
+    std::cout << "--- Example 10: distance field, 100 start points on the site map ---" << std::endl;
+    std::vector<Point> starts10;
+    for (int i = 0; starts10.size() < 100; ++i) {
+        Point start = {(i * 151) % site.width(), (i * 97) % site.height()};
+        if (site.isFree(start)) starts10.push_back(start);
+    }
+    size_t cells10 = 0;
+    int64_t start10 = monotonicNanos();
+    for (Point start : starts10) cells10 += findPath(site, start, site.endPoint(), PlannerMode::AStar).size();
+    std::cout << plannerModeName(PlannerMode::AStar) << ": " << cells10 << " cells in "
+              << (monotonicNanos() - start10) / 1000000.0 << " ms" << std::endl;
+    // The site map is above PLANNER_RETAINED_CELLS, findPath would rebuild its field on every call: keep one here
+    DistanceField field10;
+    start10 = monotonicNanos();
+    field10.build(site, site.endPoint());
+    int64_t build10 = monotonicNanos() - start10;
+    cells10 = 0;
+    start10 = monotonicNanos();
+    for (Point start : starts10) cells10 += field10.pathFrom(start).size();
+    std::cout << plannerModeName(PlannerMode::DistanceField) << ": " << cells10 << " cells, built in " << build10 / 1000000.0 << " ms, then "
+              << (monotonicNanos() - start10) / 1000.0 / starts10.size() << " us per start point" << std::endl;
+    std::cout << std::endl;
+
+    // Example 11: plan on the site map inflated by a vehicle radius of 4 cells, so the chassis clears the walls
+    std::cout << "--- Example 11: configuration space of the site map ---" << std::endl;
+    for (ConfigurationSpace::Footprint footprint : {ConfigurationSpace::Footprint::Disk, ConfigurationSpace::Footprint::Square}) {
+        ConfigurationSpace space(4, footprint);
+        GridMap inflated11;
+        space.build(site, inflated11);
+        int64_t start11 = monotonicNanos();
+        space.build(site, inflated11);
+        int64_t build11 = monotonicNanos() - start11;
+        std::vector<Point> path11 = findShortestPath(inflated11, {4, 4}, inflated11.endPoint());
+        std::cout << (footprint == ConfigurationSpace::Footprint::Disk ? "Disk" : "Square") << ": " << inflated11.freeCount()
+                  << " of " << site.freeCount() << " free cells left, inflated in " << build11 / 1000.0 << " us, path to ("
+                  << inflated11.endPoint().x << "," << inflated11.endPoint().y << ") " << path11.size() << " cells"
+                  << std::endl;
+    }
+    std::cout << std::endl;
+
+    // Example 12: commands sent to the vehicle. A shortest path may zigzag through open space; charging each
+    // direction change keeps the straight runs long. Repeated queries use their own planner, which keeps its
+    // search buffers (four states per cell) until released; the first site map search grows them.
+    std::cout << "--- Example 12: segments with and without a turn cost ---" << std::endl;
+    GridMap field12(400, 300, GridMap::FREE);
+    for (int i = 1; i <= 900; ++i) {
+        // Scattered 3 x 3 obstacles, none on the start cell
+        int ox = (i * 7919) % 398, oy = (i * 104729) % 298;
+        for (int y = oy; y < oy + 3; ++y) {
+            for (int x = ox; x < ox + 3; ++x) field12.set(x, y, GridMap::BLOCKED);
+        }
+    }
+    struct Case12 {
+        const char* name;
+        const GridMap* map;
+        Point start;
+    };
+    GridMap corridors12 = GridMap::fromMatrix(map2);
+    const Case12 cases12[] = {{"Map 2", &corridors12, {0, 0}},
+                              {"Obstacle field", &field12, {0, 0}},
+                              {"Site map", &site, {4, 4}},
+                              {"Site map, mid", &site, {700, 650}}};
+    TurnPenaltyPlanner planner12;
+    for (const Case12& test : cases12) {
+        std::cout << test.name << ":";
+        std::vector<Point> shortest12 = findPath(*test.map, test.start, test.map->endPoint(), PlannerMode::AStar);
+        std::cout << " A* " << pathToActions(shortest12, 10).size() << " segments / " << shortest12.size() << " cells;";
+        for (int turnCost : {2, DEFAULT_TURN_COST, 32}) {
+            int64_t start12 = monotonicNanos();
+            std::vector<Point> path12 = planner12.findPath(*test.map, test.start, test.map->endPoint(), turnCost);
+            int64_t elapsed12 = monotonicNanos() - start12;
+            std::cout << " turn cost " << turnCost << ": " << pathToActions(path12, 10).size() << " / "
+                      << path12.size() << " (" << elapsed12 / 1000000.0 << " ms);";
+        }
+        std::cout << std::endl;
+    }
+    std::cout << "Search buffers: " << planner12.bufferBytes() / (1024 * 1024) << " MiB, released" << std::endl;
+    planner12.release();
+    std::cout << std::endl;
+
     return 0;
 }
\ No newline at end of file
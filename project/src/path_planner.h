@@ -25,12 +25,64 @@ struct Point {
     }
 };
 
+class GridMap;
+
+// Search behind generateActionSequence, chosen per call. AStar, JumpPoint and DistanceField return a shortest
+// path (when several exist, they may pick different ones), Hierarchical a nearly shortest one, TurnPenalty
+// the cheapest once direction changes are counted.
+enum class PlannerMode {
+    AStar,        // A* over every cell
+    JumpPoint,    // Jump point search (jump_point_search.h): far fewer expansions on open maps
+    Hierarchical, // HPA* (hierarchical_planner.h): cluster graph built once per map version (on every call above
+                  // PLANNER_RETAINED_CELLS)
+    DistanceField, // Distances to the goal (distance_field.h), built once per map version and goal (on every call
+                   // above PLANNER_RETAINED_CELLS): repeated queries from other start points only walk down the distances
+    TurnPenalty,   // Least cells + turnCost per direction change (turn_penalty_search.h): fewest commands,
+                   // not always the fewest cells
+};
+
+// Cost of a direction change for PlannerMode::TurnPenalty, in cells of straight travel
+constexpr int DEFAULT_TURN_COST = 8;
+constexpr int MAX_TURN_COST = 1000;
+
+// The one-off searches (findShortestPath, findJumpPointPath, findPath, findTurnPenaltyPath) keep their per-thread
+// buffers and caches for maps up to this many cells (GridMap::dataSize()) and release them after larger ones.
+// Planning repeatedly on a large map should own its planner: HierarchicalPlanner, DistanceField, TurnPenaltyPlanner.
+constexpr size_t PLANNER_RETAINED_CELLS = 512 * 512;
+
+const char* plannerModeName(PlannerMode mode);
+
 Point findDefaultEndPoint(const std::vector<std::vector<int>>& mapMatrix);
+// O(1): the map keeps its end point up to date
+Point findDefaultEndPoint(const GridMap& map);
 
+// Shortest 4-connected path (A*) over the free cells, start and goal included.
+// Empty if either point is not on the path or the goal is unreachable.
+std::vector<Point> findShortestPath(const GridMap& map, Point start, Point goal);
+// Same over the cells equal to 1 of a map matrix (converted to a GridMap first)
+std::vector<Point> findShortestPath(const std::vector<std::vector<int>>& mapMatrix, Point start, Point goal);
+
+// Shortest path with the search of the given mode (turnCost is only used by PlannerMode::TurnPenalty)
+std::vector<Point> findPath(const GridMap& map, Point start, Point goal, PlannerMode mode,
+                            int turnCost = DEFAULT_TURN_COST);
+
+// Merge consecutive moves of a cell path into "R/F/L/B<mm>" commands (F = +y, R = +x)
+std::vector<std::string> pathToActions(const std::vector<Point>& path, int resolution_mm);
+
+// Shortest path from startPointOpt (default (0,0)) to the map end point, as R/F/L/B commands
+std::vector<std::string> generateActionSequence(
+    const GridMap& map,
+    int resolution_mm,
+    std::optional<Point> startPointOpt = std::nullopt,
+    PlannerMode mode = PlannerMode::AStar,
+    int turnCost = DEFAULT_TURN_COST);
+// Map matrix adapter: 1 = path, every row must have the same length
 std::vector<std::string> generateActionSequence(
     const std::vector<std::vector<int>>& mapMatrix,
     int resolution_mm,
-    std::optional<Point> startPointOpt = std::nullopt);
+    std::optional<Point> startPointOpt = std::nullopt,
+    PlannerMode mode = PlannerMode::AStar,
+    int turnCost = DEFAULT_TURN_COST);
 
 void printActions(const std::vector<std::string>& actions);
 
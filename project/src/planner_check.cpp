@@ -0,0 +1,244 @@
+#include "planner_check.h"
+
+#include <algorithm>
+#include <climits>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <vector>
+#include "configuration_space.h"
+#include "dstar_lite.h"
+#include "grid_map.h"
+#include "hierarchical_planner.h"
+#include "jump_point_search.h"
+#include "path_planner.h"
+#include "turn_penalty_search.h"
+
+namespace {
+
+// Directions in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+
+// Mismatches printed per planner, the others are only counted
+constexpr int PRINTED_MISMATCHES = 5;
+
+struct Tally {
+    const char* planner;
+    int checks = 0;
+    int mismatches = 0;
+};
+
+// Steps of the shortest path from start to goal (breadth-first search), -1 if unreachable
+int shortestLength(const GridMap& map, Point start, Point goal) {
+    if (!map.contains(start) || !map.contains(goal) || !map.isFree(start) || !map.isFree(goal)) return -1;
+    int width = map.width();
+    std::vector<int> distance(static_cast<size_t>(width) * map.height(), -1);
+    std::queue<Point> queue;
+    distance[start.y * width + start.x] = 0;
+    queue.push(start);
+    while (!queue.empty()) {
+        Point cell = queue.front();
+        queue.pop();
+        if (cell == goal) return distance[cell.y * width + cell.x];
+        for (int i = 0; i < 4; ++i) {
+            Point next = {cell.x + dx[i], cell.y + dy[i]};
+            if (!map.contains(next) || !map.isFree(next) || distance[next.y * width + next.x] >= 0) continue;
+            distance[next.y * width + next.x] = distance[cell.y * width + cell.x] + 1;
+            queue.push(next);
+        }
+    }
+    return -1;
+}
+
+// Direction of a one-cell move, -1 if the cells are not 4-neighbours
+int moveDirection(Point from, Point to) {
+    for (int i = 0; i < 4; ++i) {
+        if (to.x - from.x == dx[i] && to.y - from.y == dy[i]) return i;
+    }
+    return -1;
+}
+
+// Starts at start, ends at goal and moves one free cell at a time
+bool isValidPath(const GridMap& map, const std::vector<Point>& path, Point start, Point goal) {
+    if (path.empty() || path.front() != start || path.back() != goal) return false;
+    for (size_t i = 0; i < path.size(); ++i) {
+        if (!map.contains(path[i]) || !map.isFree(path[i])) return false;
+        if (i > 0 && moveDirection(path[i - 1], path[i]) < 0) return false;
+    }
+    return true;
+}
+
+// Cells plus turnCost per direction change, as minimised by the turn penalty search
+long turnPenaltyCost(const std::vector<Point>& path, int turnCost) {
+    long cost = 0;
+    int heading = -1;
+    for (size_t i = 1; i < path.size(); ++i) {
+        int direction = moveDirection(path[i - 1], path[i]);
+        cost += 1 + (heading >= 0 && direction != heading ? turnCost : 0);
+        heading = direction;
+    }
+    return cost;
+}
+
+// Dijkstra over (cell, heading) states, any heading at the start. -1 if unreachable.
+long referenceTurnCost(const GridMap& map, Point start, Point goal, int turnCost) {
+    int width = map.width();
+    std::vector<long> cost(static_cast<size_t>(width) * map.height() * 4, LONG_MAX);
+    using Entry = std::pair<long, int>; // Cost, (y * width + x) * 4 + heading
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> open;
+    for (int heading = 0; heading < 4; ++heading) {
+        int state = (start.y * width + start.x) * 4 + heading;
+        cost[state] = 0;
+        open.push({0, state});
+    }
+    while (!open.empty()) {
+        auto [stateCost, state] = open.top();
+        open.pop();
+        if (stateCost > cost[state]) continue;
+        int heading = state % 4;
+        Point cell = {(state / 4) % width, (state / 4) / width};
+        if (cell == goal) return stateCost;
+        for (int i = 0; i < 4; ++i) {
+            Point next = {cell.x + dx[i], cell.y + dy[i]};
+            if (!map.contains(next) || !map.isFree(next)) continue;
+            long nextCost = stateCost + 1 + (i != heading ? turnCost : 0);
+            int nextState = (next.y * width + next.x) * 4 + i;
+            if (nextCost >= cost[nextState]) continue;
+            cost[nextState] = nextCost;
+            open.push({nextCost, nextState});
+        }
+    }
+    return -1;
+}
+
+// Cell by cell footprint test, the definition ConfigurationSpace implements with bit-packed rows
+GridMap naiveDilation(const GridMap& map, int radius, ConfigurationSpace::Footprint footprint, bool mapEdgeIsObstacle) {
+    GridMap inflated(map.width(), map.height(), GridMap::FREE);
+    for (int y = 0; y < map.height(); ++y) {
+        for (int x = 0; x < map.width(); ++x) {
+            bool hit = false;
+            for (int oy = -radius; oy <= radius && !hit; ++oy) {
+                for (int ox = -radius; ox <= radius && !hit; ++ox) {
+                    if (footprint == ConfigurationSpace::Footprint::Disk && ox * ox + oy * oy > radius * radius) continue;
+                    hit = map.contains(x + ox, y + oy) ? !map.isFree(x + ox, y + oy) : mapEdgeIsObstacle;
+                }
+            }
+            if (hit) inflated.set(x, y, GridMap::BLOCKED);
+        }
+    }
+    return inflated;
+}
+
+bool sameCells(const GridMap& a, const GridMap& b) {
+    if (a.width() != b.width() || a.height() != b.height() || a.freeCount() != b.freeCount()) return false;
+    for (int y = 0; y < a.height(); ++y) {
+        for (int x = 0; x < a.width(); ++x) {
+            if (a.at(x, y) != b.at(x, y)) return false;
+        }
+    }
+    return a.endPoint() == b.endPoint();
+}
+
+void record(Tally& tally, bool ok, int round, const GridMap& map, Point start, Point goal, long expected, long got) {
+    ++tally.checks;
+    if (ok) return;
+    if (++tally.mismatches <= PRINTED_MISMATCHES) {
+        std::cout << "[Mismatch] " << tally.planner << ", round " << round << ": " << map.width() << " x " << map.height()
+                  << " map, (" << start.x << "," << start.y << ") -> (" << goal.x << "," << goal.y << "), expected "
+                  << expected << ", got " << got << std::endl;
+    }
+}
+
+// Path length in steps, -1 for an empty path and -2 for an invalid one
+long describePath(const GridMap& map, const std::vector<Point>& path, Point start, Point goal) {
+    if (path.empty()) return -1;
+    return isValidPath(map, path, start, goal) ? static_cast<long>(path.size()) - 1 : -2;
+}
+
+} // namespace
+
+int planner_check_main(uint32_t seed, int rounds) {
+    std::mt19937 rng(seed);
+    Tally astar{"A*"}, jumpPoint{"JPS"}, distanceField{"Distance field"}, hierarchical{"HPA*"};
+    Tally dstar{"D* Lite"}, turnPenalty{"Turn penalty"}, configurationSpace{"Configuration space"};
+
+    for (int round = 0; round < rounds; ++round) {
+        int width = 1 + static_cast<int>(rng() % 32);
+        int height = 1 + static_cast<int>(rng() % 32);
+        unsigned density = rng() % 45;
+        GridMap map(width, height, GridMap::FREE);
+        for (int y = 0; y < height; ++y) {
+            for (int x = 0; x < width; ++x) {
+                if (rng() % 100 < density) map.set(x, y, GridMap::BLOCKED);
+            }
+        }
+        auto randomCell = [&]() { return Point{static_cast<int>(rng() % width), static_cast<int>(rng() % height)}; };
+        Point start = randomCell();
+        Point goal = randomCell();
+        map.set(start.x, start.y, GridMap::FREE);
+        map.set(goal.x, goal.y, GridMap::FREE);
+
+        // Shortest path planners: a valid path of the breadth-first search length, or none if unreachable
+        int shortest = shortestLength(map, start, goal);
+        auto checkShortest = [&](Tally& tally, const GridMap& on, Point from, int expected, const std::vector<Point>& path) {
+            long got = describePath(on, path, from, goal);
+            record(tally, got == expected, round, on, from, goal, expected, got);
+        };
+        checkShortest(astar, map, start, shortest, findShortestPath(map, start, goal));
+        checkShortest(jumpPoint, map, start, shortest, findJumpPointPath(map, start, goal));
+        checkShortest(distanceField, map, start, shortest, findPath(map, start, goal, PlannerMode::DistanceField));
+
+        // HPA* paths may be longer than the shortest, but must exist whenever the goal is reachable
+        HierarchicalPlanner planner(2 + static_cast<int>(rng() % 9));
+        planner.build(map);
+        long hierarchicalLength = describePath(map, planner.findPath(start, goal), start, goal);
+        record(hierarchical, shortest < 0 ? hierarchicalLength == -1 : hierarchicalLength >= shortest, round, map, start,
+               goal, shortest, hierarchicalLength);
+
+        // D* Lite: the first search, then repairs after cell changes and a move of the start
+        DStarLite replanner;
+        replanner.reset(map, start, goal);
+        checkShortest(dstar, map, start, shortest, replanner.plan());
+        std::vector<CellChange> changes;
+        for (int i = 1 + static_cast<int>(rng() % 8); i > 0; --i) {
+            Point cell = randomCell();
+            if (cell == start || cell == goal) continue;
+            changes.push_back({cell, rng() % 2 == 0 ? GridMap::FREE : GridMap::BLOCKED});
+        }
+        replanner.updateCells(changes);
+        checkShortest(dstar, replanner.map(), start, shortestLength(replanner.map(), start, goal), replanner.plan());
+        Point moved = randomCell();
+        if (replanner.moveStart(moved)) {
+            checkShortest(dstar, replanner.map(), moved, shortestLength(replanner.map(), moved, goal), replanner.plan());
+        }
+
+        // Turn penalty: the least cells + turnCost * turns, including the free (0) and clamped costs
+        int turnCost = rng() % 4 == 0 ? 0 : static_cast<int>(rng() % 20);
+        if (rng() % 50 == 0) turnCost = MAX_TURN_COST * 5;
+        std::vector<Point> turnPath = findTurnPenaltyPath(map, start, goal, turnCost);
+        int appliedCost = std::min(turnCost, MAX_TURN_COST);
+        long expectedCost = referenceTurnCost(map, start, goal, appliedCost);
+        long gotCost = isValidPath(map, turnPath, start, goal) ? turnPenaltyCost(turnPath, appliedCost)
+                                                               : describePath(map, turnPath, start, goal);
+        record(turnPenalty, gotCost == expectedCost, round, map, start, goal, expectedCost, gotCost);
+
+        // Configuration space: cell by cell equal to the naive dilation (expected / got: free cells)
+        int radius = static_cast<int>(rng() % 7);
+        auto footprint = rng() % 2 == 0 ? ConfigurationSpace::Footprint::Disk : ConfigurationSpace::Footprint::Square;
+        bool mapEdgeIsObstacle = rng() % 2 == 0;
+        GridMap inflated = ConfigurationSpace(radius, footprint, mapEdgeIsObstacle).build(map);
+        GridMap reference = naiveDilation(map, radius, footprint, mapEdgeIsObstacle);
+        record(configurationSpace, sameCells(inflated, reference), round, map, start, goal,
+               static_cast<long>(reference.freeCount()), static_cast<long>(inflated.freeCount()));
+    }
+
+    int mismatches = 0;
+    for (const Tally* tally : {&astar, &jumpPoint, &distanceField, &hierarchical, &dstar, &turnPenalty, &configurationSpace}) {
+        std::cout << tally->planner << ": " << tally->checks << " checks, " << tally->mismatches << " mismatches" << std::endl;
+        mismatches += tally->mismatches;
+    }
+    return mismatches == 0 ? 0 : -1;
+}
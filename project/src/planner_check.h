@@ -0,0 +1,22 @@
+//
+// Randomised cross-check of the path planners against plain reference implementations.
+//
+// Every round draws a small random map, start and goal, then checks:
+//   - A*, jump point search and the distance field: a valid path of the breadth-first search length
+//   - HPA* (random cluster size): a valid path whenever the goal is reachable, never shorter than the shortest
+//   - D* Lite: the same after random cell changes (updateCells) and a move of the start (moveStart)
+//   - turn penalty search: the cost of a Dijkstra search over (cell, heading) states
+//   - configuration space: the same cells as a naive dilation, for both footprints and edge modes
+// A valid path starts at start, ends at goal and moves one free cell at a time.
+//
+
+#ifndef PLANNER_CHECK_H
+#define PLANNER_CHECK_H
+
+#include <cstdint>
+
+// Run the checks for the given number of rounds. Prints the first mismatches and the totals,
+// returns 0 if every planner agreed with the references, -1 otherwise.
+int planner_check_main(uint32_t seed = 1, int rounds = 2000);
+
+#endif //PLANNER_CHECK_H
@@ -0,0 +1,196 @@
+#include "protocol.h"
+
+#include <array>
+#include <cstring>
+
+namespace {
+
+constexpr std::array<uint16_t, 256> makeCrcTable() {
+    std::array<uint16_t, 256> table{};
+    for (int i = 0; i < 256; ++i) {
+        uint16_t crc = static_cast<uint16_t>(i << 8);
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021) : static_cast<uint16_t>(crc << 1);
+        }
+        table[i] = crc;
+    }
+    return table;
+}
+
+constexpr std::array<uint16_t, 256> CRC_TABLE = makeCrcTable();
+
+} // namespace
+
+const char* msgTypeName(MsgType type) {
+    switch (type) {
+        case MsgType::Motion: return "Motion";
+        case MsgType::Text: return "Text";
+        case MsgType::Ack: return "Ack";
+        case MsgType::Stop: return "Stop";
+        case MsgType::TimeSync: return "TimeSync";
+        case MsgType::Sync: return "Sync";
+        case MsgType::Telemetry: return "Telemetry";
+    }
+    return "Unknown";
+}
+
+uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; ++i) {
+        crc = static_cast<uint16_t>((crc << 8) ^ CRC_TABLE[((crc >> 8) ^ data[i]) & 0xFF]);
+    }
+    return crc;
+}
+
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t writeIndex = 1;
+    size_t codeIndex = 0;
+    uint8_t code = 1;
+
+    for (size_t readIndex = 0; readIndex < length; ++readIndex) {
+        if (in[readIndex] == 0) {
+            // Close the current block, the zero itself is implied by the code byte
+            out[codeIndex] = code;
+            code = 1;
+            codeIndex = writeIndex++;
+        } else {
+            out[writeIndex++] = in[readIndex];
+            ++code;
+            if (code == 0xFF) {
+                // Maximum block length reached
+                out[codeIndex] = code;
+                code = 1;
+                codeIndex = writeIndex++;
+            }
+        }
+    }
+    out[codeIndex] = code;
+    return writeIndex;
+}
+
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out) {
+    size_t readIndex = 0;
+    size_t writeIndex = 0;
+
+    while (readIndex < length) {
+        uint8_t code = in[readIndex++];
+        if (code == 0 || readIndex + code - 1 > length) {
+            return 0; // Zero inside a frame or block running past the end
+        }
+        for (uint8_t i = 1; i < code; ++i) {
+            if (in[readIndex] == 0) return 0;
+            out[writeIndex++] = in[readIndex++];
+        }
+        // A block shorter than 254 bytes stands for a zero, except at the very end
+        if (code != 0xFF && readIndex < length) {
+            out[writeIndex++] = 0;
+        }
+    }
+    return writeIndex;
+}
+
+bool makeFrame(Frame& frame, MsgType type, uint8_t seq, const void* payload, size_t length) {
+    if (length > FRAME_MAX_PAYLOAD) return false;
+    frame.type = type;
+    frame.seq = seq;
+    frame.length = static_cast<uint8_t>(length);
+    if (length > 0) {
+        std::memcpy(frame.payload, payload, length);
+    }
+    return true;
+}
+
+bool makeMotionFrame(Frame& frame, uint8_t seq, const char* action) {
+    if (action == nullptr) return false;
+    char direction = action[0];
+    if (direction != 'F' && direction != 'B' && direction != 'L' && direction != 'R') return false;
+    if (action[1] == '\0') return false;
+
+    uint32_t distance = 0;
+    for (const char* c = action + 1; *c != '\0'; ++c) {
+        if (*c < '0' || *c > '9') return false;
+        distance = distance * 10 + static_cast<uint32_t>(*c - '0');
+        if (distance > 0xFFFF) return false;
+    }
+
+    uint8_t payload[3];
+    payload[0] = static_cast<uint8_t>(direction);
+    putU16(payload + 1, static_cast<uint16_t>(distance));
+    return makeFrame(frame, MsgType::Motion, seq, payload, sizeof(payload));
+}
+
+bool makeCommandFrame(Frame& frame, uint8_t seq, const char* command) {
+    return makeMotionFrame(frame, seq, command) || makeFrame(frame, MsgType::Text, seq, command, strlen(command));
+}
+
+size_t encodeFrame(const Frame& frame, uint8_t* out, size_t capacity) {
+    if (frame.length > FRAME_MAX_PAYLOAD) return 0;
+
+    uint8_t raw[FRAME_MAX_RAW];
+    size_t rawLength = 0;
+    raw[rawLength++] = static_cast<uint8_t>(frame.type);
+    raw[rawLength++] = frame.seq;
+    std::memcpy(raw + rawLength, frame.payload, frame.length);
+    rawLength += frame.length;
+    putU16(raw + rawLength, crc16Ccitt(raw, rawLength));
+    rawLength += FRAME_CRC_SIZE;
+
+    // Worst case COBS size plus delimiter
+    if (capacity < rawLength + rawLength / 254 + 2) return 0;
+    size_t encodedLength = cobsEncode(raw, rawLength, out);
+    out[encodedLength++] = 0;
+    return encodedLength;
+}
+
+int writeFrame(serialib& serial, const Frame& frame) {
+    uint8_t encoded[FRAME_MAX_ENCODED];
+    size_t length = encodeFrame(frame, encoded, sizeof(encoded));
+    if (length == 0) return -1;
+    return serial.writeBytes(encoded, static_cast<unsigned int>(length));
+}
+
+bool FrameDecoder::push(uint8_t byte, Frame& out) {
+    if (byte != 0) {
+        if (discarding) return false;
+        if (bufferLength == sizeof(buffer)) {
+            // Too long for any valid frame, wait for the next delimiter
+            ++overflowed;
+            discarding = true;
+            bufferLength = 0;
+            return false;
+        }
+        buffer[bufferLength++] = byte;
+        return false;
+    }
+
+    // Delimiter reached
+    size_t encodedLength = bufferLength;
+    bool wasDiscarding = discarding;
+    bufferLength = 0;
+    discarding = false;
+    if (wasDiscarding || encodedLength == 0) return false; // Overflowed frame or idle delimiter
+
+    uint8_t raw[FRAME_MAX_ENCODED]; // Decoded data is never longer than the encoded data
+    size_t rawLength = cobsDecode(buffer, encodedLength, raw);
+    if (rawLength < FRAME_HEADER_SIZE + FRAME_CRC_SIZE || rawLength > FRAME_MAX_RAW) {
+        ++malformed;
+        return false;
+    }
+
+    size_t crcOffset = rawLength - FRAME_CRC_SIZE;
+    if (crc16Ccitt(raw, crcOffset) != getU16(raw + crcOffset)) {
+        ++crcFailures;
+        return false;
+    }
+
+    out.type = static_cast<MsgType>(raw[0]);
+    out.seq = raw[1];
+    out.length = static_cast<uint8_t>(crcOffset - FRAME_HEADER_SIZE);
+    std::memcpy(out.payload, raw + FRAME_HEADER_SIZE, out.length);
+    ++decoded;
+    return true;
+}
+
+void FrameDecoder::reset() {
+    bufferLength = 0;
+    discarding = false;
+}
@@ -0,0 +1,118 @@
+//
+// Binary frame protocol used on the UART link with the STM32 board.
+//
+// Wire format of one frame (before COBS encoding):
+//   [type:1][seq:1][payload:0..FRAME_MAX_PAYLOAD][crc16:2, little endian]
+// The CRC16 (CCITT, poly 0x1021, init 0xFFFF) covers type, seq and payload.
+// The raw frame is COBS encoded so it never contains 0x00, and a single
+// 0x00 byte is appended as frame delimiter.
+//
+
+#ifndef PROTOCOL_H
+#define PROTOCOL_H
+
+#include <cstdint>
+#include <cstddef>
+#include "serialib.h"
+
+// Types of the messages exchanged with the STM32
+enum class MsgType : uint8_t {
+    Motion    = 0x01, // Motion segment: action char + distance in mm (uint16)
+    Text      = 0x02, // Free text, e.g. a debug command typed in the console
+    Ack       = 0x03, // Acknowledgement, seq holds the acknowledged sequence number
+    Stop      = 0x04, // Emergency stop, no payload. Sent outside the sliding window and echoed back
+                      // by the STM32 (same seq) once the motors are stopped
+    TimeSync  = 0x05, // Clock synchronisation ping, answered by the STM32 with its timestamps, see clock_sync.h
+    Sync      = 0x06, // Resynchronisation of the sliding window sequence numbers (new session, reconnection),
+                      // answered by the STM32 with the next seq it expects, see transport.h
+    Telemetry = 0x10, // Odometry and IMU sample streamed by the STM32, see telemetry.h
+};
+
+constexpr size_t FRAME_MAX_PAYLOAD = 64;
+// type + seq + payload + crc16
+constexpr size_t FRAME_HEADER_SIZE = 2;
+constexpr size_t FRAME_CRC_SIZE = 2;
+constexpr size_t FRAME_MAX_RAW = FRAME_HEADER_SIZE + FRAME_MAX_PAYLOAD + FRAME_CRC_SIZE;
+// COBS adds one byte per 254 data bytes (plus the leading code byte), then the 0x00 delimiter
+constexpr size_t FRAME_MAX_ENCODED = FRAME_MAX_RAW + FRAME_MAX_RAW / 254 + 2;
+
+// One decoded message
+struct Frame {
+    MsgType type = MsgType::Text;
+    uint8_t seq = 0;
+    uint8_t length = 0;
+    uint8_t payload[FRAME_MAX_PAYLOAD] = {};
+};
+
+// Little-endian helpers for payload fields
+inline void putU16(uint8_t* dst, uint16_t value) {
+    dst[0] = static_cast<uint8_t>(value);
+    dst[1] = static_cast<uint8_t>(value >> 8);
+}
+inline uint16_t getU16(const uint8_t* src) {
+    return static_cast<uint16_t>(src[0] | (src[1] << 8));
+}
+inline void putU32(uint8_t* dst, uint32_t value) {
+    for (int i = 0; i < 4; ++i) dst[i] = static_cast<uint8_t>(value >> (8 * i));
+}
+inline uint32_t getU32(const uint8_t* src) {
+    return static_cast<uint32_t>(src[0]) | (static_cast<uint32_t>(src[1]) << 8) |
+           (static_cast<uint32_t>(src[2]) << 16) | (static_cast<uint32_t>(src[3]) << 24);
+}
+
+// Name of a message type for logs and journal dumps, "Unknown" for values outside the enum
+const char* msgTypeName(MsgType type);
+
+// CRC16-CCITT of a buffer, can be chained through the crc parameter
+uint16_t crc16Ccitt(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+// COBS encoding, out must hold length + length / 254 + 1 bytes. Returns the encoded size.
+size_t cobsEncode(const uint8_t* in, size_t length, uint8_t* out);
+
+// COBS decoding (without the 0x00 delimiter). Returns the decoded size, 0 on malformed input.
+size_t cobsDecode(const uint8_t* in, size_t length, uint8_t* out);
+
+// Fill a frame. Returns false if the payload does not fit.
+bool makeFrame(Frame& frame, MsgType type, uint8_t seq, const void* payload, size_t length);
+
+// Build a motion frame from an action string such as "F100" or "R5". Returns false if the text is not a motion command.
+bool makeMotionFrame(Frame& frame, uint8_t seq, const char* action);
+
+// Build a Motion frame from a motion command, a Text frame from anything else. Returns false if the text is too long.
+bool makeCommandFrame(Frame& frame, uint8_t seq, const char* command);
+
+// Encode a frame with CRC, COBS and delimiter. Returns the number of bytes written, 0 if capacity is too small.
+size_t encodeFrame(const Frame& frame, uint8_t* out, size_t capacity);
+
+// Encode and send a frame. Returns the serialib::writeBytes result.
+int writeFrame(serialib& serial, const Frame& frame);
+
+/**
+ * @brief Incremental frame decoder. Bytes can be pushed as they arrive from the serial port,
+ *        no memory is allocated.
+ */
+class FrameDecoder {
+public:
+    // Push one received byte. Returns true when it completes a valid frame, which is stored in out.
+    bool push(uint8_t byte, Frame& out);
+
+    // Drop any partially received frame
+    void reset();
+
+    uint32_t framesDecoded() const { return decoded; }
+    uint32_t crcErrors() const { return crcFailures; }
+    uint32_t framingErrors() const { return malformed; }
+    uint32_t overflows() const { return overflowed; }
+
+private:
+    uint8_t buffer[FRAME_MAX_ENCODED] = {};
+    size_t bufferLength = 0;
+    bool discarding = false; // Skipping bytes until the next delimiter after an overflow
+
+    uint32_t decoded = 0;
+    uint32_t crcFailures = 0;
+    uint32_t malformed = 0;
+    uint32_t overflowed = 0;
+};
+
+#endif //PROTOCOL_H
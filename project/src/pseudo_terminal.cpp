@@ -0,0 +1,34 @@
+#include "pseudo_terminal.h"
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+bool PseudoTerminal::open() {
+    close();
+
+    master = posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+    if (master < 0) return false;
+    char name[128];
+    if (grantpt(master) != 0 || unlockpt(master) != 0 || ptsname_r(master, name, sizeof(name)) != 0) {
+        close();
+        return false;
+    }
+    path = name;
+
+    // Raw line until the host configures the port, so nothing is echoed or translated
+    struct termios options;
+    if (tcgetattr(master, &options) == 0) {
+        cfmakeraw(&options);
+        tcsetattr(master, TCSANOW, &options);
+    }
+    slave = ::open(name, O_RDWR | O_NOCTTY | O_NONBLOCK);
+    return true;
+}
+
+void PseudoTerminal::close() {
+    if (slave >= 0) ::close(slave);
+    if (master >= 0) ::close(master);
+    slave = master = -1;
+}
@@ -0,0 +1,20 @@
+//
+// Pseudo-terminal pair used to stand in for the STM32 serial port (simulator, journal replay).
+//
+
+#ifndef PSEUDO_TERMINAL_H
+#define PSEUDO_TERMINAL_H
+
+#include <string>
+
+struct PseudoTerminal {
+    int master = -1;  // Non-blocking, raw: the side played by the fake device
+    int slave = -1;   // Kept open so the master never sees a hang up between host sessions
+    std::string path; // Slave path, to pass to serialib::openDevice
+
+    // Create the pair. Returns false if the system has no pty available.
+    bool open();
+    void close();
+};
+
+#endif //PSEUDO_TERMINAL_H
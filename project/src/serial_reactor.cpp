@@ -0,0 +1,166 @@
+#include "serial_reactor.h"
+
+#include <cerrno>
+#include <memory>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "monotonic_clock.h"
+
+namespace {
+
+constexpr int MAX_EVENTS = 16;
+// epoll data of the stop() eventfd, device ids are >= 0
+constexpr uint64_t WAKE_ID = UINT64_MAX;
+
+} // namespace
+
+SerialReactor::SerialReactor() {
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epollFd >= 0 && wakeFd >= 0) {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.u64 = WAKE_ID;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &event);
+    }
+}
+
+SerialReactor::~SerialReactor() {
+    if (wakeFd >= 0) close(wakeFd);
+    if (epollFd >= 0) close(epollFd);
+}
+
+int SerialReactor::addDevice(serialib& device, DataHandler onData, ErrorHandler onError) {
+    int fd = device.getFileDescriptor();
+    if (!isValid() || fd < 0 || !onData) return -1;
+
+    bool nested = dispatchThread.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    std::unique_lock<std::mutex> lock(mutex, std::defer_lock);
+    if (!nested) lock.lock();
+
+    int id = nextId++;
+    struct epoll_event event = {};
+    event.events = EPOLLIN;
+    event.data.u64 = static_cast<uint64_t>(id);
+    if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) != 0) return -1;
+
+    Device& entry = devices[id];
+    entry.serial = &device;
+    entry.fd = fd;
+    entry.onData = std::move(onData);
+    entry.onError = std::move(onError);
+    return id;
+}
+
+int SerialReactor::addFrameDevice(serialib& device, FrameHandler onFrame, ErrorHandler onError) {
+    if (!onFrame) return -1;
+    auto decoder = std::make_shared<FrameDecoder>();
+    return addDevice(device,
+                     [decoder, onFrame = std::move(onFrame)](const uint8_t* data, size_t length, int64_t time_ns) {
+                         Frame frame;
+                         for (size_t i = 0; i < length; ++i) {
+                             if (decoder->push(data[i], frame)) onFrame(frame, time_ns);
+                         }
+                     },
+                     std::move(onError));
+}
+
+bool SerialReactor::unregister(int id) {
+    auto it = devices.find(id);
+    if (it == devices.end() || it->second.removed) return false;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, it->second.fd, nullptr);
+    if (dispatchThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        // The callback being run may belong to this device, erase it after the dispatch
+        it->second.removed = true;
+    } else {
+        devices.erase(it);
+    }
+    return true;
+}
+
+bool SerialReactor::removeDevice(int id) {
+    if (dispatchThread.load(std::memory_order_relaxed) == std::this_thread::get_id()) {
+        return unregister(id); // Called from a callback, the mutex is already held
+    }
+    std::lock_guard<std::mutex> lock(mutex);
+    return unregister(id);
+}
+
+size_t SerialReactor::deviceCount() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    size_t count = 0;
+    for (const auto& entry : devices) count += !entry.second.removed;
+    return count;
+}
+
+bool SerialReactor::serve(Device& device, int64_t time_ns) {
+    // Level triggered: whatever is not read now wakes the next epoll_wait immediately.
+    // The 1 ms timeout only matters if the wake-up was spurious.
+    int received = device.serial->readAvailable(buffer, sizeof(buffer), 1);
+    if (received < 0) return false;
+    if (received > 0) device.onData(buffer, static_cast<size_t>(received), time_ns);
+    return true;
+}
+
+int SerialReactor::poll(int timeout_ms) {
+    if (!isValid()) return -1;
+    struct epoll_event events[MAX_EVENTS];
+    int count;
+    do {
+        count = epoll_wait(epollFd, events, MAX_EVENTS, timeout_ms);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) return -1;
+
+    // Same timestamp for everything that was ready at once
+    int64_t now = monotonicNanos();
+    int served = 0;
+    std::vector<ErrorHandler> failures;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    dispatchThread.store(std::this_thread::get_id(), std::memory_order_relaxed);
+    for (int i = 0; i < count; ++i) {
+        if (events[i].data.u64 == WAKE_ID) {
+            uint64_t counter;
+            (void)!read(wakeFd, &counter, sizeof(counter));
+            continue;
+        }
+        int id = static_cast<int>(events[i].data.u64);
+        auto it = devices.find(id);
+        if (it == devices.end() || it->second.removed) continue; // Removed by an earlier callback
+        // A callback may add devices: keep a reference, the iterator does not survive a rehash
+        Device& device = it->second;
+
+        bool ok = (events[i].events & EPOLLIN) != 0 && serve(device, now);
+        if (!ok || (events[i].events & (EPOLLERR | EPOLLHUP))) {
+            // A hung up device stays readable forever, drop it and tell the owner outside the lock
+            if (device.onError) failures.push_back(device.onError);
+            unregister(id);
+        }
+        ++served;
+    }
+    dispatchThread.store(std::thread::id(), std::memory_order_relaxed);
+
+    for (auto it = devices.begin(); it != devices.end();) {
+        it = it->second.removed ? devices.erase(it) : std::next(it);
+    }
+    // The owner may close or reopen the device from its error handler
+    lock.unlock();
+    for (const ErrorHandler& onError : failures) onError();
+    return served;
+}
+
+void SerialReactor::run() {
+    while (!stopRequested.load(std::memory_order_acquire)) {
+        if (poll(-1) < 0) break;
+    }
+    // Ready for the next run()
+    stopRequested.store(false, std::memory_order_release);
+}
+
+void SerialReactor::stop() {
+    stopRequested.store(true, std::memory_order_release);
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+}
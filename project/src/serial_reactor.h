@@ -0,0 +1,81 @@
+//
+// Event loop serving several serial devices from one thread (STM32, lidar, ultrasonic array ...).
+//
+// Every registered serialib device is watched by one epoll instance: the loop sleeps until one of
+// them has data, reads what is pending and hands it to the decoder/callback of that device. The
+// cost is one thread and one wake-up per batch of data, whatever the number of devices.
+//
+
+#ifndef SERIAL_REACTOR_H
+#define SERIAL_REACTOR_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include "protocol.h"
+#include "serialib.h"
+
+class SerialReactor {
+public:
+    // Raw bytes received from a device, with the monotonicNanos() time of the read
+    using DataHandler = std::function<void(const uint8_t* data, size_t length, int64_t time_ns)>;
+    // Frame decoded from a device speaking the STM32 frame protocol
+    using FrameHandler = std::function<void(const Frame& frame, int64_t time_ns)>;
+    // The device failed (unplugged, read error). It has already been removed from the reactor.
+    using ErrorHandler = std::function<void()>;
+
+    SerialReactor();
+    ~SerialReactor();
+    SerialReactor(const SerialReactor&) = delete;
+    SerialReactor& operator=(const SerialReactor&) = delete;
+
+    // False if the epoll instance could not be created
+    bool isValid() const { return epollFd >= 0 && wakeFd >= 0; }
+
+    // Register an open device with its own decoding, returns its id or -1.
+    // The device must stay open until it is removed; it must not be read by anyone else meanwhile.
+    int addDevice(serialib& device, DataHandler onData, ErrorHandler onError = {});
+    // Register a device speaking the frame protocol, decoded by its own FrameDecoder
+    int addFrameDevice(serialib& device, FrameHandler onFrame, ErrorHandler onError = {});
+    // Unregister a device. After it returns, no callback of the device runs any more
+    // (when called from another thread, it waits for the running callback of the device).
+    bool removeDevice(int id);
+    size_t deviceCount() const;
+
+    // Wait up to timeout_ms (-1: forever) and serve the ready devices. Returns the number of devices served, -1 on error.
+    int poll(int timeout_ms);
+    // Serve the devices in the calling thread until stop()
+    void run();
+    // Make run() return, callable from any thread or callback
+    void stop();
+
+private:
+    struct Device {
+        serialib* serial = nullptr;
+        int fd = -1;
+        DataHandler onData;
+        ErrorHandler onError;
+        bool removed = false; // Removed from one of its own callbacks, erased after the dispatch
+    };
+
+    // Read what the device has and dispatch it. Returns false if the device failed.
+    bool serve(Device& device, int64_t time_ns);
+    bool unregister(int id);
+
+    int epollFd = -1;
+    int wakeFd = -1; // eventfd used by stop()
+    std::atomic<bool> stopRequested{false};
+
+    mutable std::mutex mutex; // Protects devices, held while the callbacks run
+    std::unordered_map<int, Device> devices;
+    int nextId = 0;
+    std::atomic<std::thread::id> dispatchThread{}; // Thread running the callbacks, if any
+
+    uint8_t buffer[4096];
+};
+
+#endif //SERIAL_REACTOR_H
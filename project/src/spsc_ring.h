@@ -0,0 +1,63 @@
+//
+// Lock-free single-producer / single-consumer ring buffer.
+// Exactly one thread may call push() and exactly one (other) thread may call pop().
+//
+
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // Producer side. Returns false if the ring is full.
+    bool push(const T& item) {
+        size_t currentTail = tail.load(std::memory_order_relaxed);
+        if (currentTail - cachedHead == Capacity) {
+            // Refresh the consumer position only when the ring looks full
+            cachedHead = head.load(std::memory_order_acquire);
+            if (currentTail - cachedHead == Capacity) return false;
+        }
+        slots[currentTail & (Capacity - 1)] = item;
+        tail.store(currentTail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side. Returns false if the ring is empty.
+    bool pop(T& item) {
+        size_t currentHead = head.load(std::memory_order_relaxed);
+        if (currentHead == cachedTail) {
+            // Refresh the producer position only when the ring looks empty
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (currentHead == cachedTail) return false;
+        }
+        item = slots[currentHead & (Capacity - 1)];
+        head.store(currentHead + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Approximate number of items, exact when called from the producer or consumer while the other side is idle
+    size_t size() const {
+        // Read head first: it never passes tail, so the difference cannot underflow
+        size_t currentHead = head.load(std::memory_order_acquire);
+        return tail.load(std::memory_order_acquire) - currentHead;
+    }
+
+    bool empty() const { return size() == 0; }
+
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    // Producer and consumer indices live on separate cache lines to avoid false sharing
+    alignas(64) std::atomic<size_t> head{0}; // Next slot to read, written by the consumer
+    size_t cachedTail = 0;                   // Consumer copy of tail
+    alignas(64) std::atomic<size_t> tail{0}; // Next slot to write, written by the producer
+    size_t cachedHead = 0;                   // Producer copy of head
+    alignas(64) T slots[Capacity];
+};
+
+#endif //SPSC_RING_H
@@ -0,0 +1,286 @@
+#include "stm32_simulator.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <poll.h>
+#include <unistd.h>
+#include "clock_sync.h"
+#include "telemetry.h"
+
+namespace {
+
+constexpr int32_t TICKS_PER_MM = 4;          // Simulated encoder resolution
+constexpr int32_t TICKS_PER_SECOND = 2000;   // Simulated wheel speed
+// Receive FIFO of the simulated UART. When the line is paced, the host bytes beyond it stay in the
+// pty like they would stay in the driver of a real UART, where the host can still reorder them.
+constexpr size_t UART_RX_FIFO = 16;
+
+} // namespace
+
+Stm32Simulator::Stm32Simulator(const SimulatorConfig& config)
+    : config(config), random(config.seed) {
+    if (config.baudRate > 0) {
+        // 8N1: start bit + 8 data bits + stop bit
+        byteTime = std::chrono::nanoseconds(10'000'000'000LL / config.baudRate);
+    }
+}
+
+Stm32Simulator::~Stm32Simulator() {
+    stop();
+}
+
+bool Stm32Simulator::start() {
+    stop();
+
+    if (!pty.open()) return false;
+    if (!publishLink()) {
+        pty.close();
+        return false;
+    }
+
+    decoder.reset();
+    receiver.reset();
+    replies.clear();
+    startTime = Clock::now();
+    inputLine = outputLine = nextTelemetry = startTime;
+
+    unplugRequest.store(-1, std::memory_order_relaxed);
+    online.store(true, std::memory_order_relaxed);
+    running.store(true, std::memory_order_release);
+    worker = std::thread(&Stm32Simulator::run, this);
+    return true;
+}
+
+void Stm32Simulator::stop() {
+    running.store(false, std::memory_order_release);
+    if (worker.joinable()) worker.join();
+    pty.close();
+    if (!config.linkPath.empty()) unlink(config.linkPath.c_str());
+    online.store(false, std::memory_order_relaxed);
+}
+
+bool Stm32Simulator::unplug(std::chrono::milliseconds downtime) {
+    if (config.linkPath.empty() || !running.load(std::memory_order_acquire)) return false;
+    unplugRequest.store(std::max<int64_t>(downtime.count(), 0), std::memory_order_relaxed);
+    return true;
+}
+
+bool Stm32Simulator::publishLink() {
+    if (config.linkPath.empty()) return true;
+    std::string temporary = config.linkPath + ".new";
+    unlink(temporary.c_str());
+    return symlink(pty.path.c_str(), temporary.c_str()) == 0 && rename(temporary.c_str(), config.linkPath.c_str()) == 0;
+}
+
+uint8_t Stm32Simulator::corrupt(uint8_t byte) {
+    if (config.byteErrorRate > 0.0 && std::uniform_real_distribution<double>(0.0, 1.0)(random) < config.byteErrorRate) {
+        corruptedCount.fetch_add(1, std::memory_order_relaxed);
+        return static_cast<uint8_t>(byte ^ (1u << (random() % 8)));
+    }
+    return byte;
+}
+
+uint32_t Stm32Simulator::deviceTime(Clock::time_point time) const {
+    double elapsed_us = std::chrono::duration<double, std::micro>(time - startTime).count();
+    return static_cast<uint32_t>(static_cast<uint64_t>(elapsed_us * (1.0 + config.clockDrift_ppm * 1e-6)));
+}
+
+void Stm32Simulator::queueReply(const Frame& frame, Clock::time_point due) {
+    replies.push_back({due, frame});
+}
+
+void Stm32Simulator::handleFrame(const Frame& frame, Clock::time_point now) {
+    receivedCount.fetch_add(1, std::memory_order_relaxed);
+    Clock::time_point due = now + config.processingDelay;
+
+    if (frame.type == MsgType::Stop) {
+        // Halt where the wheels are, drop the rest of the current motion, and confirm with the same seq
+        stopCount.fetch_add(1, std::memory_order_relaxed);
+        targetTicks = odometerTicks;
+        queueReply(frame, due);
+        return;
+    }
+    if (frame.type == MsgType::TimeSync) {
+        // t2 now, t3 when the reply starts on the line (see run())
+        TimeSyncMessage message;
+        if (!decodeTimeSync(frame, message)) return;
+        message.deviceReceive_us = deviceTime(now);
+        Frame reply;
+        makeTimeSyncFrame(reply, frame.seq, message);
+        queueReply(reply, due);
+        return;
+    }
+    if (frame.type == MsgType::Sync) {
+        // New host session or reconnection: tell the host where the receiver is, it replays the rest
+        if (frame.length != SYNC_REQUEST_SIZE) return;
+        uint8_t expected = receiver.resync(frame.payload[0], frame.payload[1]);
+        Frame reply;
+        makeFrame(reply, MsgType::Sync, frame.seq, &expected, SYNC_REPLY_SIZE);
+        queueReply(reply, due);
+        return;
+    }
+    if (!isReliable(frame.type)) return; // Nothing else is expected from the host yet
+
+    uint8_t ackSeq;
+    if (receiver.accept(frame.seq, ackSeq)) {
+        executedCount.fetch_add(1, std::memory_order_relaxed);
+        if (frame.type == MsgType::Motion) {
+            targetTicks += static_cast<int32_t>(getU16(frame.payload + 1)) * TICKS_PER_MM;
+        } else if (frame.type == MsgType::Text) {
+            // Echo text back, like the firmware debug console
+            Frame echo = frame;
+            queueReply(echo, due);
+        }
+    } else {
+        duplicateCount.store(receiver.duplicates(), std::memory_order_relaxed);
+    }
+
+    Frame ack;
+    makeFrame(ack, MsgType::Ack, ackSeq, nullptr, 0);
+    queueReply(ack, due);
+}
+
+void Stm32Simulator::sendTelemetry(Clock::time_point now) {
+    int32_t step = TICKS_PER_SECOND / static_cast<int32_t>(config.telemetryRate_hz);
+    odometerTicks = std::min(targetTicks, odometerTicks + std::max(step, 1));
+
+    TelemetrySample sample;
+    sample.deviceTime_us = deviceTime(now);
+    sample.leftTicks = odometerTicks;
+    sample.rightTicks = odometerTicks;
+    sample.accel[2] = 16384; // 1 g on the Z axis at rest
+
+    Frame frame;
+    makeTelemetryFrame(frame, telemetrySeq++, sample);
+    queueReply(frame, now);
+}
+
+void Stm32Simulator::run() {
+    uint8_t buffer[512];
+    // Each queued output byte carries the time at which it has completely left the simulated UART
+    std::deque<std::pair<Clock::time_point, uint8_t>> pendingOutput;
+    std::deque<std::pair<Clock::time_point, uint8_t>> pendingInput;
+    bool unplugged = false;
+    Clock::time_point replugTime;
+
+    while (running.load(std::memory_order_acquire)) {
+        Clock::time_point now = Clock::now();
+
+        // 0. USB adapter unplugged: the host side disappears with what was on the line, the STM32 keeps running
+        int64_t downtime = unplugRequest.exchange(-1, std::memory_order_relaxed);
+        if (downtime >= 0) {
+            unlink(config.linkPath.c_str());
+            pty.close();
+            online.store(false, std::memory_order_relaxed);
+            unplugCount.fetch_add(1, std::memory_order_relaxed);
+            pendingInput.clear();
+            pendingOutput.clear();
+            replies.clear();
+            decoder.reset();
+            unplugged = true;
+            replugTime = now + std::chrono::milliseconds(downtime);
+        }
+        if (unplugged) {
+            if (now >= replugTime) {
+                if (pty.open() && publishLink()) {
+                    unplugged = false;
+                    online.store(true, std::memory_order_relaxed);
+                    inputLine = outputLine = now;
+                } else {
+                    pty.close();
+                    replugTime = now + std::chrono::milliseconds(10); // No pty available, try again
+                }
+            }
+            if (unplugged) {
+                // Telemetry keeps the odometer moving, the frames go nowhere
+                if (config.telemetryRate_hz > 0 && now >= nextTelemetry) {
+                    sendTelemetry(now);
+                    replies.clear();
+                    nextTelemetry = now + std::chrono::microseconds(1'000'000 / config.telemetryRate_hz);
+                }
+                Clock::time_point wake = std::min(replugTime, now + std::chrono::milliseconds(50));
+                if (config.telemetryRate_hz > 0) wake = std::min(wake, nextTelemetry);
+                std::this_thread::sleep_until(wake);
+                continue;
+            }
+        }
+
+        // 1. Bytes from the host that have finished arriving go to the decoder
+        while (!pendingInput.empty() && pendingInput.front().first <= now) {
+            Frame frame;
+            if (decoder.push(pendingInput.front().second, frame)) {
+                handleFrame(frame, now);
+            }
+            pendingInput.pop_front();
+        }
+        crcErrorCount.store(decoder.crcErrors(), std::memory_order_relaxed);
+
+        // 2. Telemetry stream
+        if (config.telemetryRate_hz > 0 && now >= nextTelemetry) {
+            sendTelemetry(now);
+            nextTelemetry += std::chrono::microseconds(1'000'000 / config.telemetryRate_hz);
+            if (nextTelemetry < now) nextTelemetry = now; // Do not burst after a stall
+        }
+
+        // 3. Replies whose processing delay elapsed are serialised on the line
+        while (!replies.empty() && replies.front().due <= now) {
+            Frame& reply = replies.front().frame;
+            TimeSyncMessage message;
+            if (decodeTimeSync(reply, message)) {
+                message.deviceTransmit_us = deviceTime(std::max(outputLine, now));
+                makeTimeSyncFrame(reply, reply.seq, message);
+            }
+            uint8_t encoded[FRAME_MAX_ENCODED];
+            size_t length = encodeFrame(reply, encoded, sizeof(encoded));
+            for (size_t i = 0; i < length; ++i) {
+                outputLine = std::max(outputLine, now) + byteTime;
+                pendingOutput.emplace_back(outputLine, corrupt(encoded[i]));
+            }
+            replies.pop_front();
+        }
+
+        // 4. Deliver the output bytes that have been "transmitted" by now, in one write
+        size_t ready = 0;
+        while (ready < pendingOutput.size() && ready < sizeof(buffer) && pendingOutput[ready].first <= now) {
+            buffer[ready] = pendingOutput[ready].second;
+            ++ready;
+        }
+        if (ready > 0) {
+            ssize_t written = write(pty.master, buffer, ready);
+            if (written > 0) {
+                pendingOutput.erase(pendingOutput.begin(), pendingOutput.begin() + written);
+            }
+        }
+
+        // 5. Sleep until the next byte, reply or telemetry event, or until the host writes
+        Clock::time_point wake = now + std::chrono::milliseconds(50);
+        if (!pendingInput.empty()) wake = std::min(wake, pendingInput.front().first);
+        if (!replies.empty()) wake = std::min(wake, replies.front().due);
+        if (!pendingOutput.empty()) wake = std::min(wake, pendingOutput.front().first);
+        if (config.telemetryRate_hz > 0) wake = std::min(wake, nextTelemetry);
+
+        // The host may not be reading: wait for room instead of spinning on a full pty
+        bool outputBlocked = ready > 0 && !pendingOutput.empty() && pendingOutput.front().first <= now;
+        // Paced line with a full receive FIFO: leave the host bytes in the pty until the FIFO drains
+        size_t room = sizeof(buffer);
+        if (byteTime.count() > 0) room = UART_RX_FIFO - std::min(pendingInput.size(), UART_RX_FIFO);
+        short events = static_cast<short>((room > 0 ? POLLIN : 0) | (outputBlocked ? POLLOUT : 0));
+        struct pollfd pfd = {pty.master, events, 0};
+        auto left = std::chrono::duration_cast<std::chrono::nanoseconds>(wake - Clock::now());
+        if (outputBlocked) left = std::chrono::milliseconds(1);
+        struct timespec timeout = {0, 0};
+        if (left.count() > 0) {
+            timeout.tv_sec = static_cast<time_t>(left.count() / 1'000'000'000LL);
+            timeout.tv_nsec = static_cast<long>(left.count() % 1'000'000'000LL);
+        }
+        if (ppoll(&pfd, 1, &timeout, nullptr) <= 0 || !(pfd.revents & POLLIN)) continue;
+
+        // 6. New bytes from the host start their (simulated) transmission now
+        ssize_t received = read(pty.master, buffer, room);
+        Clock::time_point arrival = Clock::now();
+        for (ssize_t i = 0; i < received; ++i) {
+            inputLine = std::max(inputLine, arrival) + byteTime;
+            pendingInput.emplace_back(inputLine, corrupt(buffer[i]));
+        }
+    }
+}
@@ -0,0 +1,114 @@
+//
+// Software stand-in for the STM32 motor board.
+//
+// Opens a pseudo-terminal pair and speaks the frame protocol on the master side, so the host code
+// can open the slave path with serialib::openDevice exactly like /dev/ttyUSB0. It acknowledges
+// reliable frames like the firmware (ReliableReceiver), echoes Text and Stop frames back, answers
+// TimeSync and Sync frames and can stream telemetry, with configurable processing delay, baud-rate
+// pacing, byte corruption and clock drift. With a device link, unplug() simulates the USB-serial
+// adapter dropping off the bus while the STM32 keeps running.
+//
+
+#ifndef STM32_SIMULATOR_H
+#define STM32_SIMULATOR_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <random>
+#include <string>
+#include <thread>
+#include "protocol.h"
+#include "pseudo_terminal.h"
+#include "transport.h"
+
+struct SimulatorConfig {
+    std::chrono::microseconds processingDelay{0}; // Delay between a complete frame and its reply
+    unsigned int baudRate = 0;                    // Line rate used to pace both directions (10 bits per byte), 0 = unlimited
+    double byteErrorRate = 0.0;                   // Probability of flipping one bit of each byte, in both directions
+    unsigned int telemetryRate_hz = 0;            // Telemetry frames per second, 0 = no telemetry
+    uint32_t seed = 1;                            // Seed of the error injection
+    double clockDrift_ppm = 0.0;                  // Rate error of the simulated STM32 clock (positive: runs fast)
+    std::string linkPath;                         // Symlink to the pty slave maintained by the simulator, like the
+                                                  // /dev/ttyUSB0 node of an adapter. Empty: no link, unplug() unavailable
+};
+
+class Stm32Simulator {
+public:
+    explicit Stm32Simulator(const SimulatorConfig& config = {});
+    ~Stm32Simulator();
+    Stm32Simulator(const Stm32Simulator&) = delete;
+    Stm32Simulator& operator=(const Stm32Simulator&) = delete;
+
+    // Create the pty pair and start the simulation thread. Returns false if the pty cannot be created.
+    bool start();
+    void stop();
+
+    // Path to pass to serialib::openDevice: the link if configured, otherwise the pty slave
+    const std::string& devicePath() const { return config.linkPath.empty() ? pty.path : config.linkPath; }
+
+    // Disconnect the host for downtime: the pty is closed (the host sees a hang up) and the link removed,
+    // then a new pty appears under the same link. Bytes on the line are lost, the STM32 state is kept.
+    // Returns false without a link.
+    bool unplug(std::chrono::milliseconds downtime);
+    bool connected() const { return online.load(std::memory_order_relaxed); }
+    uint64_t unplugs() const { return unplugCount.load(std::memory_order_relaxed); }
+
+    uint64_t framesReceived() const { return receivedCount.load(std::memory_order_relaxed); }
+    uint64_t commandsExecuted() const { return executedCount.load(std::memory_order_relaxed); }
+    uint64_t stopsReceived() const { return stopCount.load(std::memory_order_relaxed); }
+    uint64_t duplicates() const { return duplicateCount.load(std::memory_order_relaxed); }
+    uint64_t crcErrors() const { return crcErrorCount.load(std::memory_order_relaxed); }
+    uint64_t bytesCorrupted() const { return corruptedCount.load(std::memory_order_relaxed); }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct Reply {
+        Clock::time_point due;
+        Frame frame;
+    };
+
+    void run();
+    // Point the link at the current pty slave (atomically, the host sees one new entry)
+    bool publishLink();
+    void handleFrame(const Frame& frame, Clock::time_point now);
+    void queueReply(const Frame& frame, Clock::time_point due);
+    void sendTelemetry(Clock::time_point now);
+    // Reading of the simulated STM32 microsecond clock at a given time
+    uint32_t deviceTime(Clock::time_point time) const;
+    uint8_t corrupt(uint8_t byte);
+
+    SimulatorConfig config;
+    std::chrono::nanoseconds byteTime{0}; // Time to transmit one byte on the simulated line
+
+    PseudoTerminal pty;
+    std::thread worker;
+    std::atomic<bool> running{false};
+    std::atomic<bool> online{false};
+    std::atomic<int64_t> unplugRequest{-1}; // Requested downtime in ms, -1: none
+
+    // Simulation state, only touched by the worker thread
+    FrameDecoder decoder;
+    ReliableReceiver receiver;
+    std::mt19937 random;
+    std::deque<Reply> replies;    // Replies waiting for the processing delay
+    Clock::time_point inputLine;  // Time at which the last byte from the host finishes arriving
+    Clock::time_point outputLine; // Time at which the last byte to the host finishes leaving
+    Clock::time_point startTime;
+    Clock::time_point nextTelemetry;
+    uint8_t telemetrySeq = 0;
+    int32_t odometerTicks = 0;    // Simulated wheel position
+    int32_t targetTicks = 0;      // Position requested by the motion commands
+
+    std::atomic<uint64_t> receivedCount{0};
+    std::atomic<uint64_t> executedCount{0};
+    std::atomic<uint64_t> stopCount{0};
+    std::atomic<uint64_t> duplicateCount{0};
+    std::atomic<uint64_t> crcErrorCount{0};
+    std::atomic<uint64_t> corruptedCount{0};
+    std::atomic<uint64_t> unplugCount{0};
+};
+
+#endif //STM32_SIMULATOR_H
@@ -0,0 +1,181 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cmath>
+
+bool decodeTelemetry(const Frame& frame, int64_t time_ns, TelemetrySample& out) {
+    if (frame.type != MsgType::Telemetry || frame.length != TELEMETRY_PAYLOAD_SIZE) {
+        return false;
+    }
+    const uint8_t* p = frame.payload;
+    out.time_ns = time_ns;
+    out.deviceTime_us = getU32(p);
+    out.leftTicks = static_cast<int32_t>(getU32(p + 4));
+    out.rightTicks = static_cast<int32_t>(getU32(p + 8));
+    for (int axis = 0; axis < 3; ++axis) {
+        out.gyro[axis] = static_cast<int16_t>(getU16(p + 12 + 2 * axis));
+        out.accel[axis] = static_cast<int16_t>(getU16(p + 18 + 2 * axis));
+    }
+    return true;
+}
+
+void makeTelemetryFrame(Frame& frame, uint8_t seq, const TelemetrySample& sample) {
+    frame.type = MsgType::Telemetry;
+    frame.seq = seq;
+    frame.length = TELEMETRY_PAYLOAD_SIZE;
+    uint8_t* p = frame.payload;
+    putU32(p, sample.deviceTime_us);
+    putU32(p + 4, static_cast<uint32_t>(sample.leftTicks));
+    putU32(p + 8, static_cast<uint32_t>(sample.rightTicks));
+    for (int axis = 0; axis < 3; ++axis) {
+        putU16(p + 12 + 2 * axis, static_cast<uint16_t>(sample.gyro[axis]));
+        putU16(p + 18 + 2 * axis, static_cast<uint16_t>(sample.accel[axis]));
+    }
+}
+
+void TelemetryHistory::append(const TelemetrySample& sample) {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    uint64_t index = published.load(relaxed);
+    size_t slot = index % CAPACITY;
+
+    // Keep the time column sorted even if the caller's clock hiccups
+    int64_t sampleTime = sample.time_ns;
+    if (index > 0) {
+        sampleTime = std::max(sampleTime, time[(index - 1) % CAPACITY].load(relaxed));
+    }
+
+    // Claim the slot before overwriting it: a reader that sees any of the new values also sees the claim
+    claimed.store(index + 1, relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    time[slot].store(sampleTime, relaxed);
+    deviceTime[slot].store(sample.deviceTime_us, relaxed);
+    left[slot].store(sample.leftTicks, relaxed);
+    right[slot].store(sample.rightTicks, relaxed);
+    for (int axis = 0; axis < 3; ++axis) {
+        gyro[axis][slot].store(sample.gyro[axis], relaxed);
+        accel[axis][slot].store(sample.accel[axis], relaxed);
+    }
+    // Publish the slot to the readers
+    published.store(index + 1, std::memory_order_release);
+}
+
+bool TelemetryHistory::appendFrame(const Frame& frame, int64_t time_ns) {
+    TelemetrySample sample;
+    if (!decodeTelemetry(frame, time_ns, sample)) {
+        malformed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    if (haveSeq) {
+        uint8_t gap = static_cast<uint8_t>(frame.seq - lastSeq - 1);
+        if (gap != 0) missed.fetch_add(gap, std::memory_order_relaxed);
+    }
+    haveSeq = true;
+    lastSeq = frame.seq;
+    append(sample);
+    return true;
+}
+
+uint64_t TelemetryHistory::size() const {
+    uint64_t count = published.load(std::memory_order_acquire);
+    // The oldest slot may be under rewrite, it is never handed out
+    return std::min<uint64_t>(count, CAPACITY - 1);
+}
+
+void TelemetryHistory::load(uint64_t index, TelemetrySample& out) const {
+    constexpr auto relaxed = std::memory_order_relaxed;
+    size_t slot = index % CAPACITY;
+    out.time_ns = time[slot].load(relaxed);
+    out.deviceTime_us = deviceTime[slot].load(relaxed);
+    out.leftTicks = left[slot].load(relaxed);
+    out.rightTicks = right[slot].load(relaxed);
+    for (int axis = 0; axis < 3; ++axis) {
+        out.gyro[axis] = gyro[axis][slot].load(relaxed);
+        out.accel[axis] = accel[axis][slot].load(relaxed);
+    }
+}
+
+bool TelemetryHistory::stillValid(uint64_t index) const {
+    // Order the data reads before reading the claims (pairs with the fence in append)
+    std::atomic_thread_fence(std::memory_order_acquire);
+    // The slot of index is rewritten from the claim of index + CAPACITY on
+    if (claimed.load(std::memory_order_relaxed) > index + CAPACITY) {
+        overruns.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+uint64_t TelemetryHistory::lowerBound(uint64_t first, uint64_t last, int64_t time_ns) const {
+    while (first < last) {
+        uint64_t middle = first + (last - first) / 2;
+        if (time[middle % CAPACITY].load(std::memory_order_relaxed) < time_ns) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+bool TelemetryHistory::latest(TelemetrySample& out) const {
+    uint64_t count = published.load(std::memory_order_acquire);
+    if (count == 0) return false;
+    load(count - 1, out);
+    return stillValid(count - 1);
+}
+
+size_t TelemetryHistory::samplesSince(int64_t since_ns, TelemetrySample* out, size_t maxCount) const {
+    if (maxCount == 0) return 0;
+
+    // Retry if the writer laps us, which only happens when the reader is preempted for a long time
+    for (int attempt = 0; attempt < 3; ++attempt) {
+        uint64_t count = published.load(std::memory_order_acquire);
+        uint64_t first = count > CAPACITY - 1 ? count - (CAPACITY - 1) : 0;
+
+        uint64_t start = lowerBound(first, count, since_ns);
+        // Keep the most recent samples when more than maxCount match
+        if (count - start > maxCount) start = count - maxCount;
+
+        for (uint64_t index = start; index < count; ++index) {
+            load(index, out[index - start]);
+        }
+        if (stillValid(start)) return static_cast<size_t>(count - start);
+    }
+    return 0;
+}
+
+bool TelemetryHistory::interpolate(int64_t time_ns, TelemetrySample& out) const {
+    uint64_t count = published.load(std::memory_order_acquire);
+    if (count == 0) return false;
+    uint64_t first = count > CAPACITY - 1 ? count - (CAPACITY - 1) : 0;
+
+    uint64_t after = lowerBound(first, count, time_ns);
+    if (after == count) return false; // Newer than the latest sample
+
+    TelemetrySample next;
+    load(after, next);
+    if (next.time_ns == time_ns) {
+        out = next;
+        return stillValid(after);
+    }
+    if (after == first) return false; // Older than the history
+
+    TelemetrySample previous;
+    load(after - 1, previous);
+    if (!stillValid(after - 1)) return false;
+
+    double ratio = static_cast<double>(time_ns - previous.time_ns) /
+                   static_cast<double>(next.time_ns - previous.time_ns);
+    auto lerp = [ratio](double a, double b) { return a + (b - a) * ratio; };
+
+    out.time_ns = time_ns;
+    out.deviceTime_us = previous.deviceTime_us +
+                        static_cast<uint32_t>(std::llround((next.deviceTime_us - previous.deviceTime_us) * ratio));
+    out.leftTicks = static_cast<int32_t>(std::llround(lerp(previous.leftTicks, next.leftTicks)));
+    out.rightTicks = static_cast<int32_t>(std::llround(lerp(previous.rightTicks, next.rightTicks)));
+    for (int axis = 0; axis < 3; ++axis) {
+        out.gyro[axis] = static_cast<int16_t>(std::lround(lerp(previous.gyro[axis], next.gyro[axis])));
+        out.accel[axis] = static_cast<int16_t>(std::lround(lerp(previous.accel[axis], next.accel[axis])));
+    }
+    return true;
+}
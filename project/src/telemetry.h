@@ -0,0 +1,95 @@
+//
+// High-rate odometry/IMU telemetry streamed by the STM32.
+//
+// Telemetry frame payload (little endian, TELEMETRY_PAYLOAD_SIZE bytes):
+//   [deviceTime_us:u32][leftTicks:i32][rightTicks:i32][gyro x,y,z:i16][accel x,y,z:i16]
+// The frame seq is a free-running counter used to detect lost samples.
+//
+
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "protocol.h"
+
+constexpr size_t TELEMETRY_PAYLOAD_SIZE = 24;
+
+// One odometry + IMU sample. Encoder ticks are cumulative, IMU values are raw sensor LSB.
+struct TelemetrySample {
+    int64_t time_ns = 0;        // Pi monotonic time of the sample
+    uint32_t deviceTime_us = 0; // STM32 timestamp
+    int32_t leftTicks = 0;
+    int32_t rightTicks = 0;
+    int16_t gyro[3] = {};
+    int16_t accel[3] = {};
+};
+
+// Decode a Telemetry frame. Returns false if the frame is not a valid telemetry sample.
+bool decodeTelemetry(const Frame& frame, int64_t time_ns, TelemetrySample& out);
+
+// Encode a sample into a Telemetry frame (used by the simulator and tests)
+void makeTelemetryFrame(Frame& frame, uint8_t seq, const TelemetrySample& sample);
+
+/**
+ * @brief Fixed-capacity telemetry history stored as a struct of arrays.
+ *
+ * A single writer (the serial receive thread) appends samples, any number of readers can query
+ * concurrently without locks. The writer claims a slot before filling it (seqlock style); readers
+ * copy the samples they need and check afterwards that no claim reached them. A reader that was
+ * lapped gives up and counts an overrun. The columns are relaxed atomics: a reader racing the
+ * writer reads stale or new values, never a torn one, and discards them.
+ * Sample times must be non-decreasing, queries use binary search on the time column.
+ */
+class TelemetryHistory {
+public:
+    static constexpr size_t CAPACITY = 4096; // About 20 s at 200 Hz
+
+    // --- Writer side ---
+    // Append a decoded sample
+    void append(const TelemetrySample& sample);
+    // Decode and append a Telemetry frame, updating the loss and decode error counters
+    bool appendFrame(const Frame& frame, int64_t time_ns);
+    // New session: the frame seq starts over, the next frame is not compared with the last one
+    void restartSequence() { haveSeq = false; }
+
+    // --- Reader side ---
+    // Most recent sample, false if there is none
+    bool latest(TelemetrySample& out) const;
+    // Samples with time_ns >= since_ns, oldest first. Returns the number of samples written to out.
+    size_t samplesSince(int64_t since_ns, TelemetrySample* out, size_t maxCount) const;
+    // Linear interpolation at time_ns, false if time_ns is outside the stored history
+    bool interpolate(int64_t time_ns, TelemetrySample& out) const;
+
+    uint64_t size() const;
+    uint64_t totalSamples() const { return published.load(std::memory_order_acquire); }
+    uint64_t missedSamples() const { return missed.load(std::memory_order_relaxed); }  // Gaps in the frame seq
+    uint64_t decodeErrors() const { return malformed.load(std::memory_order_relaxed); } // Bad payload size
+    uint64_t readerOverruns() const { return overruns.load(std::memory_order_relaxed); } // Readers lapped by the writer
+
+private:
+    void load(uint64_t index, TelemetrySample& out) const;
+    // True if the slot of index has not been overwritten since the caller started reading it
+    bool stillValid(uint64_t index) const;
+    // Index of the first sample with time >= time_ns in [first, last), last if none
+    uint64_t lowerBound(uint64_t first, uint64_t last, int64_t time_ns) const;
+
+    // Read and written with relaxed order, published and claimed give the ordering
+    alignas(64) std::atomic<int64_t> time[CAPACITY];
+    std::atomic<uint32_t> deviceTime[CAPACITY];
+    std::atomic<int32_t> left[CAPACITY];
+    std::atomic<int32_t> right[CAPACITY];
+    std::atomic<int16_t> gyro[3][CAPACITY];
+    std::atomic<int16_t> accel[3][CAPACITY];
+
+    alignas(64) std::atomic<uint64_t> published{0}; // Number of samples written so far
+    std::atomic<uint64_t> claimed{0};               // Number of slots the writer has started to write
+    bool haveSeq = false;
+    uint8_t lastSeq = 0;
+    std::atomic<uint64_t> missed{0};
+    std::atomic<uint64_t> malformed{0};
+    mutable std::atomic<uint64_t> overruns{0};
+};
+
+#endif //TELEMETRY_H
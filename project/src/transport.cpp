@@ -0,0 +1,117 @@
+#include "transport.h"
+
+ReliableSender::ReliableSender(const TransportConfig& config)
+    : windowSize(std::clamp<size_t>(config.windowSize, 1, MAX_WINDOW)),
+      minTimeout(config.minRetransmitTimeout),
+      maxTimeout(std::max<std::chrono::microseconds>(config.maxRetransmitTimeout, config.minRetransmitTimeout)),
+      maxRetries(config.maxRetries),
+      retransmitTimeout(std::clamp<std::chrono::microseconds>(4 * minTimeout, minTimeout, maxTimeout)) {
+}
+
+const Frame& ReliableSender::send(const Frame& frame, TransportClock::time_point now) {
+    Slot& slot = slots[nextSeq % (MAX_WINDOW + 1)];
+    slot.frame = frame;
+    slot.frame.seq = nextSeq;
+    slot.sentAt = now;
+    slot.retransmitted = false;
+
+    // The timer always tracks the oldest frame in flight
+    if (inFlightCount == 0) {
+        timerStart = now;
+    }
+    ++nextSeq;
+    ++inFlightCount;
+    return slot.frame;
+}
+
+size_t ReliableSender::onAck(uint8_t ackSeq, TransportClock::time_point now) {
+    // Number of frames acknowledged minus one, modulo the sequence space
+    uint8_t distance = static_cast<uint8_t>(ackSeq - baseSeq);
+    if (inFlightCount == 0 || distance >= inFlightCount) {
+        ++duplicateAckTotal;
+        return 0;
+    }
+
+    const Slot& newest = slots[ackSeq % (MAX_WINDOW + 1)];
+    if (!newest.retransmitted) {
+        updateRtt(std::chrono::duration_cast<std::chrono::microseconds>(now - newest.sentAt));
+    }
+
+    size_t count = static_cast<size_t>(distance) + 1;
+    baseSeq = static_cast<uint8_t>(baseSeq + count);
+    inFlightCount -= count;
+    ackedTotal += count;
+
+    // Progress: restart the timer for the remaining frames and drop the backoff
+    retries = 0;
+    timerStart = now;
+    if (haveRtt) {
+        retransmitTimeout = std::clamp<std::chrono::microseconds>(srtt + 4 * rttVar, minTimeout, maxTimeout);
+    }
+    return count;
+}
+
+size_t ReliableSender::resync(uint8_t expectedSeq, TransportClock::time_point now) {
+    retries = 0;
+    timerStart = now;
+    uint8_t delivered = static_cast<uint8_t>(expectedSeq - baseSeq);
+    if (delivered == 0 || delivered > inFlightCount) return 0; // Nothing delivered (or not a seq in flight)
+
+    baseSeq = expectedSeq;
+    inFlightCount -= delivered;
+    ackedTotal += delivered;
+    return delivered;
+}
+
+void ReliableSender::updateRtt(std::chrono::microseconds sample) {
+    // Jacobson/Karels estimator, as used by TCP
+    if (!haveRtt) {
+        srtt = sample;
+        rttVar = sample / 2;
+        haveRtt = true;
+        return;
+    }
+    std::chrono::microseconds error = sample > srtt ? sample - srtt : srtt - sample;
+    rttVar = (3 * rttVar + error) / 4;
+    srtt = (7 * srtt + sample) / 8;
+}
+
+void ReliableSender::reset(uint8_t seq) {
+    baseSeq = seq;
+    nextSeq = seq;
+    inFlightCount = 0;
+    retries = 0;
+}
+
+bool ReliableReceiver::accept(uint8_t seq, uint8_t& ackSeq) {
+    if (seq == expected) {
+        ackSeq = expected;
+        ++expected;
+        started = true;
+        return true;
+    }
+
+    // Anything within a window behind the expected number is a retransmission of a delivered frame
+    uint8_t behind = static_cast<uint8_t>(expected - 1 - seq);
+    if (behind < ReliableSender::MAX_WINDOW) {
+        ++duplicateTotal;
+    } else {
+        ++outOfOrderTotal; // A frame before it was lost, wait for the go-back-N retransmission
+    }
+    ackSeq = static_cast<uint8_t>(expected - 1);
+    return false;
+}
+
+uint8_t ReliableReceiver::resync(uint8_t oldestSeq, uint8_t nextSeq) {
+    uint8_t offset = static_cast<uint8_t>(expected - oldestSeq);
+    if (!started || offset > static_cast<uint8_t>(nextSeq - oldestSeq)) {
+        expected = oldestSeq;
+    }
+    started = true;
+    return expected;
+}
+
+void ReliableReceiver::reset(uint8_t seq) {
+    expected = seq;
+    started = false;
+}
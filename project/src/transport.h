@@ -0,0 +1,176 @@
+//
+// Reliable, pipelined command transport over the frame protocol.
+//
+// Go-back-N sliding window with cumulative ACKs:
+// - the sender keeps up to windowSize reliable frames in flight, each with an 8-bit sequence number;
+// - the receiver delivers frames strictly in order and answers every reliable frame with an Ack
+//   frame whose seq is the last in-order sequence number it has delivered;
+// - duplicates (retransmissions of frames already delivered) are not delivered again, only re-acked;
+// - when the oldest unacknowledged frame times out, the whole window is retransmitted.
+// The classes hold no I/O, the caller passes the current time and does the writes.
+//
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "protocol.h"
+
+using TransportClock = std::chrono::steady_clock;
+
+struct TransportConfig {
+    uint8_t windowSize = 8; // Maximum number of unacknowledged frames (1..ReliableSender::MAX_WINDOW)
+    std::chrono::milliseconds minRetransmitTimeout{30};
+    std::chrono::milliseconds maxRetransmitTimeout{1000};
+    uint32_t maxRetries = 8; // Consecutive timeouts without progress before the link is declared dead
+};
+
+// Frames that go through the sliding window. Acks and other link-level messages are sent as they are.
+inline bool isReliable(MsgType type) {
+    return type == MsgType::Motion || type == MsgType::Text;
+}
+
+// Session resynchronisation (MsgType::Sync). The sender sends it before its first reliable frame and after
+// a reconnection, with the frames it has in flight; the receiver answers with the same seq and the next
+// sequence number it expects (ReliableReceiver::resync), from which the sender knows what to replay.
+constexpr size_t SYNC_REQUEST_SIZE = 2; // [oldest unacknowledged seq][next seq]
+constexpr size_t SYNC_REPLY_SIZE = 1;   // [next expected seq]
+
+class ReliableSender {
+public:
+    // Half of the 8-bit sequence space, so old and new frames can always be told apart
+    static constexpr size_t MAX_WINDOW = 127;
+
+    explicit ReliableSender(const TransportConfig& config = {});
+
+    // True if another frame can be sent without exceeding the window
+    bool canSend() const { return inFlightCount < windowSize; }
+    size_t inFlight() const { return inFlightCount; }
+    // Maximum number of frames in flight
+    size_t window() const { return windowSize; }
+    // Sequence number of the oldest frame in flight (the next one to be acknowledged)
+    uint8_t oldestSeq() const { return baseSeq; }
+
+    // Assign the next sequence number to a copy of frame and keep it for retransmission.
+    // Returns the stored frame, which must be written to the link.
+    const Frame& send(const Frame& frame, TransportClock::time_point now);
+
+    // Process a cumulative ACK. Returns the number of frames newly acknowledged (0 for duplicate or stale ACKs).
+    size_t onAck(uint8_t ackSeq, TransportClock::time_point now);
+
+    // If the retransmission timer expired, call emit(const Frame&) for every frame in flight, oldest first.
+    // Returns the number of frames passed to emit.
+    template <typename Emit>
+    size_t retransmitExpired(TransportClock::time_point now, Emit&& emit);
+
+    // Call emit(const Frame&) for every frame in flight, oldest first, whatever the timer (replay after a resync).
+    // Returns the number of frames passed to emit.
+    template <typename Emit>
+    size_t replay(TransportClock::time_point now, Emit&& emit);
+
+    // Answer of the receiver to a Sync: the frames before expectedSeq were delivered, their ACKs were lost
+    // with the link. They are acknowledged (without RTT sample) and their number is returned; the frames
+    // still in flight must be replayed. Also restarts the timeout count.
+    size_t resync(uint8_t expectedSeq, TransportClock::time_point now);
+
+    // Time at which the oldest frame in flight must be retransmitted (only meaningful when inFlight() > 0)
+    TransportClock::time_point deadline() const { return timerStart + retransmitTimeout; }
+
+    // Too many consecutive timeouts, the peer is not answering
+    bool failed() const { return retries > maxRetries; }
+
+    // Forget all frames in flight and restart the sequence numbers from seq
+    void reset(uint8_t seq = 0);
+
+    uint64_t acknowledged() const { return ackedTotal; }
+    uint64_t retransmissions() const { return retransmittedTotal; }
+    uint64_t duplicateAcks() const { return duplicateAckTotal; }
+    std::chrono::microseconds smoothedRtt() const { return srtt; }
+
+private:
+    struct Slot {
+        Frame frame;
+        TransportClock::time_point sentAt;
+        bool retransmitted = false; // Karn's rule: no RTT sample from retransmitted frames
+    };
+
+    void updateRtt(std::chrono::microseconds sample);
+
+    Slot slots[MAX_WINDOW + 1];
+    size_t windowSize;
+    std::chrono::microseconds minTimeout;
+    std::chrono::microseconds maxTimeout;
+    uint32_t maxRetries;
+
+    uint8_t baseSeq = 0; // Oldest unacknowledged sequence number
+    uint8_t nextSeq = 0; // Sequence number of the next new frame
+    size_t inFlightCount = 0;
+
+    TransportClock::time_point timerStart;
+    std::chrono::microseconds retransmitTimeout;
+    std::chrono::microseconds srtt{0};
+    std::chrono::microseconds rttVar{0};
+    bool haveRtt = false;
+    uint32_t retries = 0;
+
+    uint64_t ackedTotal = 0;
+    uint64_t retransmittedTotal = 0;
+    uint64_t duplicateAckTotal = 0;
+};
+
+/**
+ * @brief Receiving side of the transport, as implemented by the STM32 firmware (and the simulator).
+ */
+class ReliableReceiver {
+public:
+    // Handle a reliable frame. Returns true if it is the next in-order frame and must be delivered.
+    // ackSeq is set to the cumulative ACK to send back in every case.
+    bool accept(uint8_t seq, uint8_t& ackSeq);
+
+    // Handle a Sync from a sender with frames oldestSeq..nextSeq-1 in flight. The expected sequence number is
+    // kept if it is one of them or nextSeq (the frames before it were delivered), otherwise (this side or the
+    // sender restarted) the receiver expects oldestSeq. Returns the expected sequence number for the reply.
+    uint8_t resync(uint8_t oldestSeq, uint8_t nextSeq);
+
+    // Restart expecting seq
+    void reset(uint8_t seq = 0);
+
+    uint64_t duplicates() const { return duplicateTotal; }
+    uint64_t outOfOrder() const { return outOfOrderTotal; }
+
+private:
+    uint8_t expected = 0;
+    bool started = false; // A frame was delivered or a Sync handled since the reset
+    uint64_t duplicateTotal = 0;
+    uint64_t outOfOrderTotal = 0;
+};
+
+template <typename Emit>
+size_t ReliableSender::replay(TransportClock::time_point now, Emit&& emit) {
+    for (size_t i = 0; i < inFlightCount; ++i) {
+        Slot& slot = slots[static_cast<uint8_t>(baseSeq + i) % (MAX_WINDOW + 1)];
+        slot.retransmitted = true;
+        slot.sentAt = now;
+        emit(static_cast<const Frame&>(slot.frame));
+    }
+    timerStart = now;
+    return inFlightCount;
+}
+
+template <typename Emit>
+size_t ReliableSender::retransmitExpired(TransportClock::time_point now, Emit&& emit) {
+    if (inFlightCount == 0 || now < deadline()) return 0;
+
+    // Go-back-N: resend the whole window in order
+    size_t count = replay(now, emit);
+    retransmittedTotal += count;
+    ++retries;
+    // Exponential backoff until an ACK makes progress
+    retransmitTimeout = std::min(retransmitTimeout * 2, maxTimeout);
+    return count;
+}
+
+#endif //TRANSPORT_H
@@ -0,0 +1,138 @@
+#include "turn_penalty_search.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "grid_map.h"
+#include "indexed_heap.h"
+
+namespace {
+
+// Headings in command order, as in path_planner.cpp: Right, Forward (+y), Left, Backward (-y)
+constexpr int dx[] = {1, 0, -1, 0};
+constexpr int dy[] = {0, 1, 0, -1};
+constexpr uint8_t NO_PARENT = 4;
+
+inline uint64_t openKey(int f, int g) {
+    return (static_cast<uint64_t>(f) << 32) | (UINT32_MAX - static_cast<uint32_t>(g));
+}
+
+// Fewest direction changes left to reach a goal at (dx, dy) cells with the given heading: one per
+// direction still needed, less the current one. Consistent with the move costs.
+int turnsLeft(int heading, int toX, int toY) {
+    int needed = (toX != 0) + (toY != 0);
+    bool aligned = (toX != 0 && dy[heading] == 0 && (toX > 0) == (dx[heading] > 0)) ||
+                   (toY != 0 && dx[heading] == 0 && (toY > 0) == (dy[heading] > 0));
+    return aligned ? needed - 1 : needed;
+}
+
+} // namespace
+
+std::vector<Point> TurnPenaltyPlanner::findPath(const GridMap& map, Point start, Point goal, int turnCost) {
+    std::vector<Point> path;
+    if (map.empty() || !map.contains(start) || !map.contains(goal) || !map.isFree(start) || !map.isFree(goal)) {
+        return path;
+    }
+    // Bounded so that path costs fit the 32-bit key halves
+    turnCost = std::clamp(turnCost, 0, MAX_TURN_COST);
+
+    size_t states = map.dataSize() * 4;
+    if (stateStamp.size() < states || searchStamp >= UINT32_MAX - 2) {
+        stateStamp.assign(std::max(states, stateStamp.size()), 0);
+        stateCost.resize(stateStamp.size());
+        stateParent.resize(stateStamp.size());
+        searchStamp = 0;
+    }
+    if (open.capacity() < states) {
+        open.reset(states);
+    } else {
+        open.clear();
+    }
+    uint32_t seen = searchStamp += 2;
+    uint32_t closed = seen + 1;
+    uint32_t* stamp = stateStamp.data();
+    int* gScore = stateCost.data();
+    uint8_t* parentHeading = stateParent.data();
+    const uint8_t* cells = map.data();
+    int stride = map.stride();
+    const int offset[] = {1, stride, -1, -stride};
+
+    auto heuristic = [&](int x, int y, int heading) {
+        int toX = goal.x - x;
+        int toY = goal.y - y;
+        return std::abs(toX) + std::abs(toY) + turnCost * turnsLeft(heading, toX, toY);
+    };
+    // The vehicle may leave the start in any heading without turning
+    uint32_t startCell = map.index(start.x, start.y);
+    uint32_t goalCell = map.index(goal.x, goal.y);
+    for (int heading = 0; heading < 4; ++heading) {
+        uint32_t state = startCell * 4 + heading;
+        stamp[state] = seen;
+        gScore[state] = 0;
+        parentHeading[state] = NO_PARENT;
+        open.push(state, openKey(heuristic(start.x, start.y, heading), 0));
+    }
+
+    uint32_t goalState = UINT32_MAX;
+    while (!open.empty()) {
+        uint32_t current = open.pop();
+        uint32_t cell = current / 4;
+        int heading = static_cast<int>(current % 4);
+        if (cell == goalCell) {
+            goalState = current;
+            break;
+        }
+        stamp[current] = closed;
+        auto [x, y] = map.pointAt(cell);
+        for (int i = 0; i < 4; ++i) {
+            // Turning back only returns to the cell just left
+            if (i == (heading + 2) % 4) continue;
+            uint32_t nextCell = cell + offset[i];
+            if (cells[nextCell] != GridMap::FREE) continue;
+            uint32_t next = nextCell * 4 + i;
+            int g = gScore[current] + 1 + (i == heading ? 0 : turnCost);
+            if (stamp[next] == seen) {
+                if (g >= gScore[next]) continue;
+            } else if (stamp[next] == closed) {
+                continue; // Consistent heuristic: expanded states are final
+            }
+            stamp[next] = seen;
+            gScore[next] = g;
+            parentHeading[next] = heading;
+            open.push(next, openKey(g + heuristic(x + dx[i], y + dy[i], i), g));
+        }
+    }
+    if (goalState == UINT32_MAX) return path;
+
+    // Walk back: the heading of a state is the move that entered its cell
+    Point cell = goal;
+    uint32_t state = goalState;
+    path.push_back(cell);
+    while (parentHeading[state] != NO_PARENT) {
+        int heading = static_cast<int>(state % 4);
+        cell = {cell.x - dx[heading], cell.y - dy[heading]};
+        path.push_back(cell);
+        state = map.index(cell.x, cell.y) * 4 + parentHeading[state];
+    }
+    std::reverse(path.begin(), path.end());
+    return path;
+}
+
+void TurnPenaltyPlanner::release() {
+    stateStamp = {};
+    stateCost = {};
+    stateParent = {};
+    open = IndexedHeap<uint64_t>();
+    searchStamp = 0;
+}
+
+size_t TurnPenaltyPlanner::bufferBytes() const {
+    return stateStamp.capacity() * (sizeof(uint32_t) + sizeof(int) + sizeof(uint8_t)) + open.capacity() * sizeof(uint32_t);
+}
+
+std::vector<Point> findTurnPenaltyPath(const GridMap& map, Point start, Point goal, int turnCost) {
+    thread_local TurnPenaltyPlanner planner;
+    std::vector<Point> path = planner.findPath(map, start, goal, turnCost);
+    if (map.dataSize() > PLANNER_RETAINED_CELLS) planner.release();
+    return path;
+}
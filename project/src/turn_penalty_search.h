@@ -0,0 +1,50 @@
+//
+// Shortest-time search for the serial command protocol: every change of direction starts a new
+// R/F/L/B command, and on the vehicle a turn (stop, new command, start again) costs far more than
+// one more cell of straight travel.
+//
+// The search state is a cell and the heading the vehicle reached it with. A move keeping the
+// heading costs one cell; a move changing it costs one cell plus turnCost. A* over these states
+// returns the path of least total cost, so among paths of equal length the one with the fewest
+// commands, and a longer path when it saves turns worth more than the extra cells. The first move
+// from the start is free to pick its heading.
+//
+
+#ifndef TURN_PENALTY_SEARCH_H
+#define TURN_PENALTY_SEARCH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "grid_map.h"
+#include "indexed_heap.h"
+#include "path_planner.h"
+
+class TurnPenaltyPlanner {
+public:
+    // Path from start to goal of least cells + turnCost * turns, start and goal included.
+    // turnCost is clamped to [0, MAX_TURN_COST]. Empty if either point is not on the path or the
+    // goal is unreachable.
+    std::vector<Point> findPath(const GridMap& map, Point start, Point goal, int turnCost = DEFAULT_TURN_COST);
+
+    // The search buffers hold four states per map cell (about 52 bytes per cell) and are kept
+    // between searches; release() frees them
+    void release();
+    size_t bufferBytes() const;
+
+private:
+    // States are cell * 4 + heading. A search marks the states it reached with its own stamp
+    // instead of clearing the buffers.
+    std::vector<uint32_t> stateStamp; // searchStamp: reached, searchStamp + 1: expanded
+    uint32_t searchStamp = 0;
+    std::vector<int> stateCost;
+    std::vector<uint8_t> stateParent; // Heading of the state it was reached from
+    IndexedHeap<uint64_t> open;
+};
+
+// Same search for one-off queries. The buffers are kept by the thread for maps up to
+// PLANNER_RETAINED_CELLS and released after larger ones: planning repeatedly on a large map
+// should use its own TurnPenaltyPlanner.
+std::vector<Point> findTurnPenaltyPath(const GridMap& map, Point start, Point goal, int turnCost = DEFAULT_TURN_COST);
+
+#endif //TURN_PENALTY_SEARCH_H
@@ -17,6 +17,29 @@ This is a licence-free software, it can be used by anyone who try to build a bet
 
 #include "serialib.h"
 
+#if defined (__linux__)
+// glibc's termios can't express a baud rate without a B* constant, the kernel's termios2 can
+// (c_ispeed/c_ospeed with BOTHER). Declared here because <asm/termbits.h> conflicts with <termios.h>.
+struct serialib_termios2
+{
+    tcflag_t c_iflag;
+    tcflag_t c_oflag;
+    tcflag_t c_cflag;
+    tcflag_t c_lflag;
+    cc_t     c_line;
+    cc_t     c_cc[19];
+    speed_t  c_ispeed;
+    speed_t  c_ospeed;
+};
+#define SERIALIB_TCGETS2 _IOR('T', 0x2A, struct serialib_termios2)
+#define SERIALIB_TCSETS2 _IOW('T', 0x2B, struct serialib_termios2)
+#ifndef BOTHER
+#define BOTHER 0010000
+#endif
+#ifndef IBSHIFT
+#define IBSHIFT 16
+#endif
+#endif
 
 
 //_____________________________________
@@ -36,7 +59,12 @@ serialib::serialib()
 #endif
 #if defined (__linux__) || defined(__APPLE__)
     fd = -1;
+    rxHead = 0;
+    rxTail = 0;
 #endif
+    lowLatency = false;
+    lowLatencyApplied = 0;
+    flowControl = SERIAL_FLOW_NONE;
 }
 
 serialib::serialib(serialib&& other) noexcept {
@@ -47,9 +75,17 @@ serialib::serialib(serialib&& other) noexcept {
 #if defined (__linux__) || defined(__APPLE__)
     fd = other.fd;
     other.fd = -1;
+    // Keep the bytes already received but not read yet
+    rxHead = 0;
+    rxTail = other.rxTail - other.rxHead;
+    memcpy(rxBuffer, other.rxBuffer + other.rxHead, rxTail);
+    other.rxHead = other.rxTail = 0;
 #endif
     currentStateRTS = other.currentStateRTS;
     currentStateDTR = other.currentStateDTR;
+    lowLatency = other.lowLatency;
+    lowLatencyApplied = other.lowLatencyApplied;
+    flowControl = other.flowControl;
 }
 
 serialib& serialib::operator=(serialib&& other) noexcept {
@@ -61,9 +97,16 @@ serialib& serialib::operator=(serialib&& other) noexcept {
 #if defined (__linux__) || defined(__APPLE__)
         fd = other.fd;
         other.fd = -1;
+        rxHead = 0;
+        rxTail = other.rxTail - other.rxHead;
+        memcpy(rxBuffer, other.rxBuffer + other.rxHead, rxTail);
+        other.rxHead = other.rxTail = 0;
 #endif
         currentStateRTS = other.currentStateRTS;
         currentStateDTR = other.currentStateDTR;
+        lowLatency = other.lowLatency;
+        lowLatencyApplied = other.lowLatencyApplied;
+        flowControl = other.flowControl;
     }
     return *this;
 }
@@ -119,6 +162,8 @@ serialib::~serialib()
                         - 38400
                         - 57600
                         - 115200
+
+               \n In low latency mode (see setLowLatency) any baud rate supported by the UART, e.g. 921600
      \param Databits : Number of data bits in one UART transmission.
 
             \n Supported values: \n
@@ -177,6 +222,8 @@ char serialib::openDevice(const char *Device, const unsigned int Bauds,
 
     // Get the port parameters
     if (!GetCommState(hSerial, &dcbSerialParams)) return -3;
+    lowLatencyApplied=0;
+    flowControl=SERIAL_FLOW_NONE;
 
     // Set the speed (Bauds)
     switch (Bauds)
@@ -196,7 +243,11 @@ char serialib::openDevice(const char *Device, const unsigned int Bauds,
     case 115200 :   dcbSerialParams.BaudRate=CBR_115200; break;
     case 128000 :   dcbSerialParams.BaudRate=CBR_128000; break;
     case 256000 :   dcbSerialParams.BaudRate=CBR_256000; break;
-    default : return -4;
+    default :
+        // The DCB takes any rate, the driver decides if the UART supports it
+        if (!lowLatency) return -4;
+        dcbSerialParams.BaudRate=Bauds;
+        lowLatencyApplied=SERIAL_LOW_LATENCY_CUSTOM_BAUD;
     }
     //select data size
     BYTE bytesize = 0;
@@ -270,6 +321,8 @@ char serialib::openDevice(const char *Device, const unsigned int Bauds,
 
     // Prepare speed (Bauds)
     speed_t         Speed;
+    // Baud rate without B* constant, set exactly after the other options (low latency mode only)
+    bool            customBaud=false;
     switch (Bauds)
     {
         case 110  :     Speed=B110; break;
@@ -283,7 +336,14 @@ char serialib::openDevice(const char *Device, const unsigned int Bauds,
         case 38400 :    Speed=B38400; break;
         case 57600 :    Speed=B57600; break;
         case 115200 :   Speed=B115200; break;
-        default : return -4;
+        default :
+            if (!lowLatency)
+            {
+                closeDevice();
+                return -4;
+            }
+            Speed=B38400;
+            customBaud=true;
     }
     int databits_flag = 0;
     switch(Databits) {
@@ -323,12 +383,145 @@ char serialib::openDevice(const char *Device, const unsigned int Bauds,
     options.c_cc[VMIN]=0;
     // Activate the settings
     tcsetattr(fd, TCSANOW, &options);
+
+    lowLatencyApplied=0;
+    flowControl=SERIAL_FLOW_NONE;
+    if (lowLatency)
+    {
+        char result=applyLowLatency(Device,Bauds,customBaud);
+        // Do not leave the device open at a speed the caller did not ask for
+        if (result!=1) closeDevice();
+        return result;
+    }
     // Success
     return (1);
 #endif
 
 }
 
+
+/*!
+     \brief Enable or disable the low latency mode, applied by the next call to openDevice.
+            In this mode openDevice accepts any baud rate (e.g. 921600 for an STM32 USART) and asks
+            the driver to push every received byte to the application immediately (ASYNC_LOW_LATENCY,
+            1 ms latency timer on FTDI style USB adapters). These driver settings are best effort,
+            lowLatencyFeatures() tells which ones were accepted.
+     \param enable : true to enable the low latency mode
+  */
+void serialib::setLowLatency(bool enable)
+{
+    lowLatency=enable;
+}
+
+
+/*!
+     \brief Low latency features applied by the last openDevice
+     \return a combination of SERIAL_LOW_LATENCY_CUSTOM_BAUD, SERIAL_LOW_LATENCY_DRIVER_FLAG and SERIAL_LOW_LATENCY_USB_TIMER
+  */
+int serialib::lowLatencyFeatures()
+{
+    return lowLatencyApplied;
+}
+
+
+/*!
+     \brief Select the flow control of the open device. openDevice always starts without flow control.
+            With SERIAL_FLOW_RTSCTS the driver stops transmitting while CTS is deasserted and drives RTS
+            from its receive buffer. SERIAL_FLOW_CTS_GATED leaves the driver alone: writeStream only hands
+            SERIALIB_CTS_CHUNK bytes at a time to the driver, while CTS is asserted.
+            In both modes use writeStream, which returns the bytes accepted instead of failing when the
+            receiver holds the line.
+     \param mode : SERIAL_FLOW_NONE, SERIAL_FLOW_RTSCTS or SERIAL_FLOW_CTS_GATED
+     \return 1 success
+     \return -1 error while getting port parameters
+     \return -2 error while writing port parameters
+     \return -3 mode not supported on this platform
+  */
+char serialib::setFlowControl(SerialFlowControl mode)
+{
+#if defined (_WIN32) || defined( _WIN64)
+    // The serial driver of Windows always handles the handshake
+    if (mode==SERIAL_FLOW_CTS_GATED) return -3;
+    DCB dcbSerialParams;
+    dcbSerialParams.DCBlength=sizeof(dcbSerialParams);
+    if (!GetCommState(hSerial, &dcbSerialParams)) return -1;
+    dcbSerialParams.fOutxCtsFlow=(mode==SERIAL_FLOW_RTSCTS);
+    dcbSerialParams.fRtsControl=(mode==SERIAL_FLOW_RTSCTS) ? RTS_CONTROL_HANDSHAKE : RTS_CONTROL_ENABLE;
+    if (!SetCommState(hSerial, &dcbSerialParams)) return -2;
+#endif
+#if defined (__linux__) || defined(__APPLE__)
+    struct termios options;
+    if (tcgetattr(fd, &options)==-1) return -1;
+    if (mode==SERIAL_FLOW_RTSCTS)
+        options.c_cflag |= CRTSCTS;
+    else
+        options.c_cflag &= ~CRTSCTS;
+    if (tcsetattr(fd, TCSANOW, &options)==-1) return -2;
+#endif
+    flowControl=mode;
+    return 1;
+}
+
+
+#if defined (__linux__) || defined(__APPLE__)
+/*!
+     \brief Apply the low latency settings to the device just opened
+     \param Device : path of the device, used to find the USB adapter in sysfs
+     \param Bauds : requested baud rate
+     \param customBaud : true if Bauds has no B* constant and must be set through termios2
+     \return 1 success
+     \return -4 the driver refused the baud rate
+  */
+char serialib::applyLowLatency(const char *Device, const unsigned int Bauds, bool customBaud)
+{
+#if defined (__linux__)
+    if (customBaud)
+    {
+        // Replace the placeholder speed by the exact rate, for both directions
+        struct serialib_termios2 options2;
+        if (ioctl(fd, SERIALIB_TCGETS2, &options2)==-1) return -4;
+        options2.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+        options2.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+        options2.c_ispeed=Bauds;
+        options2.c_ospeed=Bauds;
+        if (ioctl(fd, SERIALIB_TCSETS2, &options2)==-1) return -4;
+        lowLatencyApplied |= SERIAL_LOW_LATENCY_CUSTOM_BAUD;
+    }
+
+    // Ask the driver to hand over received bytes immediately instead of batching them
+    struct serial_struct serial;
+    if (ioctl(fd, TIOCGSERIAL, &serial)==0)
+    {
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serial)==0) lowLatencyApplied |= SERIAL_LOW_LATENCY_DRIVER_FLAG;
+    }
+
+    // USB adapters (FTDI) only forward a partial packet after their latency timer, 16 ms by default
+    char realPath[PATH_MAX];
+    if (realpath(Device, realPath)!=NULL)
+    {
+        const char *name=strrchr(realPath,'/');
+        char timerPath[PATH_MAX];
+        int length=snprintf(timerPath, sizeof(timerPath), "/sys/class/tty/%s/device/latency_timer", name ? name+1 : realPath);
+        // A name too long for the path has no timer to set
+        int timerFd=length>0 && static_cast<size_t>(length)<sizeof(timerPath) ? open(timerPath, O_WRONLY) : -1;
+        if (timerFd>=0)
+        {
+            if (write(timerFd, "1", 1)==1) lowLatencyApplied |= SERIAL_LOW_LATENCY_USB_TIMER;
+            close(timerFd);
+        }
+    }
+#else
+    UNUSED(Device);
+    UNUSED(Bauds);
+    // No termios2 on macOS
+    if (customBaud) return -4;
+#endif
+    // Reads never wait for a threshold: VMIN=0/VTIME=0 with poll() already wakes on the first byte
+    return 1;
+}
+#endif
+
 bool serialib::isDeviceOpen()
 {
 #if defined (_WIN32) || defined( _WIN64)
@@ -339,6 +532,19 @@ bool serialib::isDeviceOpen()
 #endif
 }
 
+#if defined (__linux__) || defined(__APPLE__)
+/*!
+     \brief File descriptor of the open device, to wait for several devices with poll() or epoll.
+            Bytes already in the internal receive buffer (left by readString/readLine) do not make it
+            readable again, check available() before waiting on it.
+     \return the file descriptor, -1 if no device is open
+  */
+int serialib::getFileDescriptor()
+{
+    return fd;
+}
+#endif
+
 /*!
      \brief Close the connection with the current device
 */
@@ -351,6 +557,8 @@ void serialib::closeDevice()
 #if defined (__linux__) || defined(__APPLE__)
     close (fd);
     fd = -1;
+    // Bytes received from the previous device are meaningless now
+    rxHead = rxTail = 0;
 #endif
 }
 
@@ -456,6 +664,165 @@ int serialib::writeBytes(const void *Buffer, const unsigned int NbBytes)
 
 
 
+/*!
+     \brief Write an array of data, as fast as the flow control (see setFlowControl) and the driver
+            buffer allow. Unlike writeBytes, a receiver holding the line is not an error: the function
+            gives up after the timeout and returns the number of bytes written so far, the caller
+            keeps the rest and decides what to do (back-pressure).
+     \param Buffer : array of bytes to send on the port
+     \param NbBytes : number of byte to send
+     \param timeOut_ms : maximum time spent waiting for the line, 0 only writes what fits right now
+     \return >=0 number of bytes written (less than NbBytes if the timeout was reached)
+     \return -1 error while writting data
+  */
+int serialib::writeStream(const void *Buffer, const unsigned int NbBytes, const unsigned int timeOut_ms)
+{
+#if defined (_WIN32) || defined( _WIN64)
+    // Number of bytes written
+    DWORD dwBytesWritten=0;
+
+    // The driver blocks while CTS is deasserted, bound the wait with the write timeout
+    COMMTIMEOUTS previousTimeouts=timeouts;
+    timeouts.WriteTotalTimeoutMultiplier=0;
+    timeouts.WriteTotalTimeoutConstant=(timeOut_ms==0) ? 1 : (DWORD)timeOut_ms;
+    if(!SetCommTimeouts(hSerial, &timeouts)) return -1;
+    BOOL success=WriteFile(hSerial, Buffer, NbBytes, &dwBytesWritten, NULL);
+    timeouts=previousTimeouts;
+    if(!SetCommTimeouts(hSerial, &timeouts)) return -1;
+    if(!success && GetLastError()!=ERROR_TIMEOUT) return -1;
+    return dwBytesWritten;
+#endif
+#if defined (__linux__) || defined(__APPLE__)
+    const char      *Data=(const char*)Buffer;
+    unsigned int    NbBytesWritten=0;
+    // Timer used for timeout
+    timeOut         timer;
+    timer.initTimer();
+
+    while (NbBytesWritten<NbBytes)
+    {
+        unsigned int Chunk=NbBytes-NbBytesWritten;
+        bool Ready=true;
+        if (flowControl==SERIAL_FLOW_CTS_GATED)
+        {
+            // Only a few bytes at a time in the driver, so they stop soon after CTS is deasserted
+            int Queued=0;
+            ioctl(fd, TIOCOUTQ, &Queued);
+            if (!isCTS() || Queued>=SERIALIB_CTS_CHUNK)
+                Ready=false;
+            else if (Chunk>(unsigned int)(SERIALIB_CTS_CHUNK-Queued))
+                Chunk=SERIALIB_CTS_CHUNK-Queued;
+        }
+        if (Ready)
+        {
+            ssize_t Ret=write(fd,Data+NbBytesWritten,Chunk);
+            if (Ret>0)
+            {
+                NbBytesWritten+=Ret;
+                continue;
+            }
+            if (Ret==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) return -1;
+        }
+
+        // The line is held (driver buffer full or CTS deasserted), wait for room until the timeout
+        long int Remaining=(long int)timeOut_ms-(long int)timer.elapsedTime_ms();
+        if (Remaining<=0) break;
+        if (!Ready)
+        {
+            // CTS changes can't be polled, check again in a millisecond
+            poll(NULL,0,1);
+            continue;
+        }
+        if (waitWritable((int)Remaining)<0) return -1;
+    }
+    return NbBytesWritten;
+#endif
+}
+
+
+
+#if defined (__linux__) || defined(__APPLE__)
+/*!
+     \brief Write several buffers as one stream, like writeStream: the buffers are sent in order as
+            fast as the flow control and the driver allow, with a single writev() system call when the
+            driver has room for everything. Used to send a batch of frames without copying them together.
+     \param Buffers : array of buffers (struct iovec) to send, in order
+     \param NbBuffers : number of buffers
+     \param timeOut_ms : maximum time spent waiting for the line, 0 only writes what fits right now
+     \return >=0 total number of bytes written (less than the sum of the buffer sizes if the timeout was reached)
+     \return -1 error while writting data
+  */
+int serialib::writeVector(const struct iovec *Buffers, const int NbBuffers, const unsigned int timeOut_ms)
+{
+    // CTS gating needs to split the data in small chunks anyway
+    if (flowControl==SERIAL_FLOW_CTS_GATED)
+    {
+        int NbBytesWritten=0;
+        timeOut timer;
+        timer.initTimer();
+        for (int i=0; i<NbBuffers; i++)
+        {
+            long int Remaining=(long int)timeOut_ms-(long int)timer.elapsedTime_ms();
+            int Ret=writeStream(Buffers[i].iov_base, (unsigned int)Buffers[i].iov_len, Remaining>0 ? (unsigned int)Remaining : 0);
+            if (Ret<0) return -1;
+            NbBytesWritten+=Ret;
+            if ((size_t)Ret<Buffers[i].iov_len) break;
+        }
+        return NbBytesWritten;
+    }
+
+    // Position in the buffers: index of the first buffer not completely written and offset in it
+    int             Index=0;
+    size_t          Offset=0;
+    int             NbBytesWritten=0;
+    // Timer used for timeout
+    timeOut         timer;
+    timer.initTimer();
+
+    while (true)
+    {
+        // Empty buffers can't be told apart from a full driver by writev()
+        while (Index<NbBuffers && Buffers[Index].iov_len==Offset)
+        {
+            Index++;
+            Offset=0;
+        }
+        if (Index==NbBuffers) break;
+
+        // Copy of the remaining buffers, the first one starting after the part already written
+        struct iovec Batch[64];
+        int NbBatch=0;
+        for (int i=Index; i<NbBuffers && NbBatch<64; i++, NbBatch++) Batch[NbBatch]=Buffers[i];
+        Batch[0].iov_base=(char*)Batch[0].iov_base+Offset;
+        Batch[0].iov_len-=Offset;
+
+        ssize_t Ret=writev(fd,Batch,NbBatch);
+        if (Ret>0)
+        {
+            NbBytesWritten+=Ret;
+            // Skip the buffers written completely
+            size_t Left=(size_t)Ret+Offset;
+            while (Index<NbBuffers && Left>=Buffers[Index].iov_len)
+            {
+                Left-=Buffers[Index].iov_len;
+                Index++;
+            }
+            Offset=Left;
+            continue;
+        }
+        if (Ret==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) return -1;
+
+        // The line is held, wait for room until the timeout
+        long int Remaining=(long int)timeOut_ms-(long int)timer.elapsedTime_ms();
+        if (Remaining<=0) break;
+        if (waitWritable((int)Remaining)<0) return -1;
+    }
+    return NbBytesWritten;
+}
+#endif
+
+
+
 /*!
      \brief Wait for a byte from the serial device and return the data read
      \param pByte : data read on the serial device
@@ -492,16 +859,24 @@ int serialib::readChar(char *pByte,unsigned int timeOut_ms)
     timeOut         timer;
     // Initialise the timer
     timer.initTimer();
-    // While Timeout is not reached
-    while (timer.elapsedTime_ms()<timeOut_ms || timeOut_ms==0)
+    while (true)
     {
-        // Try to read a byte on the device
-        switch (read(fd,pByte,1)) {
-            case 1  : return 1; // Read successfull
-            case -1 : return -2; // Error while reading
+        // Take the byte from the receive buffer when available
+        if (takeBuffered(pByte,1)==1) return 1;
+
+        // Compute the remaining time, -1 means wait forever
+        int remaining=-1;
+        if (timeOut_ms>0)
+        {
+            unsigned long int elapsed=timer.elapsedTime_ms();
+            if (elapsed>=timeOut_ms) return 0;
+            remaining=(int)(timeOut_ms-elapsed);
         }
+        // Refill the buffer with everything the kernel has, sleeping in poll() if it is empty
+        int Ret=fillBuffer(remaining);
+        if (Ret<0) return -2;
+        if (Ret==0) return 0;
     }
-    return 0;
 #endif
 }
 
@@ -519,6 +894,10 @@ int serialib::readChar(char *pByte,unsigned int timeOut_ms)
   */
 int serialib::readStringNoTimeOut(char *receivedString,char finalChar,unsigned int maxNbBytes)
 {
+#if defined (__linux__) || defined(__APPLE__)
+    // The buffered implementation handles the no timeout case
+    return readString(receivedString,finalChar,maxNbBytes,0);
+#else
     // Number of characters read
     unsigned int    NbBytes=0;
     // Returned value from Read
@@ -551,6 +930,7 @@ int serialib::readStringNoTimeOut(char *receivedString,char finalChar,unsigned i
     }
     // Buffer is full : return -3
     return -3;
+#endif
 }
 
 
@@ -568,6 +948,70 @@ int serialib::readStringNoTimeOut(char *receivedString,char finalChar,unsigned i
   */
 int serialib::readString(char *receivedString,char finalChar,unsigned int maxNbBytes,unsigned int timeOut_ms)
 {
+#if defined (__linux__) || defined(__APPLE__)
+    // Number of bytes read
+    unsigned int    nbBytes=0;
+    // Timer used for timeout
+    timeOut         timer;
+
+    // Initialize the timer (for timeout)
+    timer.initTimer();
+
+    // While the buffer is not full
+    while (nbBytes<maxNbBytes)
+    {
+        unsigned int pending=rxTail-rxHead;
+        if (pending>0)
+        {
+            // Look for the final char in the buffered bytes that still fit in the string
+            unsigned int chunk=(pending<maxNbBytes-nbBytes) ? pending : maxNbBytes-nbBytes;
+            const char *start=rxBuffer+rxHead;
+            const char *found=(const char*)memchr(start,finalChar,chunk);
+            if (found!=NULL) chunk=(unsigned int)(found-start)+1;
+
+            // Move the bytes to the string with a single copy
+            memcpy(receivedString+nbBytes,start,chunk);
+            rxHead+=chunk;
+            nbBytes+=chunk;
+
+            if (found!=NULL)
+            {
+                // Final character: add the end character 0
+                receivedString[nbBytes]=0;
+                // Return the number of bytes read
+                return nbBytes;
+            }
+            continue;
+        }
+
+        // Compute the remaining time, -1 means wait forever
+        int remaining=-1;
+        if (timeOut_ms>0)
+        {
+            unsigned long int elapsed=timer.elapsedTime_ms();
+            if (elapsed>=timeOut_ms)
+            {
+                // Add the end caracter and return 0 (timeout reached)
+                receivedString[nbBytes]=0;
+                return 0;
+            }
+            remaining=(int)(timeOut_ms-elapsed);
+        }
+
+        // Receive the next bytes with one large read
+        int Ret=fillBuffer(remaining);
+        if (Ret<0) return -2;
+        if (Ret==0)
+        {
+            // Add the end caracter and return 0 (timeout reached)
+            receivedString[nbBytes]=0;
+            return 0;
+        }
+    }
+
+    // Buffer is full : return -3
+    return -3;
+#else
     // Check if timeout is requested
     if (timeOut_ms==0) return readStringNoTimeOut(receivedString,finalChar,maxNbBytes);
 
@@ -624,6 +1068,75 @@ int serialib::readString(char *receivedString,char finalChar,unsigned int maxNbB
 
     // Buffer is full : return -3
     return -3;
+#endif
+}
+
+
+/*!
+     \brief Read a line from the serial device without copying it (Linux only)
+            The line is returned in place in the internal receive buffer, it stays valid
+            until the next call of a read function or closeDevice.
+     \param line : set to the first char of the line, which ends with the final char (not null terminated)
+     \param finalChar : final char of the line
+     \param timeOut_ms : delay of timeout before giving up the reading (optional)
+            If set to zero, timeout is disable
+     \return  >0 success, return the length of the line (final char included)
+     \return  0 timeout is reached, the received bytes are kept for the next call
+     \return -2 error while reading the bytes
+     \return -3 the line does not fit in the receive buffer, the buffered bytes are dropped
+  */
+int serialib::readLine(const char **line,char finalChar,unsigned int timeOut_ms)
+{
+#if defined (_WIN32) || defined(_WIN64)
+    UNUSED(line);
+    UNUSED(finalChar);
+    UNUSED(timeOut_ms);
+    // Not supported on Windows, use readString
+    return -2;
+#endif
+#if defined (__linux__) || defined(__APPLE__)
+    // Timer used for timeout
+    timeOut         timer;
+    timer.initTimer();
+    // Bytes already scanned, the next scan starts after them
+    unsigned int    scanned=0;
+
+    while (true)
+    {
+        const char *start=rxBuffer+rxHead;
+        unsigned int pending=rxTail-rxHead;
+        const char *found=(const char*)memchr(start+scanned,finalChar,pending-scanned);
+        if (found!=NULL)
+        {
+            unsigned int length=(unsigned int)(found-start)+1;
+            *line=start;
+            rxHead+=length;
+            return length;
+        }
+        scanned=pending;
+
+        // The whole buffer is used by a single incomplete line
+        if (pending==SERIALIB_RX_BUFFER_SIZE)
+        {
+            rxHead=rxTail=0;
+            return -3;
+        }
+
+        // Compute the remaining time, -1 means wait forever
+        int remaining=-1;
+        if (timeOut_ms>0)
+        {
+            unsigned long int elapsed=timer.elapsedTime_ms();
+            if (elapsed>=timeOut_ms) return 0;
+            remaining=(int)(timeOut_ms-elapsed);
+        }
+
+        // fillBuffer may move the pending bytes to the beginning of the buffer, scanned stays valid
+        int Ret=fillBuffer(remaining);
+        if (Ret<0) return -2;
+        if (Ret==0) return 0;
+    }
+#endif
 }
 
 
@@ -632,9 +1145,9 @@ int serialib::readString(char *receivedString,char finalChar,unsigned int maxNbB
      \param buffer : array of bytes read from the serial device
      \param maxNbBytes : maximum allowed number of bytes read
      \param timeOut_ms : delay of timeout before giving up the reading
-     \param sleepDuration_us : delay of CPU relaxing in microseconds (Linux only)
-            In the reading loop, a sleep can be performed after each reading
-            This allows CPU to perform other tasks
+     \param sleepDuration_us : kept for compatibility, unused
+            On Linux the reading loop waits in poll() until the kernel has data,
+            so the CPU is released without any explicit sleep
      \return >=0 return the number of bytes read before timeout or
                 requested data is completed
      \return -1 error while setting the Timeout
@@ -663,34 +1176,47 @@ int serialib::readBytes (void *buffer,unsigned int maxNbBytes,unsigned int timeO
     return dwBytesRead;
 #endif
 #if defined (__linux__) || defined(__APPLE__)
+    // The reading loop sleeps in poll(), no CPU relaxing delay is needed
+    UNUSED(sleepDuration_us);
+
     // Timer used for timeout
     timeOut          timer;
     // Initialise the timer
     timer.initTimer();
-    unsigned int     NbByteRead=0;
-    // While Timeout is not reached
-    while (timer.elapsedTime_ms()<timeOut_ms || timeOut_ms==0)
+    // Start with the bytes already in the receive buffer
+    unsigned int     NbByteRead=takeBuffered(buffer,maxNbBytes);
+    // While the requested data is not completed
+    while (NbByteRead<maxNbBytes)
     {
         // Compute the position of the current byte
         unsigned char* Ptr=(unsigned char*)buffer+NbByteRead;
-        // Try to read a byte on the device
-        int Ret=read(fd,(void*)Ptr,maxNbBytes-NbByteRead);
-        // Error while reading
-        if (Ret==-1) return -2;
+        // Try to read all the pending bytes on the device
+        ssize_t Ret=read(fd,(void*)Ptr,maxNbBytes-NbByteRead);
 
         // One or several byte(s) has been read on the device
         if (Ret>0)
         {
-            // Increase the number of read bytes
+            // Increase the number of read bytes and drain the device again
             NbByteRead+=Ret;
-            // Success : bytes has been read
-            if (NbByteRead>=maxNbBytes)
-                return NbByteRead;
+            continue;
+        }
+        // Error while reading
+        if (Ret==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) return -2;
+
+        // Compute the remaining time, -1 means wait forever
+        int remaining=-1;
+        if (timeOut_ms>0)
+        {
+            unsigned long int elapsed=timer.elapsedTime_ms();
+            if (elapsed>=timeOut_ms) break;
+            remaining=(int)(timeOut_ms-elapsed);
         }
-        // Suspend the loop to avoid charging the CPU
-        usleep (sleepDuration_us);
+        // Wait for the next bytes from the kernel
+        int Ready=waitReadable(remaining);
+        if (Ready<0) return -2;
+        if (Ready==0) break;
     }
-    // Timeout reached, return the number of bytes read
+    // Timeout reached or request completed, return the number of bytes read
     return NbByteRead;
 #endif
 }
@@ -698,6 +1224,199 @@ int serialib::readBytes (void *buffer,unsigned int maxNbBytes,unsigned int timeO
 
 
 
+/*!
+     \brief Read the bytes already received by the serial device, waiting only for the first one.
+            Unlike readBytes, it returns as soon as some data is available instead of waiting
+            for the buffer to be full, which suits a receiving thread.
+     \param buffer : array of bytes read from the serial device
+     \param maxNbBytes : maximum allowed number of bytes read
+     \param timeOut_ms : delay of timeout before giving up waiting for the first byte
+            If set to zero, timeout is disable (Optional)
+     \return >0 return the number of bytes read
+     \return 0 timeout reached
+     \return -1 error while setting the Timeout
+     \return -2 error while reading the bytes
+  */
+int serialib::readAvailable(void *buffer,unsigned int maxNbBytes,unsigned int timeOut_ms)
+{
+#if defined (_WIN32) || defined(_WIN64)
+    // Number of bytes read
+    DWORD dwBytesRead = 0;
+
+    // Return immediately with the received bytes, or wait up to the timeout for the first one
+    COMMTIMEOUTS previousTimeouts=timeouts;
+    timeouts.ReadIntervalTimeout=MAXDWORD;
+    timeouts.ReadTotalTimeoutMultiplier=MAXDWORD;
+    timeouts.ReadTotalTimeoutConstant=(timeOut_ms==0) ? MAXDWORD-1 : (DWORD)timeOut_ms;
+    if(!SetCommTimeouts(hSerial, &timeouts)) return -1;
+
+    // Read the bytes from the serial device, return -2 if an error occured
+    BOOL success=ReadFile(hSerial,buffer,(DWORD)maxNbBytes,&dwBytesRead, NULL);
+
+    // Restore the timeouts used by the other read functions
+    timeouts=previousTimeouts;
+    if(!SetCommTimeouts(hSerial, &timeouts)) return -1;
+    if(!success) return -2;
+
+    // Return the byte read
+    return dwBytesRead;
+#endif
+#if defined (__linux__) || defined(__APPLE__)
+    // Bytes already in the receive buffer are returned without any system call
+    unsigned int     NbBuffered=takeBuffered(buffer,maxNbBytes);
+    if (NbBuffered>0) return (int)NbBuffered;
+
+    // Timer used for timeout
+    timeOut          timer;
+    // Initialise the timer
+    timer.initTimer();
+    while (true)
+    {
+        // Try to read all the pending bytes on the device
+        ssize_t Ret=read(fd,buffer,maxNbBytes);
+        // Some bytes are available
+        if (Ret>0) return (int)Ret;
+        // Error while reading
+        if (Ret==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) return -2;
+
+        // Compute the remaining time, -1 means wait forever
+        int remaining=-1;
+        if (timeOut_ms>0)
+        {
+            unsigned long int elapsed=timer.elapsedTime_ms();
+            if (elapsed>=timeOut_ms) return 0;
+            remaining=(int)(timeOut_ms-elapsed);
+        }
+        // Wait for the first bytes from the kernel
+        int Ready=waitReadable(remaining);
+        if (Ready<0) return -2;
+        if (Ready==0) return 0;
+    }
+#endif
+}
+
+
+
+
+#if defined (__linux__) || defined(__APPLE__)
+/*!
+     \brief Wait until data can be read from the serial device
+     \param timeOut_ms : maximum waiting delay, -1 waits forever
+     \return 1 data is available
+     \return 0 timeout reached
+     \return -1 error on the device (hang up, invalid descriptor ...)
+  */
+int serialib::waitReadable(int timeOut_ms)
+{
+    struct pollfd pfd;
+    pfd.fd=fd;
+    pfd.events=POLLIN;
+    pfd.revents=0;
+
+    int Ret;
+    do
+    {
+        Ret=poll(&pfd,1,timeOut_ms);
+    } while (Ret==-1 && errno==EINTR);
+
+    if (Ret<0) return -1;
+    if (Ret==0) return 0;
+    // A hang up would make read() return 0 forever, report it as an error
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) return -1;
+    return 1;
+}
+
+
+/*!
+     \brief Wait until the serial device accepts more bytes
+     \param timeOut_ms : delay of timeout, -1 waits forever
+     \return 1 the device is writable
+     \return 0 timeout reached
+     \return -1 error (including a hang up of the device)
+  */
+int serialib::waitWritable(int timeOut_ms)
+{
+    struct pollfd pfd;
+    pfd.fd=fd;
+    pfd.events=POLLOUT;
+    pfd.revents=0;
+
+    int Ret;
+    do
+    {
+        Ret=poll(&pfd,1,timeOut_ms);
+    } while (Ret==-1 && errno==EINTR);
+
+    if (Ret<0) return -1;
+    if (Ret==0) return 0;
+    if (pfd.revents & (POLLERR | POLLHUP | POLLNVAL)) return -1;
+    return 1;
+}
+
+
+/*!
+     \brief Fill the internal receive buffer with the bytes pending on the device
+     \param timeOut_ms : maximum delay to wait for the first byte, -1 waits forever
+     \return >0 number of bytes added to the buffer
+     \return 0 timeout reached (or buffer already full)
+     \return -2 error while reading
+  */
+int serialib::fillBuffer(int timeOut_ms)
+{
+    if (rxHead==rxTail)
+    {
+        // Empty buffer: restart at the beginning
+        rxHead=rxTail=0;
+    }
+    else if (rxTail==SERIALIB_RX_BUFFER_SIZE && rxHead>0)
+    {
+        // No room at the end: move the unread bytes to the beginning
+        memmove(rxBuffer,rxBuffer+rxHead,rxTail-rxHead);
+        rxTail-=rxHead;
+        rxHead=0;
+    }
+    if (rxTail==SERIALIB_RX_BUFFER_SIZE) return 0;
+
+    while (true)
+    {
+        // One read takes everything the kernel has, up to the free space
+        ssize_t Ret=read(fd,rxBuffer+rxTail,SERIALIB_RX_BUFFER_SIZE-rxTail);
+        if (Ret>0)
+        {
+            rxTail+=(unsigned int)Ret;
+            return (int)Ret;
+        }
+        if (Ret==-1 && errno!=EAGAIN && errno!=EWOULDBLOCK && errno!=EINTR) return -2;
+
+        int Ready=waitReadable(timeOut_ms);
+        if (Ready<0) return -2;
+        if (Ready==0) return 0;
+    }
+}
+
+
+/*!
+     \brief Move bytes from the internal receive buffer to the caller
+     \param buffer : destination
+     \param maxNbBytes : maximum number of bytes to copy
+     \return the number of bytes copied
+  */
+unsigned int serialib::takeBuffered(void *buffer,unsigned int maxNbBytes)
+{
+    unsigned int pending=rxTail-rxHead;
+    unsigned int count=(pending<maxNbBytes) ? pending : maxNbBytes;
+    if (count>0)
+    {
+        memcpy(buffer,rxBuffer+rxHead,count);
+        rxHead+=count;
+    }
+    return count;
+}
+#endif
+
+
+
+
 // _________________________
 // ::: Special operation :::
 
@@ -717,6 +1436,7 @@ char serialib::flushReceiver()
 #if defined (__linux__) || defined(__APPLE__)
     // Purge receiver
     tcflush(fd,TCIFLUSH);
+    rxHead=rxTail=0;
     return true;
 #endif
 }
@@ -741,14 +1461,42 @@ int serialib::available()
 #endif
 #if defined (__linux__) || defined(__APPLE__)
     int nBytes=0;
-    // Return number of pending bytes in the receiver
+    // Return number of pending bytes in the receiver, including the bytes already buffered
     ioctl(fd, FIONREAD, &nBytes);
-    return nBytes;
+    return nBytes+(int)(rxTail-rxHead);
 #endif
 
 }
 
 
+/*!
+    \brief  Return the number of bytes still waiting in the transmit buffer of the driver
+            A writer that wants to keep the latency of urgent data low can keep this small
+            instead of handing everything to the driver at once.
+    \return The number of bytes written but not yet sent on the line
+    \return -1 if the driver does not report it
+*/
+int serialib::pendingOutput()
+{
+#if defined (_WIN32) || defined(_WIN64)
+    // Device errors
+    DWORD commErrors;
+    // Device status
+    COMSTAT commStatus;
+    // Read status
+    if (!ClearCommError(hSerial, &commErrors, &commStatus)) return -1;
+    // Return the number of bytes not yet transmitted
+    return commStatus.cbOutQue;
+#endif
+#if defined (__linux__) || defined(__APPLE__)
+    int nBytes=0;
+    // Number of bytes in the output queue of the tty
+    if (ioctl(fd, TIOCOUTQ, &nBytes)!=0) return -1;
+    return nBytes;
+#endif
+}
+
+
 
 // __________________
 // ::: I/O Access :::
@@ -1041,7 +1789,8 @@ timeOut::timeOut()
 
 
 /*!
-    \brief      Initialise the timer. It writes the current time of the day in the structure PreviousTime.
+    \brief      Initialise the timer. It writes the current time in the structure PreviousTime.
+                On Linux and macOS the monotonic clock is used so NTP adjustments do not break timeouts.
 */
 //Initialize the timer
 void timeOut::initTimer()
@@ -1053,6 +1802,8 @@ void timeOut::initTimer()
     // Used to store the previous time (for computing timeout)
     QueryPerformanceCounter(&tmp);
     previousTime = tmp.QuadPart;
+#elif defined (__linux__) || defined(__APPLE__)
+    clock_gettime(CLOCK_MONOTONIC, &previousTime);
 #else
     gettimeofday(&previousTime, NULL);
 #endif
@@ -1080,6 +1831,19 @@ unsigned long int timeOut::elapsedTime_ms()
 
     // Return the elapsed time in milliseconds
     return sec/(counterFrequency/1000);
+#elif defined (__linux__) || defined(__APPLE__)
+    // Current time
+    struct timespec CurrentTime;
+
+    // Get current time
+    clock_gettime(CLOCK_MONOTONIC, &CurrentTime);
+
+    // Compute the elapsed time, the monotonic clock never goes backward
+    long long elapsed_ns=(long long)(CurrentTime.tv_sec-previousTime.tv_sec)*1000000000LL
+                         +(CurrentTime.tv_nsec-previousTime.tv_nsec);
+
+    // Return the elapsed time in milliseconds
+    return (unsigned long int)(elapsed_ns/1000000LL);
 #else
     // Current time
     struct timeval CurrentTime;
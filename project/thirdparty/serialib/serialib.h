@@ -50,11 +50,39 @@ This is a licence-free software, it can be used by anyone who try to build a bet
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+// Scatter-gather writes
+#include <sys/uio.h>
+// Event waiting and monotonic clock
+#include <poll.h>
+#include <errno.h>
+#include <time.h>
+#endif
+#if defined (__linux__)
+// Low latency flag of the serial drivers (ASYNC_LOW_LATENCY) and sysfs paths
+#include <linux/serial.h>
+#include <limits.h>
+#include <stdio.h>
 #endif
 
 /*! To avoid unused parameters */
 #define UNUSED(x) (void)(x)
 
+/*! Size of the internal receive buffer used by the string functions (Linux only) */
+#ifndef SERIALIB_RX_BUFFER_SIZE
+#define SERIALIB_RX_BUFFER_SIZE 4096
+#endif
+
+/*! Bytes handed to the driver at once in SERIAL_FLOW_CTS_GATED mode: at most this many bytes
+    are still sent after the receiver deasserts CTS, they must fit in its remaining buffer */
+#ifndef SERIALIB_CTS_CHUNK
+#define SERIALIB_CTS_CHUNK 16
+#endif
+
+/*! Low latency features applied by openDevice, see lowLatencyFeatures() */
+#define SERIAL_LOW_LATENCY_CUSTOM_BAUD  0x01 /**< Baud rate set exactly (termios2 / BOTHER on Linux) */
+#define SERIAL_LOW_LATENCY_DRIVER_FLAG  0x02 /**< ASYNC_LOW_LATENCY accepted by the driver */
+#define SERIAL_LOW_LATENCY_USB_TIMER    0x04 /**< Latency timer of the USB adapter lowered to 1 ms */
+
 /**
  * number of serial data bits
  */
@@ -86,6 +114,15 @@ enum SerialParity {
     SERIAL_PARITY_SPACE /**< space bit */
 };
 
+/**
+ * type of flow control used by writeStream
+ */
+enum SerialFlowControl {
+    SERIAL_FLOW_NONE, /**< no flow control */
+    SERIAL_FLOW_RTSCTS, /**< hardware RTS/CTS handshake done by the driver (CRTSCTS) */
+    SERIAL_FLOW_CTS_GATED /**< CTS checked by writeStream before each small chunk, for drivers without CRTSCTS (Unix only) */
+};
+
 /*!  \class     serialib
      \brief     This class is used for communication over a serial device.
 */
@@ -121,9 +158,23 @@ public:
     // Check device opening state
     bool isDeviceOpen();
 
+#if defined (__linux__) || defined(__APPLE__)
+    // File descriptor of the open device (to wait for it with poll/epoll)
+    int     getFileDescriptor();
+#endif
+
     // Close the current device
     void    closeDevice();
 
+    // Enable the low latency mode for the next openDevice (any baud rate, low latency driver settings)
+    void    setLowLatency(bool enable);
+
+    // Low latency features applied by the last openDevice (SERIAL_LOW_LATENCY_* flags)
+    int     lowLatencyFeatures();
+
+    // Select the flow control of the open device
+    char    setFlowControl(SerialFlowControl mode);
+
 
 
 
@@ -153,6 +204,11 @@ public:
                             unsigned int maxNbBytes,
                             const unsigned int timeOut_ms=0);
 
+    // Read a line without copying it (with timeout)
+    int     readLine    (   const char **line,
+                            char finalChar,
+                            const unsigned int timeOut_ms=0);
+
 
 
     // _____________________________________
@@ -162,9 +218,20 @@ public:
     // Write an array of bytes
     int     writeBytes  (const void *Buffer, const unsigned int NbBytes);
 
+    // Write as many bytes as the flow control allows (with timeout), return the number of bytes written
+    int     writeStream (const void *Buffer, const unsigned int NbBytes, const unsigned int timeOut_ms=0);
+
+#if defined (__linux__) || defined(__APPLE__)
+    // Same as writeStream for several buffers sent back to back, with one writev() per batch
+    int     writeVector (const struct iovec *Buffers, const int NbBuffers, const unsigned int timeOut_ms=0);
+#endif
+
     // Read an array of byte (with timeout)
     int     readBytes   (void *buffer,unsigned int maxNbBytes,const unsigned int timeOut_ms=0, unsigned int sleepDuration_us=100);
 
+    // Read the bytes already received, waiting for the first one (with timeout)
+    int     readAvailable(void *buffer,unsigned int maxNbBytes,const unsigned int timeOut_ms=0);
+
 
 
 
@@ -178,6 +245,9 @@ public:
     // Return the number of bytes in the received buffer
     int     available();
 
+    // Return the number of bytes written but not yet transmitted by the driver
+    int     pendingOutput();
+
 
 
 
@@ -222,6 +292,13 @@ private:
     bool            currentStateRTS;
     bool            currentStateDTR;
 
+    // Low latency mode requested with setLowLatency, and the features it actually got
+    bool            lowLatency;
+    int             lowLatencyApplied;
+
+    // Flow control selected with setFlowControl
+    SerialFlowControl flowControl;
+
 
 
 
@@ -234,6 +311,27 @@ private:
 #endif
 #if defined (__linux__) || defined(__APPLE__)
     int             fd;
+
+    // Internal receive buffer, filled with large reads and consumed by all the read functions
+    char            rxBuffer[SERIALIB_RX_BUFFER_SIZE];
+    // Index of the first unread byte and end of the received data in rxBuffer
+    unsigned int    rxHead;
+    unsigned int    rxTail;
+
+    // Block until the device is readable, the timeout expires or an error occurs
+    int             waitReadable(int timeOut_ms);
+
+    // Block until the device accepts more bytes, the timeout expires or an error occurs
+    int             waitWritable(int timeOut_ms);
+
+    // Append the pending bytes of the device to the receive buffer (with timeout, -1 waits forever)
+    int             fillBuffer(int timeOut_ms);
+
+    // Copy up to maxNbBytes buffered bytes, return the number of bytes copied
+    unsigned int    takeBuffered(void *buffer,unsigned int maxNbBytes);
+
+    // Apply the low latency settings to the open device, return -4 if the baud rate can't be set
+    char            applyLowLatency(const char *Device, const unsigned int Bauds, bool customBaud);
 #endif
 
 };
@@ -262,6 +360,9 @@ private:
     // Used to store the previous time (for computing timeout)
     LONGLONG       counterFrequency;
     LONGLONG       previousTime;
+#elif defined (__linux__) || defined(__APPLE__)
+    // Used to store the previous time (monotonic, not affected by NTP adjustments)
+    struct timespec     previousTime;
 #else
     // Used to store the previous time (for computing timeout)
     struct timeval      previousTime;
@@ -0,0 +1,100 @@
+//
+// Inspect and replay a serial traffic journal recorded by the Communicator.
+//
+// Usage: journal_replay FILE [--dump 0|1] [--speed X]
+//   --dump  print every record instead of replaying (default 0)
+//   --speed replay pace, 1 = as recorded, 0 = as fast as possible (default 1)
+//
+// The replay feeds the recorded STM32 frames to a Communicator through a pseudo-terminal and checks
+// that all of them come out of it. Exit status: 0 on success, 2 if frames were lost, 1 on errors.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sys/resource.h>
+#include "communicator.h"
+#include "journal_replay.h"
+
+static void dump(const std::vector<JournalRecord>& records) {
+    int64_t first = records.empty() ? 0 : records.front().time_ns;
+    for (const JournalRecord& record : records) {
+        std::cout << std::fixed << std::setprecision(6) << static_cast<double>(record.time_ns - first) * 1e-9 << " "
+                  << (record.direction == JournalDirection::Tx ? "TX " : "RX ") << std::setw(9) << msgTypeName(record.frame.type)
+                  << " seq " << std::setw(3) << static_cast<int>(record.frame.seq) << " len " << std::setw(2)
+                  << static_cast<int>(record.frame.length) << " ";
+        if (record.frame.type == MsgType::Text) {
+            std::cout << std::string(reinterpret_cast<const char*>(record.frame.payload), record.frame.length);
+        } else if (record.frame.type == MsgType::Motion && record.frame.length >= 3) {
+            std::cout << static_cast<char>(record.frame.payload[0]) << getU16(record.frame.payload + 1);
+        }
+        std::cout << std::endl;
+    }
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        std::cerr << "Usage: " << argv[0] << " FILE [--dump 0|1] [--speed X]" << std::endl;
+        return 1;
+    }
+    bool dumpOnly = false;
+    double speed = 1.0;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (strcmp(argv[i], "--dump") == 0) dumpOnly = std::atoi(argv[i + 1]) != 0;
+        else if (strcmp(argv[i], "--speed") == 0) speed = std::atof(argv[i + 1]);
+        else {
+            std::cerr << "Unknown option " << argv[i] << std::endl;
+            return 1;
+        }
+    }
+
+    std::vector<JournalRecord> records;
+    if (!readJournal(argv[1], records)) {
+        std::cerr << "[Error] " << argv[1] << " is not a readable journal." << std::endl;
+        return 1;
+    }
+    size_t rx = 0;
+    for (const JournalRecord& record : records) rx += record.direction == JournalDirection::Rx;
+    double duration = records.empty() ? 0.0 : static_cast<double>(records.back().time_ns - records.front().time_ns) * 1e-9;
+    std::cout << "[Info] " << records.size() << " records (" << records.size() - rx << " TX, " << rx << " RX) over "
+              << duration << " s" << std::endl;
+    if (dumpOnly) {
+        dump(records);
+        return 0;
+    }
+
+    JournalReplayer replayer(records, speed);
+    Communicator link;
+    if (!replayer.start() || link.start(replayer.devicePath().c_str(), 115200) != 1) {
+        std::cerr << "[Error] Cannot set up the replay pseudo-terminal." << std::endl;
+        return 1;
+    }
+
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    int64_t startTime = monotonicNanos();
+    Frame frame;
+    uint64_t delivered = 0;
+    // Stop once everything was written and the Communicator has been quiet for a while
+    while (link.isRunning()) {
+        if (link.waitForFrame(200)) {
+            while (link.dequeue(frame)) ++delivered;
+        } else if (replayer.finished()) {
+            break;
+        }
+    }
+    double elapsed = static_cast<double>(monotonicNanos() - startTime) * 1e-9;
+    getrusage(RUSAGE_SELF, &after);
+    link.stop();
+    replayer.stop();
+
+    auto seconds = [](const timeval& t) { return static_cast<double>(t.tv_sec) + static_cast<double>(t.tv_usec) * 1e-6; };
+    double cpu = seconds(after.ru_utime) - seconds(before.ru_utime) + seconds(after.ru_stime) - seconds(before.ru_stime);
+    std::cout << "[Info] Replayed " << replayer.framesReplayed() << "/" << replayer.framesToReplay() << " frames in "
+              << elapsed << " s (CPU " << cpu << " s, replayer included)" << std::endl;
+    std::cout << "[Info] Communicator received " << link.framesReceived() << " frames: " << delivered
+              << " delivered, " << link.telemetry().totalSamples() << " telemetry samples, " << link.rxDropped()
+              << " dropped, " << link.crcErrors() << " CRC errors" << std::endl;
+    return link.framesReceived() == replayer.framesToReplay() ? 0 : 2;
+}
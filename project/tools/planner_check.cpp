@@ -0,0 +1,33 @@
+//
+// Randomised cross-check of the path planners against reference implementations, see planner_check.h.
+//
+// Usage: planner_check [--seed N] [--rounds N]
+// Exit status: 0 if every planner agreed with the references, 1 otherwise.
+//
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include "planner_check.h"
+
+int main(int argc, char** argv) {
+    uint32_t seed = 1;
+    int rounds = 2000;
+    if (argc % 2 == 0) {
+        std::cerr << "Missing value for " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        const char* value = argv[i + 1];
+        if (strcmp(option, "--seed") == 0) {
+            seed = static_cast<uint32_t>(std::atoi(value));
+        } else if (strcmp(option, "--rounds") == 0) {
+            rounds = std::atoi(value);
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+    return planner_check_main(seed, rounds) == 0 ? 0 : 1;
+}
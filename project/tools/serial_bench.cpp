@@ -0,0 +1,448 @@
+//
+// Serial round-trip latency and throughput benchmark.
+//
+// Sends Text frames through serialib and times the echo sent back by the STM32 (or by the simulator,
+// started in a child process so that its CPU time is not charged to the benchmark).
+//
+// Usage: serial_bench [--device PATH] [--baud N] [--size N] [--count N] [--warmup N]
+//                     [--rate N] [--burst N] [--delay-us N] [--pace 0|1] [--low-latency 0|1]
+//   --device   serial device with a firmware that echoes Text frames, default: simulated STM32
+//   --baud     line speed, also used to pace the simulated line (default 115200)
+//   --size     payload bytes per message, 4 to 64 (default 16)
+//   --count    measured messages (default 10000), --warmup messages sent first and not measured (default 100)
+//   --rate     messages per second, 0 = closed loop: each burst waits for its echoes (default 0)
+//   --burst    messages written back to back each time (default 1)
+//   --delay-us processing delay of the simulated STM32 (default 0)
+//   --pace     simulate the line speed, 0 = the pty runs as fast as possible (default 1)
+//   --low-latency open the device in serialib low latency mode, needed for rates such as 921600 (default 0)
+//
+// The STM32 only executes Text frames in sequence and acknowledges each one after its echo. A message
+// is counted as lost as soon as that shows: an Ack without the echo before it (the echo was corrupted),
+// or a repeated Ack (the message never arrived, and the STM32 drops every message after it). The bench
+// then resynchronises the STM32 with a Sync frame and carries on, instead of stalling every later round
+// trip. A message still unanswered after a few round trips of the line is given up the same way.
+//
+// Like the Communicator, the bench keeps at most about 2 ms of line time in the driver (estimated from the
+// baud rate, ptys and many USB adapters do not report it) and hands over the rest with writeStream as the
+// line drains. With a rate, a burst that comes due while earlier bytes are still waiting is not sent;
+// those messages are reported apart from the lost ones, they show where the line saturates.
+//
+// Exit status: 0 if every message was echoed, 2 if some were lost, 1 on setup errors.
+//
+
+#include <algorithm>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "latency_histogram.h"
+#include "monotonic_clock.h"
+#include "protocol.h"
+#include "serialib.h"
+#include "stm32_simulator.h"
+#include "transport.h"
+
+namespace {
+
+struct BenchConfig {
+    std::string device;
+    unsigned int baud = 115200;
+    unsigned int size = 16;
+    unsigned int count = 10000;
+    unsigned int warmup = 100;
+    unsigned int rate = 0;
+    unsigned int burst = 1;
+    unsigned int delay_us = 0;
+    bool pace = true;
+    bool lowLatency = false;
+};
+
+constexpr int64_t REPLY_TIMEOUT_NS = 1'000'000'000; // Nothing echoed for 1 s: the run is over
+constexpr int64_t MIN_LOSS_TIMEOUT_NS = 20'000'000; // Closed loop: shortest wait for an unanswered burst
+constexpr int64_t DRIVER_QUEUE_NS = 2'000'000;      // Line time handed to the driver ahead of the line
+
+bool parseArguments(int argc, char** argv, BenchConfig& config) {
+    if (argc % 2 == 0) {
+        std::cerr << "Missing value for " << argv[argc - 1] << std::endl;
+        return false;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        unsigned int value = static_cast<unsigned int>(std::strtoul(argv[i + 1], nullptr, 10));
+        if (strcmp(option, "--device") == 0) config.device = argv[i + 1];
+        else if (strcmp(option, "--baud") == 0) config.baud = value;
+        else if (strcmp(option, "--size") == 0) config.size = value;
+        else if (strcmp(option, "--count") == 0) config.count = value;
+        else if (strcmp(option, "--warmup") == 0) config.warmup = value;
+        else if (strcmp(option, "--rate") == 0) config.rate = value;
+        else if (strcmp(option, "--burst") == 0) config.burst = value;
+        else if (strcmp(option, "--delay-us") == 0) config.delay_us = value;
+        else if (strcmp(option, "--pace") == 0) config.pace = value != 0;
+        else if (strcmp(option, "--low-latency") == 0) config.lowLatency = value != 0;
+        else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+    if (config.size < 4 || config.size > FRAME_MAX_PAYLOAD || config.count == 0 || config.burst == 0) {
+        std::cerr << "Invalid size, count or burst" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Start the simulator in a child process. Returns its pid and the pty path, or -1.
+pid_t spawnSimulator(const BenchConfig& config, std::string& path) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    // The child waits for SIGTERM with sigwait, block it before the simulator thread is created
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGTERM);
+
+    pid_t pid = fork();
+    if (pid < 0) return -1;
+    if (pid == 0) {
+        close(fds[0]);
+        sigprocmask(SIG_BLOCK, &signals, nullptr);
+        SimulatorConfig simulatorConfig;
+        simulatorConfig.processingDelay = std::chrono::microseconds(config.delay_us);
+        simulatorConfig.baudRate = config.pace ? config.baud : 0;
+        Stm32Simulator simulator(simulatorConfig);
+        if (simulator.start()) {
+            std::string line = simulator.devicePath() + "\n";
+            if (write(fds[1], line.data(), line.size()) < 0) _exit(1);
+        }
+        close(fds[1]);
+        int signal;
+        sigwait(&signals, &signal);
+        simulator.stop();
+        _exit(0);
+    }
+
+    close(fds[1]);
+    char buffer[128];
+    ssize_t length = 0;
+    ssize_t received;
+    while (length < static_cast<ssize_t>(sizeof(buffer)) &&
+           (received = read(fds[0], buffer + length, sizeof(buffer) - length)) > 0) {
+        length += received;
+    }
+    close(fds[0]);
+    if (length <= 1 || buffer[length - 1] != '\n') {
+        kill(pid, SIGTERM);
+        waitpid(pid, nullptr, 0);
+        return -1;
+    }
+    path.assign(buffer, length - 1);
+    return pid;
+}
+
+int64_t cpuNanos() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    auto toNanos = [](const timeval& t) { return t.tv_sec * 1'000'000'000LL + t.tv_usec * 1000LL; };
+    return toNanos(usage.ru_utime) + toNanos(usage.ru_stime);
+}
+
+class Bench {
+public:
+    Bench(serialib& serial, const BenchConfig& config)
+        : serial(serial), config(config), total(config.warmup + config.count),
+          sendTime(total, 0), status(total, Status::Pending) {
+        // Closed loop: a burst should be answered within a few line round trips. With a rate, messages wait
+        // in the driver buffer behind a busy line, only Acks tell them lost.
+        lossTimeout = REPLY_TIMEOUT_NS;
+        // An unpaced simulated line takes bytes as fast as they come
+        byte_ns = config.baud > 0 && (config.pace || !config.device.empty()) ? 10'000'000'000LL / config.baud : 0; // 8N1
+        driverLimit = std::max<int64_t>(FRAME_MAX_ENCODED, byte_ns > 0 ? DRIVER_QUEUE_NS / byte_ns : INT32_MAX);
+        if (config.rate == 0) {
+            int64_t frameBytes = config.size + (FRAME_MAX_ENCODED - FRAME_MAX_PAYLOAD);
+            int64_t roundTrip = config.burst * ((2 * frameBytes + FRAME_MAX_ENCODED - FRAME_MAX_PAYLOAD) * byte_ns +
+                                                config.delay_us * 1000LL);
+            lossTimeout = std::max(MIN_LOSS_TIMEOUT_NS, 4 * roundTrip);
+        }
+    }
+
+    void run() {
+        int64_t interval_ns = config.rate > 0 ? 1'000'000'000LL * config.burst / config.rate : 0;
+        int64_t nextBurst = monotonicNanos();
+        int64_t lastProgress = nextBurst;
+
+        while (replies + lost + notSent < total) {
+            flushOutput();
+            int64_t now = monotonicNanos();
+
+            // Send the bursts that are due (closed loop: when the previous burst has been answered)
+            while (nextId < total && (config.rate > 0 ? now >= nextBurst : replies + lost + notSent >= nextId)) {
+                // The line did not take the previous bytes yet: this burst cannot go out on time
+                bool saturated = config.rate > 0 && outputOffset < output.size();
+                for (unsigned int i = 0; i < config.burst && nextId < total; ++i) {
+                    if (saturated) {
+                        skipMessage(nextId++);
+                    } else {
+                        sendMessage(nextId++);
+                    }
+                }
+                nextBurst += interval_ns;
+                now = monotonicNanos();
+            }
+
+            int timeout_ms = 100;
+            if (outputOffset < output.size()) {
+                timeout_ms = 1; // Come back soon to hand the rest of the output to the driver
+            } else if (config.rate > 0 && nextId < total) {
+                // readAvailable has a millisecond resolution, faster rates are sent in batches
+                timeout_ms = static_cast<int>(std::clamp<int64_t>((nextBurst - now + 999'999) / 1'000'000, 1, 100));
+            }
+            int received = serial.readAvailable(buffer, sizeof(buffer), timeout_ms);
+            if (received < 0) {
+                std::cerr << "[Error] Read error " << received << std::endl;
+                return;
+            }
+            int64_t arrival = monotonicNanos();
+            uint64_t before = replies;
+            for (int i = 0; i < received; ++i) {
+                Frame frame;
+                if (decoder.push(buffer[i], frame)) onFrame(frame, arrival);
+            }
+
+            while (oldestPending < nextId && status[oldestPending] != Status::Pending) ++oldestPending;
+            if (replies != before) {
+                lastProgress = arrival;
+            } else if (arrival - lastProgress > REPLY_TIMEOUT_NS && arrival - lastSend > REPLY_TIMEOUT_NS) {
+                // Nothing more is coming, the missing messages are lost
+                break;
+            }
+            if (oldestPending < nextId && arrival - sendTime[oldestPending] > lossTimeout) {
+                // Neither an echo nor an Ack told what happened (the last message or the Sync was lost)
+                giveUp();
+            }
+        }
+        endTime = lastReplyTime;
+        endCpu = cpuNanos();
+    }
+
+    void report() const {
+        uint64_t skipped = 0;
+        for (uint64_t id = config.warmup; id < total; ++id) skipped += status[id] == Status::NotSent;
+        uint64_t missing = lostMessages() - skipped;
+        double elapsed_s = static_cast<double>(endTime - startTime) * 1e-9;
+        double cpu_s = static_cast<double>(endCpu - startCpu) * 1e-9;
+        auto us = [](uint64_t ns) { return static_cast<double>(ns) * 1e-3; };
+
+        std::cout << std::fixed << std::setprecision(1);
+        std::cout << "Messages:   " << config.count << " x " << config.size << " bytes, echoed " << latency.count()
+                  << ", lost " << missing << ", not sent " << skipped << " (line saturated), CRC errors "
+                  << decoder.crcErrors() << ", resyncs " << resyncs << std::endl;
+        if (writeErrors > 0) std::cout << "Write errors: " << writeErrors << std::endl;
+        std::cout << "RTT (us):   min " << us(latency.min()) << "  p50 " << us(latency.percentile(0.5))
+                  << "  p90 " << us(latency.percentile(0.9)) << "  p99 " << us(latency.percentile(0.99))
+                  << "  p99.9 " << us(latency.percentile(0.999)) << "  max " << us(latency.max())
+                  << "  mean " << us(static_cast<uint64_t>(latency.mean())) << std::endl;
+        if (elapsed_s > 0 && latency.count() > 0) {
+            double perSecond = static_cast<double>(latency.count()) / elapsed_s;
+            std::cout << "Throughput: " << perSecond << " msg/s, "
+                      << perSecond * config.size / 1024.0 << " KiB/s payload each way" << std::endl;
+            std::cout << "CPU:        " << cpu_s * 1e6 / static_cast<double>(latency.count()) << " us/msg, "
+                      << 100.0 * cpu_s / elapsed_s << " % of one core" << std::endl;
+        }
+    }
+
+    uint64_t lostMessages() const { return config.count - latency.count(); }
+
+private:
+    void sendMessage(uint64_t id) {
+        if (id == config.warmup) {
+            // Measurement starts with the first non-warmup message
+            startTime = monotonicNanos();
+            startCpu = cpuNanos();
+        }
+        uint8_t payload[FRAME_MAX_PAYLOAD] = {};
+        putU32(payload, static_cast<uint32_t>(id));
+        for (unsigned int i = 4; i < config.size; ++i) payload[i] = static_cast<uint8_t>(id + i);
+
+        Frame frame;
+        // The STM32 only executes Text frames in sequence, seq follows the order of the messages sent
+        makeFrame(frame, MsgType::Text, static_cast<uint8_t>(sentIds.size()), payload, config.size);
+        sentIds.push_back(id);
+        lastSend = monotonicNanos();
+        sendTime[id] = lastSend;
+        queueFrame(frame);
+    }
+
+    void skipMessage(uint64_t id) {
+        if (id == config.warmup) {
+            startTime = monotonicNanos();
+            startCpu = cpuNanos();
+        }
+        status[id] = Status::NotSent;
+        ++notSent;
+    }
+
+    void queueFrame(const Frame& frame) {
+        uint8_t encoded[FRAME_MAX_ENCODED];
+        size_t length = encodeFrame(frame, encoded, sizeof(encoded));
+        output.insert(output.end(), encoded, encoded + length);
+        flushOutput();
+    }
+
+    // Hand the driver as much of the output as the line will send soon, keep the rest
+    void flushOutput() {
+        if (outputOffset == output.size()) return;
+        int64_t now = monotonicNanos();
+        int64_t queued = byte_ns > 0 && lineIdle > now ? (lineIdle - now) / byte_ns : 0;
+        queued = std::max<int64_t>(queued, serial.pendingOutput());
+        if (queued >= driverLimit) return;
+        int64_t budget = std::min<int64_t>(driverLimit - queued, static_cast<int64_t>(output.size() - outputOffset));
+        int written = serial.writeStream(output.data() + outputOffset, static_cast<unsigned int>(budget));
+        if (written > 0) lineIdle = std::max(lineIdle, now) + written * byte_ns;
+        if (written < 0) {
+            // The bytes are gone, the messages will be given up like lost ones
+            ++writeErrors;
+            written = static_cast<int>(output.size() - outputOffset);
+        }
+        outputOffset += written;
+        if (outputOffset == output.size()) {
+            output.clear();
+            outputOffset = 0;
+        }
+    }
+
+    void onFrame(const Frame& frame, int64_t arrival) {
+        if (frame.type == MsgType::Sync) {
+            awaitingSync = false;
+            return;
+        }
+        if (frame.type == MsgType::Ack) {
+            onAck(frame.seq);
+            return;
+        }
+        if (frame.type != MsgType::Text || frame.length < 4) return; // Telemetry is not measured
+        uint32_t id = getU32(frame.payload);
+        if (id >= nextId || status[id] != Status::Pending) return;
+        status[id] = Status::Echoed;
+        ++replies;
+        lastReplyTime = arrival;
+        if (id >= config.warmup) latency.record(arrival - sendTime[id]);
+    }
+
+    // Cumulative Ack: the STM32 executed every message up to the one with seq ackSeq
+    void onAck(uint8_t ackSeq) {
+        if (awaitingSync) return; // Acks of the messages dropped before the resync
+        if (ackSeq == static_cast<uint8_t>(delivered - 1)) {
+            // Repeated Ack: message 'delivered' was lost on the way, the ones after it are dropped
+            if (delivered < sentIds.size()) giveUp();
+            return;
+        }
+        uint64_t index = delivered + static_cast<uint8_t>(ackSeq - static_cast<uint8_t>(delivered));
+        if (index >= sentIds.size()) return;
+        // The echo of each message comes before its Ack: an executed message without echo lost its echo
+        for (; delivered <= index; ++delivered) {
+            if (status[sentIds[delivered]] == Status::Pending) markLost(sentIds[delivered]);
+        }
+    }
+
+    // Count every unanswered message as lost and make the STM32 expect the next one
+    void giveUp() {
+        for (uint64_t id = oldestPending; id < nextId; ++id) {
+            if (status[id] == Status::Pending) markLost(id);
+        }
+        delivered = sentIds.size();
+        uint8_t next = static_cast<uint8_t>(sentIds.size());
+        uint8_t seqs[SYNC_REQUEST_SIZE] = {next, next};
+        Frame frame;
+        makeFrame(frame, MsgType::Sync, static_cast<uint8_t>(resyncs), seqs, SYNC_REQUEST_SIZE);
+        queueFrame(frame);
+        awaitingSync = true;
+        ++resyncs;
+    }
+
+    void markLost(uint64_t id) {
+        status[id] = Status::Lost;
+        ++lost;
+    }
+
+    enum class Status : uint8_t { Pending, Echoed, Lost, NotSent };
+
+    serialib& serial;
+    const BenchConfig& config;
+    const uint64_t total;
+    std::vector<int64_t> sendTime;
+    std::vector<Status> status;
+    uint64_t nextId = 0;
+    uint64_t replies = 0;
+    uint64_t lost = 0;             // Messages given up on
+    uint64_t notSent = 0;          // Messages skipped because the line was saturated
+    uint64_t oldestPending = 0;    // No message before it waits for its echo
+    std::vector<uint64_t> sentIds; // Message ids in sending order: index modulo 256 is the frame seq
+    uint64_t delivered = 0;        // Messages sent that the STM32 acknowledged or was resynchronised past
+    std::vector<uint8_t> output;   // Encoded frames not taken by the driver yet, from outputOffset
+    size_t outputOffset = 0;
+    uint64_t writeErrors = 0;
+    int64_t byte_ns = 0;     // Line time of one byte, 0 if the line is not paced
+    int64_t driverLimit = 0; // Bytes allowed in the driver
+    int64_t lineIdle = 0;    // Estimated time at which the bytes handed to the driver are sent
+    bool awaitingSync = false;
+    uint64_t resyncs = 0;
+    int64_t lossTimeout = 0;
+
+    FrameDecoder decoder;
+    uint8_t buffer[4096];
+    LatencyHistogram latency;
+
+    int64_t lastSend = 0;
+    int64_t lastReplyTime = 0;
+    int64_t startTime = 0;
+    int64_t endTime = 0;
+    int64_t startCpu = 0;
+    int64_t endCpu = 0;
+};
+
+} // namespace
+
+int main(int argc, char** argv) {
+    BenchConfig config;
+    if (!parseArguments(argc, argv, config)) return 1;
+
+    pid_t simulator = -1;
+    std::string device = config.device;
+    if (device.empty()) {
+        simulator = spawnSimulator(config, device);
+        if (simulator < 0) {
+            std::cerr << "[Error] Cannot start the STM32 simulator." << std::endl;
+            return 1;
+        }
+    }
+
+    serialib serial;
+    serial.setLowLatency(config.lowLatency);
+    int status = 1;
+    if (serial.openDevice(device.c_str(), config.baud) != 1) {
+        std::cerr << "[Error] Cannot open " << device << std::endl;
+    } else {
+        std::cout << "Device:     " << device << (simulator > 0 ? " (simulated)" : "") << " @ " << config.baud
+                  << " baud, " << (config.rate ? std::to_string(config.rate) + " msg/s" : std::string("closed loop"))
+                  << ", burst " << config.burst;
+        if (config.lowLatency) std::cout << ", low latency features 0x" << std::hex << serial.lowLatencyFeatures() << std::dec;
+        std::cout << std::endl;
+        Bench bench(serial, config);
+        bench.run();
+        bench.report();
+        serial.closeDevice();
+        status = bench.lostMessages() == 0 ? 0 : 2;
+    }
+
+    if (simulator > 0) {
+        kill(simulator, SIGTERM);
+        waitpid(simulator, nullptr, 0);
+    }
+    return status;
+}
@@ -0,0 +1,95 @@
+//
+// Stand-alone STM32 simulator: creates a pty that behaves like the motor board.
+//
+// Usage: stm32_sim [--delay-us N] [--baud N] [--error-rate P] [--telemetry-hz N] [--seed N] [--drift-ppm X]
+//                  [--link PATH] [--unplug-every-ms N] [--downtime-ms N]
+// Then point the host at the printed device path instead of /dev/ttyUSB0.
+// --link keeps PATH pointing at the simulated port; with --unplug-every-ms the USB-serial adapter is
+// unplugged periodically for --downtime-ms (default 500), to exercise the host reconnection.
+//
+
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include "stm32_simulator.h"
+
+static volatile std::sig_atomic_t stopRequested = 0;
+
+static void onSignal(int) {
+    stopRequested = 1;
+}
+
+int main(int argc, char** argv) {
+    SimulatorConfig config;
+    long unplugPeriod_ms = 0;
+    long downtime_ms = 500;
+    if (argc % 2 == 0) {
+        std::cerr << "Missing value for " << argv[argc - 1] << std::endl;
+        return 1;
+    }
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const char* option = argv[i];
+        const char* value = argv[i + 1];
+        if (strcmp(option, "--delay-us") == 0) {
+            config.processingDelay = std::chrono::microseconds(std::atoll(value));
+        } else if (strcmp(option, "--baud") == 0) {
+            config.baudRate = static_cast<unsigned int>(std::atoi(value));
+        } else if (strcmp(option, "--error-rate") == 0) {
+            config.byteErrorRate = std::atof(value);
+        } else if (strcmp(option, "--telemetry-hz") == 0) {
+            config.telemetryRate_hz = static_cast<unsigned int>(std::atoi(value));
+        } else if (strcmp(option, "--seed") == 0) {
+            config.seed = static_cast<uint32_t>(std::atoi(value));
+        } else if (strcmp(option, "--drift-ppm") == 0) {
+            config.clockDrift_ppm = std::atof(value);
+        } else if (strcmp(option, "--link") == 0) {
+            config.linkPath = value;
+        } else if (strcmp(option, "--unplug-every-ms") == 0) {
+            unplugPeriod_ms = std::atol(value);
+        } else if (strcmp(option, "--downtime-ms") == 0) {
+            downtime_ms = std::atol(value);
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return 1;
+        }
+    }
+
+    if (unplugPeriod_ms > 0 && config.linkPath.empty()) {
+        std::cerr << "--unplug-every-ms needs --link" << std::endl;
+        return 1;
+    }
+
+    Stm32Simulator simulator(config);
+    if (!simulator.start()) {
+        std::cerr << "[Error] Cannot create pseudo-terminal or link." << std::endl;
+        return 1;
+    }
+    std::cout << "[Info] STM32 simulator listening on " << simulator.devicePath() << std::endl;
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    auto nextUnplug = std::chrono::steady_clock::now() + std::chrono::milliseconds(unplugPeriod_ms);
+    while (!stopRequested) {
+        if (unplugPeriod_ms == 0) {
+            pause();
+            continue;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        if (std::chrono::steady_clock::now() >= nextUnplug) {
+            simulator.unplug(std::chrono::milliseconds(downtime_ms));
+            nextUnplug += std::chrono::milliseconds(unplugPeriod_ms);
+            std::cout << "[Info] Adapter unplugged for " << downtime_ms << " ms" << std::endl;
+        }
+    }
+
+    simulator.stop();
+    std::cout << "[Info] Frames received: " << simulator.framesReceived()
+              << ", commands executed: " << simulator.commandsExecuted()
+              << ", duplicates: " << simulator.duplicates()
+              << ", CRC errors: " << simulator.crcErrors()
+              << ", bytes corrupted: " << simulator.bytesCorrupted()
+              << ", unplugs: " << simulator.unplugs() << std::endl;
+    return 0;
+}